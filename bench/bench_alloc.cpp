@@ -0,0 +1,216 @@
+#include "woomem.h"
+#include "bench_common.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+/*
+Allocation throughput per size class, against the system malloc. Every
+thread keeps its last LIVE_WINDOW allocations alive: woomem units are stored
+in a root unit and left to the GC once replaced, malloc blocks are freed when
+replaced. woomem is measured with single allocations and with bulks of
+BULK_COUNT units.
+*/
+
+static void on_gc() {}
+static void on_mark(void*) {}
+static void on_free(void*) {}
+static void on_entry() {}
+
+static constexpr size_t LIVE_WINDOW = 1024;
+static constexpr size_t BULK_COUNT = 16;
+static constexpr size_t MAX_OPS_PER_THREAD = 512 * 1024;
+static constexpr size_t BYTES_PER_THREAD = 64 * 1024 * 1024;
+
+static constexpr size_t VALIDATE_COUNT = 4 * 1024 * 1024;
+
+static size_t ops_per_thread(size_t size)
+{
+    return std::min(MAX_OPS_PER_THREAD, BYTES_PER_THREAD / size);
+}
+
+static void woomem_alloc_job(size_t size)
+{
+    void** const window = static_cast<void**>(woomem_allocate_begin(LIVE_WINDOW * sizeof(void*)));
+    memset(window, 0, LIVE_WINDOW * sizeof(void*));
+    woomem_allocate_end_as_root(window, WOOMEM_ATTRIB_NEED_SWEEP | WOOMEM_ATTRIB_AUTO_MARK);
+
+    const size_t op_count = ops_per_thread(size);
+    for (size_t i = 0; i < op_count; ++i)
+    {
+        void* const unit = woomem_allocate_begin(size);
+        *static_cast<size_t*>(unit) = i;
+
+        woomem_write_barrier(window, unit);
+        window[i % LIVE_WINDOW] = unit;
+        woomem_allocate_end(unit, WOOMEM_ATTRIB_NEED_SWEEP);
+    }
+
+    woomem_remove_from_root_set(window);
+}
+
+static void woomem_bulk_alloc_job(size_t size)
+{
+    void** const window = static_cast<void**>(woomem_allocate_begin(LIVE_WINDOW * sizeof(void*)));
+    memset(window, 0, LIVE_WINDOW * sizeof(void*));
+    woomem_allocate_end_as_root(window, WOOMEM_ATTRIB_NEED_SWEEP | WOOMEM_ATTRIB_AUTO_MARK);
+
+    static_assert(LIVE_WINDOW % BULK_COUNT == 0);
+
+    void* units[BULK_COUNT];
+    const size_t op_count = ops_per_thread(size) / BULK_COUNT * BULK_COUNT;
+    for (size_t i = 0; i < op_count; i += BULK_COUNT)
+    {
+        if (woomem_allocate_bulk(size, BULK_COUNT, units) != BULK_COUNT)
+            std::abort();
+
+        for (size_t j = 0; j < BULK_COUNT; ++j)
+        {
+            *static_cast<size_t*>(units[j]) = i + j;
+
+            woomem_write_barrier(window, units[j]);
+            window[(i + j) % LIVE_WINDOW] = units[j];
+        }
+        woomem_allocate_end_bulk(units, BULK_COUNT, WOOMEM_ATTRIB_NEED_SWEEP);
+    }
+
+    woomem_remove_from_root_set(window);
+}
+
+static void malloc_alloc_job(size_t size)
+{
+    std::vector<void*> window(LIVE_WINDOW, nullptr);
+
+    const size_t op_count = ops_per_thread(size);
+    for (size_t i = 0; i < op_count; ++i)
+    {
+        void* const block = malloc(size);
+        *static_cast<size_t*>(block) = i;
+
+        free(window[i % LIVE_WINDOW]);
+        window[i % LIVE_WINDOW] = block;
+    }
+
+    for (void* const block : window)
+        free(block);
+}
+
+static void bench_size(size_t size, size_t thread_count)
+{
+    const double op_count = static_cast<double>(ops_per_thread(size) * thread_count);
+
+    const double woomem_seconds = run_threads(
+        thread_count, [size](size_t) { woomem_alloc_job(size); });
+    const double woomem_bulk_seconds = run_threads(
+        thread_count, [size](size_t) { woomem_bulk_alloc_job(size); });
+    const double malloc_seconds = run_threads(
+        thread_count, [size](size_t) { malloc_alloc_job(size); });
+
+    const double woomem_mops = op_count / woomem_seconds / 1e6;
+    const double woomem_bulk_mops =
+        static_cast<double>(ops_per_thread(size) / BULK_COUNT * BULK_COUNT * thread_count)
+        / woomem_bulk_seconds / 1e6;
+    const double malloc_mops = op_count / malloc_seconds / 1e6;
+
+    std::printf("alloc.size_%zu threads=%zu woomem_mops_per_s=%.2f woomem_bulk_mops_per_s=%.2f malloc_mops_per_s=%.2f ratio=%.2f\n",
+        size, thread_count, woomem_mops, woomem_bulk_mops, malloc_mops, woomem_mops / malloc_mops);
+}
+
+// `pointers` are interior pointers of alive units, looked up in a random order.
+static void bench_validate(const char* name, const std::vector<void*>& pointers)
+{
+    size_t found_count = 0;
+
+    const auto begin = bench_clock::now();
+    for (size_t i = 0; i < VALIDATE_COUNT; ++i)
+    {
+        if (woomem_validate_addr(pointers[i % pointers.size()]) != nullptr)
+            ++found_count;
+    }
+    const auto end = bench_clock::now();
+
+    std::printf("alloc.validate_%s ns_per_op=%.2f found=%zu\n",
+        name,
+        static_cast<double>(nanoseconds_between(begin, end)) / VALIDATE_COUNT,
+        found_count);
+}
+
+static void bench_validate_units()
+{
+    constexpr size_t SMALL_UNIT_COUNT = 64 * 1024;
+    constexpr size_t SMALL_UNIT_SIZE = 64;
+    constexpr size_t HUGE_UNIT_SIZE = 4 * 1024 * 1024;
+    constexpr size_t POINTER_COUNT = 64 * 1024;
+
+    // The root is ended first, the units stay pending until they are stored.
+    void** const root = static_cast<void**>(
+        woomem_allocate_begin((SMALL_UNIT_COUNT + 1) * sizeof(void*)));
+    memset(root, 0, (SMALL_UNIT_COUNT + 1) * sizeof(void*));
+    woomem_allocate_end_as_root(root, WOOMEM_ATTRIB_NEED_SWEEP | WOOMEM_ATTRIB_AUTO_MARK);
+
+    std::mt19937_64 rng(SMALL_UNIT_COUNT);
+    std::vector<void*> small_pointers;
+    for (size_t i = 0; i < SMALL_UNIT_COUNT; ++i)
+    {
+        char* const unit = static_cast<char*>(woomem_allocate_begin(SMALL_UNIT_SIZE));
+        woomem_write_barrier(root, unit);
+        root[i] = unit;
+        small_pointers.push_back(unit + rng() % SMALL_UNIT_SIZE);
+    }
+    char* const huge_unit = static_cast<char*>(woomem_allocate_begin(HUGE_UNIT_SIZE));
+    woomem_write_barrier(root, huge_unit);
+    root[SMALL_UNIT_COUNT] = huge_unit;
+
+    std::vector<void*> huge_pointers;
+    for (size_t i = 0; i < POINTER_COUNT; ++i)
+        huge_pointers.push_back(huge_unit + rng() % HUGE_UNIT_SIZE);
+
+    std::shuffle(small_pointers.begin(), small_pointers.end(), rng);
+
+    for (size_t i = 0; i <= SMALL_UNIT_COUNT; ++i)
+        woomem_allocate_end(root[i], WOOMEM_ATTRIB_NEED_SWEEP);
+
+    bench_validate("small_interior", small_pointers);
+    bench_validate("huge_interior", huge_pointers);
+
+    woomem_remove_from_root_set(root);
+}
+
+int bench_alloc_main(void)
+{
+    woomem_InitConfig config = {};
+    config.reserved_chunk_size = 256 * 1024 * 1024;
+    config.gc_callback_at_begin = on_gc;
+    config.gc_callback_at_stop_marking = on_gc;
+    config.mark_callback = on_mark;
+    config.free_callback = on_free;
+    config.main_entry_callback = on_entry;
+    config.worker_entry_callback = on_entry;
+
+    if (!woomem_init_with_config(&config))
+    {
+        std::fprintf(stderr, "woomem_init_with_config failed\n");
+        return 1;
+    }
+
+    static constexpr size_t SIZES[] = { 16, 32, 64, 128, 256, 512, 1024, 4096, 16384 };
+
+    const size_t multi_thread_count =
+        std::max<size_t>(2, std::min<size_t>(4, std::thread::hardware_concurrency()));
+
+    for (const size_t size : SIZES)
+        bench_size(size, 1);
+    for (const size_t size : SIZES)
+        bench_size(size, multi_thread_count);
+
+    bench_validate_units();
+
+    woomem_shutdown();
+    return 0;
+}
@@ -0,0 +1,147 @@
+#include "woomem_chunk.hpp"
+#include "bench_common.hpp"
+
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+/*
+Page runs of a single chunk, without the GC: allocate_page / free_page on a
+fragmented chunk, and validate for pointers into normal and huge pages.
+*/
+
+using namespace woomem;
+
+static constexpr size_t CHUNK_SIZE = 64 * 1024 * 1024;
+static constexpr size_t FRAGMENTED_OP_COUNT = 1024 * 1024;
+static constexpr size_t VALIDATE_COUNT = 4 * 1024 * 1024;
+static constexpr size_t MAX_BENCH_SPAN_PAGE_COUNT = 8;
+
+static void bench_fragmented_pages()
+{
+    std::unique_ptr<Chunk> chunk(new Chunk(CHUNK_SIZE));
+    if (chunk->is_init_failed())
+    {
+        std::fprintf(stderr, "chunk reservation failed\n");
+        return;
+    }
+
+    std::mt19937_64 rng(CHUNK_SIZE);
+    auto random_span = [&rng]() { return 1 + rng() % MAX_BENCH_SPAN_PAGE_COUNT; };
+
+    // Fill the chunk with runs of random length, then free a random half of
+    // them, leaving holes of all sizes behind.
+    std::vector<PageHead*> slots;
+    while (PageHead* const page = chunk->allocate_page(random_span()))
+        slots.push_back(page);
+    for (PageHead*& page : slots)
+    {
+        if (rng() % 2 == 0)
+        {
+            chunk->free_page(page);
+            page = nullptr;
+        }
+    }
+
+    // Every op frees the run of a random slot, or refills it if it is empty.
+    size_t allocate_count = 0;
+    size_t failed_count = 0;
+
+    const auto begin = bench_clock::now();
+    for (size_t i = 0; i < FRAGMENTED_OP_COUNT; ++i)
+    {
+        PageHead*& page = slots[rng() % slots.size()];
+        if (page != nullptr)
+        {
+            chunk->free_page(page);
+            page = nullptr;
+        }
+        else
+        {
+            page = chunk->allocate_page(random_span());
+            ++allocate_count;
+            if (page == nullptr)
+                ++failed_count;
+        }
+    }
+    const auto end = bench_clock::now();
+
+    std::printf("chunk.fragmented_pages slots=%zu ns_per_op=%.2f allocate_count=%zu failed_count=%zu\n",
+        slots.size(),
+        static_cast<double>(nanoseconds_between(begin, end)) / FRAGMENTED_OP_COUNT,
+        allocate_count,
+        failed_count);
+
+    for (PageHead* const page : slots)
+        if (page != nullptr)
+            chunk->free_page(page);
+}
+
+static void bench_validate(const char* name, Chunk& chunk, const std::vector<void*>& pointers)
+{
+    size_t found_count = 0;
+
+    const auto begin = bench_clock::now();
+    for (size_t i = 0; i < VALIDATE_COUNT; ++i)
+    {
+        if (chunk.validate(pointers[i % pointers.size()]) != nullptr)
+            ++found_count;
+    }
+    const auto end = bench_clock::now();
+
+    std::printf("chunk.validate_%s ns_per_op=%.2f found=%zu\n",
+        name,
+        static_cast<double>(nanoseconds_between(begin, end)) / VALIDATE_COUNT,
+        found_count);
+}
+
+static void bench_validate_pages()
+{
+    constexpr size_t NORMAL_PAGE_COUNT = 1024;
+    constexpr size_t HUGE_PAGE_SIZE = 16 * 1024 * 1024;
+    constexpr size_t POINTER_COUNT = 64 * 1024;
+
+    std::unique_ptr<Chunk> chunk(new Chunk(CHUNK_SIZE));
+    if (chunk->is_init_failed())
+    {
+        std::fprintf(stderr, "chunk reservation failed\n");
+        return;
+    }
+
+    std::vector<PageHead*> pages;
+    for (size_t i = 0; i < NORMAL_PAGE_COUNT; ++i)
+        pages.push_back(chunk->allocate_page());
+    PageHead* const huge_page = chunk->allocate_huge_page(HUGE_PAGE_SIZE);
+
+    std::mt19937_64 rng(POINTER_COUNT);
+    std::vector<void*> normal_pointers;
+    std::vector<void*> huge_pointers;
+    std::vector<void*> outside_pointers;
+    for (size_t i = 0; i < POINTER_COUNT; ++i)
+    {
+        normal_pointers.push_back(
+            reinterpret_cast<char*>(pages[rng() % pages.size()])
+            + rng() % PageHead::NORMAL_PAGE_SIZE);
+        huge_pointers.push_back(
+            reinterpret_cast<char*>(huge_page) + rng() % HUGE_PAGE_SIZE);
+        outside_pointers.push_back(
+            reinterpret_cast<char*>(chunk->get_base_address()) + CHUNK_SIZE + rng() % CHUNK_SIZE);
+    }
+
+    bench_validate("normal_page", *chunk, normal_pointers);
+    bench_validate("huge_interior", *chunk, huge_pointers);
+    bench_validate("outside", *chunk, outside_pointers);
+
+    for (PageHead* const page : pages)
+        chunk->free_page(page);
+    chunk->free_page(huge_page);
+}
+
+int bench_chunk_main(void)
+{
+    bench_fragmented_pages();
+    bench_validate_pages();
+    return 0;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+/*
+Every result is printed as one line `<group>.<case> key=value ...` on stdout,
+so that runs of different releases can be compared by scripts. Progress and
+errors go to stderr.
+*/
+
+using bench_clock = std::chrono::steady_clock;
+
+inline double seconds_between(bench_clock::time_point begin, bench_clock::time_point end)
+{
+    return std::chrono::duration<double>(end - begin).count();
+}
+
+inline uint64_t nanoseconds_between(bench_clock::time_point begin, bench_clock::time_point end)
+{
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+}
+
+// Nearest rank, `sorted_samples` must not be empty.
+inline uint64_t percentile(const std::vector<uint64_t>& sorted_samples, double p)
+{
+    size_t rank = static_cast<size_t>(p / 100. * static_cast<double>(sorted_samples.size()));
+    if (rank >= sorted_samples.size())
+        rank = sorted_samples.size() - 1;
+    return sorted_samples[rank];
+}
+
+// Runs `job(thread_index)` on `thread_count` threads released together,
+// returns the seconds until the last of them finished.
+template<typename JobT>
+double run_threads(size_t thread_count, JobT&& job)
+{
+    std::atomic_bool start{ false };
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < thread_count; ++i)
+    {
+        threads.emplace_back([&start, &job, i]()
+            {
+                while (!start.load(std::memory_order_acquire))
+                    std::this_thread::yield();
+                job(i);
+            });
+    }
+
+    const auto begin = bench_clock::now();
+    start.store(true, std::memory_order_release);
+    for (std::thread& thread : threads)
+        thread.join();
+
+    return seconds_between(begin, bench_clock::now());
+}
@@ -0,0 +1,60 @@
+#include "woomem.h"
+
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+extern int bench_alloc_main(void);
+extern int bench_chunk_main(void);
+extern int bench_mark_main(void);
+extern int bench_sweep_main(void);
+extern int bench_pause_main(void);
+
+struct BenchGroup
+{
+    const char* m_name;
+    int (*m_main)(void);
+};
+
+static const BenchGroup BENCH_GROUPS[] = {
+    { "alloc", bench_alloc_main },
+    { "chunk", bench_chunk_main },
+    { "mark", bench_mark_main },
+    { "sweep", bench_sweep_main },
+    { "pause", bench_pause_main },
+};
+
+// Usage: woomem_bench [group ...], all groups are run if none is given.
+int main(int argc, char** argv){
+    for (int i = 1; i < argc; ++i)
+    {
+        bool known = false;
+        for (const BenchGroup& group : BENCH_GROUPS)
+            known = known || strcmp(argv[i], group.m_name) == 0;
+
+        if (!known)
+        {
+            std::fprintf(stderr, "unknown bench group: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    std::printf("bench.config size_class_steps=%d hardware_concurrency=%u\n",
+        WOOMEM_SIZE_CLASS_STEPS, std::thread::hardware_concurrency());
+
+    for (const BenchGroup& group : BENCH_GROUPS)
+    {
+        bool selected = argc == 1;
+        for (int i = 1; i < argc; ++i)
+            selected = selected || strcmp(argv[i], group.m_name) == 0;
+
+        if (!selected)
+            continue;
+
+        std::fprintf(stderr, "running %s\n", group.m_name);
+        const int result = group.m_main();
+        if (result != 0)
+            return result;
+    }
+    return 0;
+}
@@ -0,0 +1,188 @@
+#include "woomem.h"
+#include "bench_common.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+#include <algorithm>
+
+/*
+Mark throughput: a live graph is built under a root unit, then full GC
+cycles are triggered. The time from `gc_callback_at_begin` to
+`gc_callback_at_stop_marking` covers root and parallel marking, the live
+bytes divided by it is the reported throughput.
+*/
+
+static bench_clock::time_point g_mark_begin;
+static bench_clock::time_point g_mark_end;
+
+static void on_gc_begin() { g_mark_begin = bench_clock::now(); }
+static void on_gc_stop_marking() { g_mark_end = bench_clock::now(); }
+static void on_mark(void*) {}
+static void on_free(void*) {}
+static void on_entry() {}
+
+static constexpr int REPEAT_COUNT = 5;
+static constexpr int LEAF_ATTRIB = WOOMEM_ATTRIB_NEED_SWEEP | WOOMEM_ATTRIB_AUTO_MARK;
+
+struct ListNode
+{
+    ListNode*   m_next;
+    size_t      m_payload[7];
+};
+
+struct TreeNode
+{
+    TreeNode*   m_children[2];
+    size_t      m_payload[6];
+};
+static_assert(sizeof(TreeNode) == sizeof(ListNode), "Units are allocated as ListNode.");
+
+static void* allocate_root(size_t size)
+{
+    void* const root = woomem_allocate_begin(size);
+    memset(root, 0, size);
+    woomem_allocate_end_as_root(root, LEAF_ATTRIB);
+    return root;
+}
+
+// Returns the best throughput of REPEAT_COUNT cycles in MB/s.
+static double measure_mark_throughput(size_t live_bytes)
+{
+    double best_seconds = 0.;
+    for (int i = 0; i < REPEAT_COUNT; ++i)
+    {
+        woomem_trigger_gc(false);
+
+        const double seconds =
+            seconds_between(g_mark_begin, g_mark_end);
+        if (i == 0 || seconds < best_seconds)
+            best_seconds = seconds;
+    }
+    return static_cast<double>(live_bytes) / (1024. * 1024.) / best_seconds;
+}
+
+static void report(const char* name, size_t unit_count, size_t live_bytes)
+{
+    std::printf("mark.%s units=%zu live_bytes=%zu mb_per_s=%.1f\n",
+        name, unit_count, live_bytes, measure_mark_throughput(live_bytes));
+}
+
+// Units are linked in a shuffled order, so that the graph does not follow
+// the allocation order and every edge is likely a cache miss.
+static std::vector<void*> allocate_shuffled_units(size_t count, woomem_TypeId type_id)
+{
+    std::vector<void*> units(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        void* const unit = type_id == WOOMEM_UNTYPED
+            ? woomem_allocate_begin(sizeof(ListNode))
+            : woomem_allocate_begin_typed(sizeof(ListNode), type_id);
+
+        memset(unit, 0, sizeof(ListNode));
+        units[i] = unit;
+    }
+    std::shuffle(units.begin(), units.end(), std::mt19937_64(count));
+    return units;
+}
+
+static void bench_list(const char* name, size_t count, woomem_TypeId type_id)
+{
+    ListNode** const root = static_cast<ListNode**>(allocate_root(sizeof(void*)));
+
+    // Link before ending the allocations, no unit is reachable until then.
+    const std::vector<void*> units = allocate_shuffled_units(count, type_id);
+    for (void* const unit : units)
+    {
+        ListNode* const node = static_cast<ListNode*>(unit);
+        node->m_next = *root;
+        *root = node;
+    }
+    for (void* const unit : units)
+        woomem_allocate_end(unit, LEAF_ATTRIB);
+
+    report(name, count, count * (sizeof(ListNode) + sizeof(void*)));
+
+    woomem_remove_from_root_set(root);
+}
+
+// Complete binary tree, node i has the children 2i+1 and 2i+2.
+static void bench_tree(const char* name, size_t count, woomem_TypeId type_id)
+{
+    TreeNode** const root = static_cast<TreeNode**>(allocate_root(sizeof(void*)));
+
+    const std::vector<void*> units = allocate_shuffled_units(count, type_id);
+    for (size_t i = 0; i < count; ++i)
+    {
+        TreeNode* const node = static_cast<TreeNode*>(units[i]);
+        for (size_t child = 0; child < 2; ++child)
+        {
+            const size_t child_index = 2 * i + 1 + child;
+            if (child_index < count)
+                node->m_children[child] = static_cast<TreeNode*>(units[child_index]);
+        }
+    }
+    *root = static_cast<TreeNode*>(units[0]);
+    for (void* const unit : units)
+        woomem_allocate_end(unit, LEAF_ATTRIB);
+
+    report(name, count, count * (sizeof(TreeNode) + sizeof(void*)));
+
+    woomem_remove_from_root_set(root);
+}
+
+static void bench_wide(const char* name, size_t count, woomem_TypeId leaf_type_id)
+{
+    void** const root = static_cast<void**>(allocate_root(count * sizeof(void*)));
+
+    const std::vector<void*> units = allocate_shuffled_units(count, leaf_type_id);
+    for (size_t i = 0; i < count; ++i)
+        root[i] = units[i];
+    for (void* const unit : units)
+        woomem_allocate_end(unit, LEAF_ATTRIB);
+
+    report(name, count, count * (sizeof(ListNode) + sizeof(void*)));
+
+    woomem_remove_from_root_set(root);
+}
+
+int bench_mark_main(void)
+{
+    woomem_InitConfig config = {};
+    config.reserved_chunk_size = 256 * 1024 * 1024;
+    config.gc_callback_at_begin = on_gc_begin;
+    config.gc_callback_at_stop_marking = on_gc_stop_marking;
+    config.mark_callback = on_mark;
+    config.free_callback = on_free;
+    config.main_entry_callback = on_entry;
+    config.worker_entry_callback = on_entry;
+
+    if (!woomem_init_with_config(&config))
+    {
+        std::fprintf(stderr, "woomem_init_with_config failed\n");
+        return 1;
+    }
+
+    const size_t list_offsets[] = { offsetof(ListNode, m_next) };
+    const woomem_TypeId list_type = woomem_register_type(sizeof(ListNode), list_offsets, 1);
+    const size_t tree_offsets[] = {
+        offsetof(TreeNode, m_children[0]), offsetof(TreeNode, m_children[1]) };
+    const woomem_TypeId tree_type = woomem_register_type(sizeof(TreeNode), tree_offsets, 2);
+    const woomem_TypeId leaf_type = woomem_register_type(sizeof(ListNode), nullptr, 0);
+
+    constexpr size_t UNIT_COUNT = 1024 * 1024;
+
+    bench_list("list_auto", UNIT_COUNT, WOOMEM_UNTYPED);
+    bench_list("list_typed", UNIT_COUNT, list_type);
+    bench_tree("tree_auto", UNIT_COUNT, WOOMEM_UNTYPED);
+    bench_tree("tree_typed", UNIT_COUNT, tree_type);
+    bench_wide("wide_auto", UNIT_COUNT, WOOMEM_UNTYPED);
+    bench_wide("wide_typed", UNIT_COUNT, leaf_type);
+
+    woomem_shutdown();
+    return 0;
+}
@@ -0,0 +1,205 @@
+#include "woomem.h"
+#include "bench_common.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+/*
+Pauses under a steady churn: mutator threads replace random slots of their
+root unit with new units of mixed sizes while the GC keeps collecting.
+Reported are the latencies of single allocations (against malloc / free
+doing the same churn), and the durations of the root mark and final mark
+phases, which are the windows a runtime stops its threads for in
+`gc_callback_at_begin` and `gc_callback_at_stop_marking`. Phases are taken
+from the trace callback.
+*/
+
+static void on_gc() {}
+static void on_mark(void*) {}
+static void on_free(void*) {}
+static void on_entry() {}
+
+static constexpr size_t CHURN_THREAD_COUNT = 2;
+static constexpr size_t CHURN_SLOT_COUNT = 64 * 1024;
+static constexpr size_t CHURN_OPS_PER_THREAD = 2 * 1024 * 1024;
+static constexpr size_t MAX_TRACED_PHASE_COUNT = 64 * 1024;
+
+struct TracedPhase
+{
+    uint64_t    m_begin_ns;
+    uint64_t    m_duration_ns;
+};
+
+// Phase events only come from the GC main thread, no locking needed.
+static TracedPhase g_traced_phases[WOOMEM_GC_PHASE_COUNT][MAX_TRACED_PHASE_COUNT];
+static size_t g_traced_phase_counts[WOOMEM_GC_PHASE_COUNT];
+
+static void on_trace_event(const woomem_TraceEvent* event)
+{
+    if (event->phase >= WOOMEM_GC_PHASE_COUNT)
+        return;
+
+    size_t& count = g_traced_phase_counts[event->phase];
+    if (count == MAX_TRACED_PHASE_COUNT)
+        return;
+
+    TracedPhase& phase = g_traced_phases[event->phase][count];
+    if (event->kind == WOOMEM_TRACE_PHASE_BEGIN)
+        phase.m_begin_ns = event->timestamp_ns;
+    else if (event->kind == WOOMEM_TRACE_PHASE_END)
+    {
+        phase.m_duration_ns = event->timestamp_ns - phase.m_begin_ns;
+        ++count;
+    }
+}
+
+static size_t churn_size(std::mt19937_64& rng)
+{
+    if (rng() % 8 != 0)
+        return 16 + rng() % 240;
+    return 256 + rng() % 4096;
+}
+
+static std::vector<uint64_t> woomem_churn_job(size_t thread_index)
+{
+    std::vector<uint64_t> latencies;
+    latencies.reserve(CHURN_OPS_PER_THREAD);
+
+    void** const slots = static_cast<void**>(
+        woomem_allocate_begin(CHURN_SLOT_COUNT * sizeof(void*)));
+    memset(slots, 0, CHURN_SLOT_COUNT * sizeof(void*));
+    woomem_allocate_end_as_root(slots, WOOMEM_ATTRIB_NEED_SWEEP | WOOMEM_ATTRIB_AUTO_MARK);
+
+    std::mt19937_64 rng(thread_index);
+    for (size_t i = 0; i < CHURN_OPS_PER_THREAD; ++i)
+    {
+        const size_t size = churn_size(rng);
+
+        const auto begin = bench_clock::now();
+        void* const unit = woomem_allocate_begin(size);
+        latencies.push_back(nanoseconds_between(begin, bench_clock::now()));
+
+        *static_cast<size_t*>(unit) = i;
+
+        void*& slot = slots[rng() % CHURN_SLOT_COUNT];
+        woomem_write_barrier(slots, unit);
+        slot = unit;
+        woomem_allocate_end(unit, WOOMEM_ATTRIB_NEED_SWEEP);
+    }
+
+    woomem_remove_from_root_set(slots);
+    return latencies;
+}
+
+static std::vector<uint64_t> malloc_churn_job(size_t thread_index)
+{
+    std::vector<uint64_t> latencies;
+    latencies.reserve(CHURN_OPS_PER_THREAD);
+
+    std::vector<void*> slots(CHURN_SLOT_COUNT, nullptr);
+
+    std::mt19937_64 rng(thread_index);
+    for (size_t i = 0; i < CHURN_OPS_PER_THREAD; ++i)
+    {
+        const size_t size = churn_size(rng);
+
+        const auto begin = bench_clock::now();
+        void* const block = malloc(size);
+        latencies.push_back(nanoseconds_between(begin, bench_clock::now()));
+
+        *static_cast<size_t*>(block) = i;
+
+        void*& slot = slots[rng() % CHURN_SLOT_COUNT];
+        free(slot);
+        slot = block;
+    }
+
+    for (void* const block : slots)
+        free(block);
+    return latencies;
+}
+
+template<typename JobT>
+static void bench_churn(const char* name, JobT&& job)
+{
+    std::vector<std::vector<uint64_t>> thread_latencies(CHURN_THREAD_COUNT);
+    const double seconds = run_threads(CHURN_THREAD_COUNT,
+        [&thread_latencies, &job](size_t thread_index)
+        {
+            thread_latencies[thread_index] = job(thread_index);
+        });
+
+    std::vector<uint64_t> latencies;
+    for (const std::vector<uint64_t>& part : thread_latencies)
+        latencies.insert(latencies.end(), part.begin(), part.end());
+    std::sort(latencies.begin(), latencies.end());
+
+    std::printf("pause.churn_%s threads=%zu mops_per_s=%.2f alloc_p50_ns=%llu alloc_p99_ns=%llu alloc_p999_ns=%llu alloc_max_ns=%llu\n",
+        name,
+        CHURN_THREAD_COUNT,
+        static_cast<double>(latencies.size()) / seconds / 1e6,
+        static_cast<unsigned long long>(percentile(latencies, 50.)),
+        static_cast<unsigned long long>(percentile(latencies, 99.)),
+        static_cast<unsigned long long>(percentile(latencies, 99.9)),
+        static_cast<unsigned long long>(latencies.back()));
+}
+
+static void report_phase(const char* name, woomem_GCPhase phase)
+{
+    std::vector<uint64_t> durations;
+    for (size_t i = 0; i < g_traced_phase_counts[phase]; ++i)
+        durations.push_back(g_traced_phases[phase][i].m_duration_ns);
+
+    if (durations.empty())
+    {
+        std::printf("pause.%s cycles=0\n", name);
+        return;
+    }
+    std::sort(durations.begin(), durations.end());
+
+    std::printf("pause.%s cycles=%zu p50_us=%.1f p99_us=%.1f max_us=%.1f\n",
+        name,
+        durations.size(),
+        static_cast<double>(percentile(durations, 50.)) / 1e3,
+        static_cast<double>(percentile(durations, 99.)) / 1e3,
+        static_cast<double>(durations.back()) / 1e3);
+}
+
+int bench_pause_main(void)
+{
+    woomem_InitConfig config = {};
+    config.reserved_chunk_size = 64 * 1024 * 1024;
+    config.gc_callback_at_begin = on_gc;
+    config.gc_callback_at_stop_marking = on_gc;
+    config.mark_callback = on_mark;
+    config.free_callback = on_free;
+    config.main_entry_callback = on_entry;
+    config.worker_entry_callback = on_entry;
+
+    if (!woomem_init_with_config(&config))
+    {
+        std::fprintf(stderr, "woomem_init_with_config failed\n");
+        return 1;
+    }
+
+    std::fill(std::begin(g_traced_phase_counts), std::end(g_traced_phase_counts), 0);
+    (void)woomem_set_trace(0, on_trace_event);
+
+    bench_churn("woomem", woomem_churn_job);
+
+    (void)woomem_set_trace(0, nullptr);
+
+    bench_churn("malloc", malloc_churn_job);
+
+    report_phase("root_mark", WOOMEM_GC_PHASE_ROOT_MARK);
+    report_phase("final_mark", WOOMEM_GC_PHASE_FINAL_MARK);
+
+    woomem_shutdown();
+    return 0;
+}
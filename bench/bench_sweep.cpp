@@ -0,0 +1,106 @@
+#include "woomem.h"
+#include "bench_common.hpp"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+/*
+Sweep time against heap size: a heap of small units, every other one kept
+alive by a root, is collected by a forced cycle. The sweep phase is taken
+from woomem_get_stats once the cycle finished sweeping. Automatic cycles are
+pushed far away by the pacer settings, so that the forced one sweeps all of
+the garbage.
+*/
+
+static void on_gc() {}
+static void on_mark(void*) {}
+static void on_free(void*) {}
+static void on_entry() {}
+
+static constexpr size_t UNIT_SIZE = 64;
+static constexpr size_t UNIT_SIZE_WITH_HEAD = UNIT_SIZE + 8 /* sizeof(UnitHead) */;
+
+static uint64_t sweep_total_ns()
+{
+    woomem_Stats stats = {};
+    woomem_get_stats(&stats);
+    return stats.gc_phase_total_ns[WOOMEM_GC_PHASE_SWEEP];
+}
+
+// woomem_trigger_gc returns after marking, wait for the sweep as well.
+static uint64_t collect_and_wait_for_sweep()
+{
+    const uint64_t total_ns_before = sweep_total_ns();
+    woomem_trigger_gc(false);
+
+    woomem_Stats stats = {};
+    do
+    {
+        std::this_thread::yield();
+        woomem_get_stats(&stats);
+    } while (stats.gc_phase_total_ns[WOOMEM_GC_PHASE_SWEEP] == total_ns_before);
+
+    return stats.gc_phase_last_ns[WOOMEM_GC_PHASE_SWEEP];
+}
+
+static void bench_heap_size(size_t heap_size)
+{
+    const size_t unit_count = heap_size / UNIT_SIZE_WITH_HEAD;
+    const size_t alive_count = unit_count / 2;
+
+    void** const root = static_cast<void**>(woomem_allocate_begin(alive_count * sizeof(void*)));
+    memset(root, 0, alive_count * sizeof(void*));
+    woomem_allocate_end_as_root(root, WOOMEM_ATTRIB_NEED_SWEEP | WOOMEM_ATTRIB_AUTO_MARK);
+
+    for (size_t i = 0; i < unit_count; ++i)
+    {
+        void* const unit = woomem_allocate_begin(UNIT_SIZE);
+        memset(unit, 0, UNIT_SIZE);
+        if (i % 2 == 0)
+        {
+            woomem_write_barrier(root, unit);
+            root[i / 2] = unit;
+        }
+        woomem_allocate_end(unit, WOOMEM_ATTRIB_NEED_SWEEP);
+    }
+
+    const uint64_t sweep_ns = collect_and_wait_for_sweep();
+    std::printf("sweep.heap_%zumb units=%zu alive_units=%zu sweep_ms=%.3f mb_per_s=%.1f\n",
+        heap_size / (1024 * 1024),
+        unit_count,
+        alive_count,
+        static_cast<double>(sweep_ns) / 1e6,
+        static_cast<double>(heap_size) / (1024. * 1024.) / (static_cast<double>(sweep_ns) / 1e9));
+
+    // Drop the heap before the next size.
+    woomem_remove_from_root_set(root);
+    (void)collect_and_wait_for_sweep();
+}
+
+int bench_sweep_main(void)
+{
+    woomem_InitConfig config = {};
+    config.reserved_chunk_size = 256 * 1024 * 1024;
+    config.gc_heap_growth_percent = 100000;
+    config.gc_callback_at_begin = on_gc;
+    config.gc_callback_at_stop_marking = on_gc;
+    config.mark_callback = on_mark;
+    config.free_callback = on_free;
+    config.main_entry_callback = on_entry;
+    config.worker_entry_callback = on_entry;
+
+    if (!woomem_init_with_config(&config))
+    {
+        std::fprintf(stderr, "woomem_init_with_config failed\n");
+        return 1;
+    }
+
+    static constexpr size_t HEAP_SIZES_MB[] = { 16, 64, 256 };
+    for (const size_t heap_size_mb : HEAP_SIZES_MB)
+        bench_heap_size(heap_size_mb * 1024 * 1024);
+
+    woomem_shutdown();
+    return 0;
+}
@@ -12,6 +12,8 @@ extern "C" {
 
 extern uint8_t  woomem_gc_marking_round_counter;
 extern bool     woomem_gc_marking_state_flag;
+// Updated once a cycle has finished sweeping, which is after
+// woomem_trigger_gc returns for it, see woomem_wait_for_sweep.
 extern size_t   woomem_gc_memory_size_after_last_round_sweep;
 
 typedef enum woomem_Attrib
@@ -23,12 +25,72 @@ typedef enum woomem_Attrib
 
 }woomem_Attrib;
 
+typedef uint16_t woomem_TypeId;
+#define WOOMEM_UNTYPED ((woomem_TypeId)0)
+
 typedef void (*woomem_MarkCallback)(void*);
 typedef void (*woomem_FreeCallback)(void*);
 typedef void (*woomem_GCCallback)(void);
 typedef void (*woomem_GCMainThreadEntryCallback)(void);
 typedef void (*woomem_GCWorkerThreadEntryCallback)(void);
 
+typedef struct woomem_InitConfig
+{
+    // Size of the first chunk; the heap reserves more chunks on demand when it
+    // runs out of pages.
+    size_t reserved_chunk_size;
+
+    // GC workers marking and sweeping in parallel, 0 for default
+    // (hardware_concurrency / 8, at least 1).
+    size_t gc_worker_count;
+    // Upper limit for woomem_set_gc_worker_count. Threads are created for all
+    // of them up front, extra ones stay parked while not in use. A value less
+    // than `gc_worker_count` (e.g. 0) means equal to it.
+    size_t gc_max_worker_count;
+
+    // OPTIONAL: Worker i is pinned to CPU gc_worker_cpus[i % gc_worker_cpu_count].
+    const size_t* gc_worker_cpus;
+    size_t gc_worker_cpu_count;
+
+    bool chunk_huge_page_backing;
+
+    // On NUMA machines, every node gets its own chunks and recycled pages;
+    // threads allocate from the node they run on. Unless `gc_worker_cpus` is
+    // given, GC workers are spread over the nodes and pinned to them. Threads
+    // are assigned to workers of their node, and workers sweep the pages of
+    // their node first.
+    bool numa_aware;
+
+    // Most automatic cycles only trace and sweep young units, old units are
+    // left to periodic major cycles. Requires woomem_write_barrier to be called
+    // for every pointer stored into a unit.
+    bool gc_generational;
+
+    // Threads which allocate more during a cycle than the pacer planned for
+    // help it before their allocation returns: they scan gray units while it
+    // is marking (waiting for marking to end if there are none to take), and
+    // sweep pages while it is sweeping. Mark and free callbacks may then run
+    // on those threads too.
+    bool gc_mutator_assist;
+
+    // GC pacing, see woomem_set_gc_pacer.
+    size_t gc_heap_growth_percent;
+    size_t gc_soft_memory_limit;
+    size_t gc_cpu_percent;
+
+    woomem_GCCallback gc_callback_at_begin;
+    woomem_GCCallback gc_callback_at_stop_marking;
+    woomem_MarkCallback mark_callback;
+    woomem_FreeCallback free_callback;
+    woomem_GCMainThreadEntryCallback main_entry_callback;
+    woomem_GCWorkerThreadEntryCallback worker_entry_callback;
+
+}woomem_InitConfig;
+
+bool woomem_init_with_config(const woomem_InitConfig* config);
+
+// Same as woomem_init_with_config with default worker settings;
+// `reserved_chunk_size` is the size of the first chunk.
 bool woomem_init(
     size_t reserved_chunk_size,
     woomem_GCCallback gc_callback_at_begin,
@@ -39,16 +101,206 @@ bool woomem_init(
     woomem_GCWorkerThreadEntryCallback worker_entry_callback);
 void woomem_shutdown(void);
 
+// Align chunk reservations to 2 MiB and ask the OS for huge pages (THP).
+// Must be called before woomem_init.
+void woomem_set_chunk_huge_page_backing(bool enable);
+
+// With `async == false`, returns once a GC cycle has finished marking, the
+// unreachable units are then swept in the background. Until the sweep is done,
+// woomem_gc_memory_size_after_last_round_sweep and the sweep numbers of
+// woomem_Stats are still those of the previous cycle.
 void woomem_trigger_gc(bool async);
+// Same as woomem_trigger_gc, but only collects young units if `gc_generational`
+// is enabled.
+void woomem_trigger_minor_gc(bool async);
+// Returns once every cycle which has finished marking has been swept too.
+void woomem_wait_for_sweep(void);
+
+// Takes effect from the next GC cycle, clamped to [1, gc_max_worker_count].
+void woomem_set_gc_worker_count(size_t worker_count);
+size_t woomem_get_gc_worker_count(void);
+
+// Free pages unused for `min_idle_gc_rounds` rounds are returned to the OS after
+// each sweep, until at most `retained_dirty_size` bytes of them stay committed.
+// While no cycle runs, every idle second counts as a round and purges as well.
+void woomem_set_purge_policy(size_t retained_dirty_size, size_t min_idle_gc_rounds);
+
+// A cycle is started once `heap_growth_percent` of the alive size (0 for the
+// default 33) has been allocated since the last one, early enough for marking
+// to end before that. A non-zero `soft_memory_limit` shrinks the allowance
+// when the alive size approaches it, while a non-zero `gc_cpu_percent` lets it
+// grow (up to 4 times) for as long as the GC takes more of the CPUs than that.
+void woomem_set_gc_pacer(
+    size_t heap_growth_percent, size_t soft_memory_limit, size_t gc_cpu_percent);
+
+typedef enum woomem_GCPhase
+{
+    // From `gc_callback_at_begin` until parallel marking starts.
+    WOOMEM_GC_PHASE_ROOT_MARK,
+    WOOMEM_GC_PHASE_PARALLEL_MARK,
+    // From `gc_callback_at_stop_marking` until marking ends.
+    WOOMEM_GC_PHASE_FINAL_MARK,
+    WOOMEM_GC_PHASE_SWEEP,
+
+    WOOMEM_GC_PHASE_COUNT,
+
+}woomem_GCPhase;
+
+typedef struct woomem_SizeClassStats
+{
+    size_t unit_size;
+    size_t span_page_count;
+
+    // Spans carved for the size class and not given back to their chunk.
+    size_t live_span_count;
+    // Spans with free units in the global collections, waiting for threads.
+    size_t free_span_count;
+    // Spans without a free unit, until the sweep frees some of them.
+    size_t run_out_span_count;
+
+}woomem_SizeClassStats;
+
+typedef struct woomem_GCWorkerStats
+{
+    // Since woomem_init, including the work of mutators assisting the worker.
+    size_t marked_unit_count;
+    size_t freed_unit_count;
+    // Part of `marked_unit_count` scanned by mutators assisting the worker.
+    size_t assisted_unit_count;
+
+}woomem_GCWorkerStats;
+
+typedef struct woomem_Stats
+{
+    // OPTIONAL: Set by the caller, up to `size_class_capacity` and
+    // `gc_worker_capacity` entries are filled.
+    woomem_SizeClassStats* size_classes;
+    size_t size_class_capacity;
+    woomem_GCWorkerStats* gc_workers;
+    size_t gc_worker_capacity;
+
+    // Entries available, may be more than filled.
+    size_t size_class_count;
+    size_t gc_worker_count;
+
+    size_t reserved_size;
+    size_t committed_size;
+    size_t free_run_count;
+    size_t largest_free_run_size;
+
+    // Threads publish their allocated size in batches, so this lags behind
+    // by up to 64 KiB per thread.
+    size_t allocated_size_since_last_gc;
+    size_t alive_size_after_last_sweep;
+    // Cycles which finished marking, as woomem_trigger_gc waits for, and
+    // cycles which finished sweeping as well.
+    size_t gc_cycle_count;
+    size_t gc_swept_cycle_count;
+
+    uint64_t gc_phase_last_ns[WOOMEM_GC_PHASE_COUNT];
+    uint64_t gc_phase_total_ns[WOOMEM_GC_PHASE_COUNT];
+
+}woomem_Stats;
+
+// Reads relaxed counters kept by the heap and the GC, cheap enough to be
+// called every second. The numbers are not a consistent snapshot.
+void woomem_get_stats(woomem_Stats* stats);
+
+typedef enum woomem_TraceEventKind
+{
+    // On the GC main thread, `value` is 1 for a minor cycle, 0 for a major one.
+    WOOMEM_TRACE_CYCLE_BEGIN,
+    // `value` is the alive size counted by the sweep.
+    WOOMEM_TRACE_CYCLE_END,
+    // On the GC main thread, `phase` is set.
+    WOOMEM_TRACE_PHASE_BEGIN,
+    WOOMEM_TRACE_PHASE_END,
+    // Work of a GC worker in the phase, `value` is the worker index.
+    WOOMEM_TRACE_WORKER_BEGIN,
+    WOOMEM_TRACE_WORKER_END,
+    // More gray units were handed over between threads than ever before, and
+    // the gray queues grew by a block. `value` is the number of blocks now.
+    WOOMEM_TRACE_GRAY_QUEUE_OVERFLOW,
+    // A new chunk of `value` bytes could not be reserved.
+    WOOMEM_TRACE_CHUNK_RESERVE_FAILED,
+
+}woomem_TraceEventKind;
+
+typedef struct woomem_TraceEvent
+{
+    // steady_clock, in nanoseconds.
+    uint64_t timestamp_ns;
+    uint64_t value;
+    // Small id given to threads in the order they emit their first event.
+    uint32_t thread_id;
+    uint16_t kind;
+    // WOOMEM_GC_PHASE_COUNT if the event belongs to no phase.
+    uint16_t phase;
+
+}woomem_TraceEvent;
+
+// Called on the thread emitting the event, inside the GC. Must be short and
+// must not call into woomem.
+typedef void (*woomem_TraceCallback)(const woomem_TraceEvent*);
+
+// Starts tracing GC events into a ring buffer keeping the last
+// `event_capacity` events (rounded up to a power of 2), and/or passing each of
+// them to `callback`. Previous events are dropped. Both 0 and NULL stop
+// tracing. May be called at any time, also before woomem_init.
+bool woomem_set_trace(size_t event_capacity, woomem_TraceCallback callback);
+
+// Copies up to `max_count` of the latest buffered events, oldest first.
+// Events being written concurrently are skipped.
+size_t woomem_read_trace_events(woomem_TraceEvent* out_events, size_t max_count);
+
+// Writes the buffered events in Chrome trace event format, which
+// chrome://tracing and Perfetto (ui.perfetto.dev) open.
+bool woomem_write_trace_json(const char* path);
 
 void* woomem_allocate_begin(size_t size);
+
+// Registers the pointer layout of a type: `pointer_offsets` are the byte
+// offsets (multiples of sizeof(void*)) of the pointer slots in its first
+// `size` bytes. Returns WOOMEM_UNTYPED if the layout is invalid or too many
+// types are registered.
+woomem_TypeId woomem_register_type(
+    size_t size, const size_t* pointer_offsets, size_t pointer_count);
+
+// Units of a registered type are scanned precisely instead of word by word
+// (no WOOMEM_ATTRIB_AUTO_MARK needed): only the slots of its layout are
+// visited, and they must hold NULL or units. `size` must not be less than the
+// size of the type.
+void* woomem_allocate_begin_typed(size_t size, woomem_TypeId type_id);
 void woomem_allocate_end(void* p, int attrib);
 void woomem_allocate_end_as_root(void* p, int attrib);
+
+// Same as `count` calls of woomem_allocate_begin(size), units of a small size
+// are taken from the cached pages of the thread in one pass. Returns the
+// number of units stored into `out_units`, less than `count` only if out of
+// memory.
+size_t woomem_allocate_bulk(size_t size, size_t count, void** out_units);
+// Same as woomem_allocate_end for each of `units`, published with a single
+// fence.
+void woomem_allocate_end_bulk(void* const* units, size_t count, int attrib);
 void woomem_remove_from_root_set(void* p);
 
 // Donot reallocate a root, the old unit will not be released.
+// Unless a GC cycle is running, huge units are grown or shrunk in place if
+// possible. Otherwise the content is moved into a new unit, and unless a GC
+// cycle is running the old unit is released at once without its free
+// callback; `ptr` must not be used after, also not through other units.
+// Returns NULL and leaves `ptr` as is if `size` is less than the size of the
+// type of a typed unit.
 void* woomem_reallocate(void* ptr, size_t size);
 
+// Call after storing a pointer `new_value` (a unit or NULL) into the unit
+// `holder`, both as returned by woomem_allocate_begin. While
+// woomem_gc_marking_state_flag is set, `new_value` is shaded, so heap edges
+// changed during concurrent marking need no re-scan and
+// `gc_callback_at_stop_marking` only has to re-mark roots outside the heap.
+// Required for every such store if `gc_generational` is enabled.
+void woomem_write_barrier(void* holder, void* new_value);
+
 void* woomem_validate_addr(void* ptr_may_invalid);
 void* woomem_validate_addr_head(void* ptr_may_invalid);
 
@@ -6,42 +6,85 @@
 
 #include "woomem_page_unit_alloc.hpp"
 #include "woomem_gc.hpp"
+#include "woomem_type_layout.hpp"
+#include "woomem_trace.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <cstdlib>
 
 using namespace woomem;
 
-bool woomem_init(
-    size_t reserved_chunk_size,
-    woomem_GCCallback gc_callback_at_begin,
-    woomem_GCCallback gc_callback_at_stop_marking,
-    woomem_MarkCallback mark_callback,
-    woomem_FreeCallback free_callback,
-    woomem_GCMainThreadEntryCallback main_entry_callback,
-    woomem_GCWorkerThreadEntryCallback worker_entry_callback)
+// Huge units of at least this size are moved by remapping their pages.
+static constexpr size_t HUGE_UNIT_REMAP_MIN_SIZE = 1024 * 1024;
+
+// Moves the content of huge unit `from` into the larger huge unit `to`: all
+// but the first page of `from` are remapped, which leaves them reading as zero.
+static bool remap_huge_unit(UnitHead* from, UnitHead* to)
+{
+    PageHead* const from_page = get_page_of_unit(from);
+    PageHead* const to_page = get_page_of_unit(to);
+
+    assert(to->m_next_free_unit_granule == 0
+        && to_page->m_page_count_if_huge >= from_page->m_page_count_if_huge);
+
+    if (0 != woomem_os_remap_memory(
+        reinterpret_cast<char*>(from_page) + PageHead::NORMAL_PAGE_SIZE,
+        reinterpret_cast<char*>(to_page) + PageHead::NORMAL_PAGE_SIZE,
+        (from_page->m_page_count_if_huge - 1) * PageHead::NORMAL_PAGE_SIZE))
+        return false;
+
+    // Both units start at the same offset of their first page.
+    memcpy(static_cast<void*>(to + 1), static_cast<const void*>(from + 1),
+        PageHead::NORMAL_PAGE_SIZE - (sizeof(PageHead) + sizeof(UnitHead)));
+    return true;
+}
+
+bool woomem_init_with_config(const woomem_InitConfig* config)
 {
     assert(!g_global_context.m_globalcontext_inited && g_gc_ctx == nullptr);
-    if (g_global_context.init(reserved_chunk_size))
+
+    g_global_context.m_chunk_huge_page_backing = config->chunk_huge_page_backing;
+    g_global_context.m_numa_aware = config->numa_aware;
+    if (g_global_context.init(config->reserved_chunk_size))
     {
         g_gc_ctx = reinterpret_cast<GC*>(malloc(sizeof(GC)));
         if (g_gc_ctx != nullptr)
         {
-            (void)new (g_gc_ctx)GC(
-                0, 
-                gc_callback_at_begin, 
-                gc_callback_at_stop_marking, 
-                mark_callback, 
-                free_callback,
-                main_entry_callback,
-                worker_entry_callback);
+            (void)new (g_gc_ctx)GC(config);
             return true;
         }
         g_global_context.shutdown();
     }
     return false;
 }
+bool woomem_init(
+    size_t reserved_chunk_size,
+    woomem_GCCallback gc_callback_at_begin,
+    woomem_GCCallback gc_callback_at_stop_marking,
+    woomem_MarkCallback mark_callback,
+    woomem_FreeCallback free_callback,
+    woomem_GCMainThreadEntryCallback main_entry_callback,
+    woomem_GCWorkerThreadEntryCallback worker_entry_callback)
+{
+    woomem_InitConfig config = {};
+    config.reserved_chunk_size = reserved_chunk_size;
+    config.chunk_huge_page_backing = g_global_context.m_chunk_huge_page_backing;
+    config.gc_callback_at_begin = gc_callback_at_begin;
+    config.gc_callback_at_stop_marking = gc_callback_at_stop_marking;
+    config.mark_callback = mark_callback;
+    config.free_callback = free_callback;
+    config.main_entry_callback = main_entry_callback;
+    config.worker_entry_callback = worker_entry_callback;
+
+    return woomem_init_with_config(&config);
+}
+void woomem_set_chunk_huge_page_backing(bool enable)
+{
+    assert(!g_global_context.m_globalcontext_inited);
+    g_global_context.m_chunk_huge_page_backing = enable;
+}
 void woomem_shutdown(void)
 {
     g_gc_ctx->~GC();
@@ -52,24 +95,102 @@ void woomem_shutdown(void)
     g_gc_ctx = nullptr;
 }
 
+void woomem_get_stats(woomem_Stats* stats)
+{
+    assert(g_gc_ctx != nullptr);
+
+    stats->reserved_size = g_global_context.chunks().get_total_size();
+
+    const Chunk::Stats chunk_stats = g_global_context.chunks().get_stats();
+    stats->committed_size = chunk_stats.m_committed_size;
+    stats->free_run_count = chunk_stats.m_free_run_count;
+    stats->largest_free_run_size = chunk_stats.m_largest_free_run_size;
+
+    woomem_SizeClassStats size_classes[MAX_GROUP] = {};
+    for (size_t node = 0; node < g_global_context.numa_node_count(); ++node)
+        g_global_context.gpc(node).collect_span_stats(size_classes);
+
+    stats->size_class_count = MAX_GROUP;
+    for (size_t group = 0; group < MAX_GROUP && group < stats->size_class_capacity; ++group)
+    {
+        stats->size_classes[group] = size_classes[group];
+        stats->size_classes[group].unit_size = GROUP_SIZE_LOOKUP_TABLE[group];
+        stats->size_classes[group].span_page_count = GROUP_SPAN_PAGE_COUNT_LOOKUP_TABLE[group];
+    }
+
+    g_gc_ctx->collect_stats(stats);
+}
+
+bool woomem_set_trace(size_t event_capacity, woomem_TraceCallback callback)
+{
+    return g_tracer.set(event_capacity, callback);
+}
+size_t woomem_read_trace_events(woomem_TraceEvent* out_events, size_t max_count)
+{
+    return g_tracer.read(out_events, max_count);
+}
+bool woomem_write_trace_json(const char* path)
+{
+    return g_tracer.write_json(path);
+}
+
 // ======================================================================
 
 void woomem_trigger_gc(bool async)
 {
     assert(g_gc_ctx != nullptr);
-    g_gc_ctx->trigger_gc(async);
+    g_gc_ctx->trigger_gc(async, true);
+}
+void woomem_trigger_minor_gc(bool async)
+{
+    assert(g_gc_ctx != nullptr);
+    g_gc_ctx->trigger_gc(async, false);
+}
+void woomem_wait_for_sweep(void)
+{
+    assert(g_gc_ctx != nullptr);
+    g_gc_ctx->wait_for_sweep();
+}
+void woomem_set_gc_worker_count(size_t worker_count)
+{
+    assert(g_gc_ctx != nullptr);
+    g_gc_ctx->set_worker_count(worker_count);
+}
+size_t woomem_get_gc_worker_count(void)
+{
+    assert(g_gc_ctx != nullptr);
+    return g_gc_ctx->get_worker_count();
+}
+void woomem_set_purge_policy(size_t retained_dirty_size, size_t min_idle_gc_rounds)
+{
+    assert(g_gc_ctx != nullptr);
+    g_gc_ctx->m_purge_retained_dirty_size.store(
+        retained_dirty_size, std::memory_order_relaxed);
+    g_gc_ctx->m_purge_min_idle_rounds.store(
+        min_idle_gc_rounds, std::memory_order_relaxed);
+}
+void woomem_set_gc_pacer(
+    size_t heap_growth_percent, size_t soft_memory_limit, size_t gc_cpu_percent)
+{
+    assert(g_gc_ctx != nullptr);
+    g_gc_ctx->set_pacer_policy(heap_growth_percent, soft_memory_limit, gc_cpu_percent);
 }
 
 void* woomem_allocate_begin(size_t size)
 {
     assert(g_gc_ctx != nullptr);
-    g_gc_ctx->m_new_allocated_size_since_last_gc.fetch_add(size, std::memory_order_relaxed);
+
+    ThreadContext& thread_context = t_thread_context;
+    thread_context.record_allocated_size(size);
 
     if (size <= MAX_IN_PAGE_UNIT_SIZE)
     {
-        return t_thread_context.m_thread_page_collection.pick_unit_in_page(size);
+        return thread_context.m_thread_page_collection.pick_unit_in_page(size);
     }
 
+    // Huge units are rare and large, let the trigger see them at once.
+    thread_context.publish_allocated_size();
+
     PageHead* const huge_unit_page =
         g_global_context.allocate_huge_page(sizeof(PageHead) + sizeof(UnitHead) + size);
 
@@ -79,16 +200,35 @@ void* woomem_allocate_begin(size_t size)
     UnitHead* const huge_unit_head =
         reinterpret_cast<UnitHead*>(huge_unit_page + 1);
 
-    huge_unit_head->m_next_free_unit_offset = 0;
+    huge_unit_head->m_next_free_unit_granule = 0;
+    huge_unit_head->m_type_id = WOOMEM_UNTYPED;
     huge_unit_head->m_life.store(
         UnitLife::PENDING,
         // relaxed is enough, `m_page_just_allocated` will be set as release order.
         std::memory_order::memory_order_relaxed);
 
-    g_global_context.add_new_page_into_chain(huge_unit_page);
+    g_global_context.publish_new_page(huge_unit_page);
 
     return huge_unit_head + 1;
 }
+woomem_TypeId woomem_register_type(
+    size_t size, const size_t* pointer_offsets, size_t pointer_count)
+{
+    return g_type_layouts.register_type(size, pointer_offsets, pointer_count);
+}
+void* woomem_allocate_begin_typed(size_t size, woomem_TypeId type_id)
+{
+    assert(type_id != WOOMEM_UNTYPED
+        && g_type_layouts.get_layout(type_id) != nullptr
+        && size >= g_type_layouts.get_layout(type_id)->m_size);
+
+    void* const p = woomem_allocate_begin(size);
+    if (p != nullptr)
+        // NOTE: Units in free lists are always untyped, see `check_and_free_unmarked_unit`.
+        (reinterpret_cast<UnitHead*>(p) - 1)->m_type_id = type_id;
+
+    return p;
+}
 void woomem_allocate_end(void* p, int attrib)
 {
     UnitHead* const unit_head =
@@ -107,6 +247,46 @@ void woomem_allocate_end_as_root(void* p, int attrib)
     woomem::g_gc_ctx->register_root_unit_head(unit_head);
     woomem_allocate_end(p, attrib);
 }
+size_t woomem_allocate_bulk(size_t size, size_t count, void** out_units)
+{
+    assert(g_gc_ctx != nullptr);
+
+    if (size > MAX_IN_PAGE_UNIT_SIZE)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            out_units[i] = woomem_allocate_begin(size);
+            if (out_units[i] == nullptr)
+                return i;
+        }
+        return count;
+    }
+
+    ThreadContext& thread_context = t_thread_context;
+    thread_context.record_allocated_size(size * count);
+
+    return thread_context.m_thread_page_collection.pick_units_in_page(size, out_units, count);
+}
+void woomem_allocate_end_bulk(void* const* units, size_t count, int attrib)
+{
+    const uint8_t timing = woomem_gc_marking_round_counter;
+    for (size_t i = 0; i < count; ++i)
+    {
+        UnitHead* const unit_head =
+            reinterpret_cast<UnitHead*>(units[i]) - 1;
+
+        unit_head->m_age = 15;
+        unit_head->m_timing = timing;
+        unit_head->m_attribute = static_cast<uint8_t>(attrib);
+    }
+
+    // Orders the heads and the content of all units before their life stores.
+    std::atomic_thread_fence(std::memory_order::memory_order_release);
+
+    for (size_t i = 0; i < count; ++i)
+        (reinterpret_cast<UnitHead*>(units[i]) - 1)->m_life.store(
+            UnitLife::UNMARKED, std::memory_order::memory_order_relaxed);
+}
 
 void woomem_remove_from_root_set(void* p)
 {
@@ -123,9 +303,36 @@ void* woomem_reallocate(void* ptr, size_t size)
     UnitHead* const unit_head =
         reinterpret_cast<UnitHead*>(ptr) - 1;
 
+    // Workers scan every slot of the layout, the unit must keep all of them.
+    if (unit_head->m_type_id != WOOMEM_UNTYPED
+        && size < g_type_layouts.get_layout(unit_head->m_type_id)->m_size)
+        return nullptr;
+
     const size_t existed_unit_available_space = unit_head->get_unit_available_size();
+    const bool is_huge_unit = unit_head->m_next_free_unit_granule == 0;
+
+    if (is_huge_unit)
+    {
+        // Grow into the free pages right after the run, or give back the
+        // pages no longer needed. Workers size their scan of the unit by its
+        // page count, and freed tail pages may be handed out at once, so only
+        // while no cycle is running; the unit is moved otherwise.
+        if (g_gc_ctx->begin_eager_release())
+        {
+            const bool resized = g_global_context.chunks().resize_huge_page(
+                get_page_of_unit(unit_head), sizeof(PageHead) + sizeof(UnitHead) + size);
+            g_gc_ctx->end_eager_release();
 
-    if (size <= existed_unit_available_space)
+            if (resized)
+            {
+                if (size > existed_unit_available_space)
+                    t_thread_context.record_allocated_size(size - existed_unit_available_space);
+
+                return ptr;
+            }
+        }
+    }
+    else if (size <= existed_unit_available_space)
         // TODO: Need a suitable shrink strategy to reallocate 
         //      memory under certain circumstances.
         return ptr;
@@ -135,18 +342,70 @@ void* woomem_reallocate(void* ptr, size_t size)
     if (new_ptr == nullptr)
         return nullptr;
 
-    memcpy(new_ptr, ptr, existed_unit_available_space);
+    // Callers must not use `ptr` after this, see woomem.h. While no cycle is
+    // running no worker scans it either, so unless it is a root or not
+    // allocated completely the old unit is released right away, and the
+    // pages of a large huge unit are moved instead of copied.
+    const bool eager_release = g_gc_ctx->begin_eager_release();
+    const bool release_old_unit =
+        eager_release && g_gc_ctx->can_release_unit_eagerly(unit_head);
+
+    UnitHead* const new_unit_head = reinterpret_cast<UnitHead*>(new_ptr) - 1;
+    if (!(release_old_unit
+        && is_huge_unit
+        && existed_unit_available_space >= HUGE_UNIT_REMAP_MIN_SIZE
+        && size >= existed_unit_available_space
+        && remap_huge_unit(unit_head, new_unit_head)))
+    {
+        // Huge units being shrunk while a cycle is running get here too.
+        memcpy(new_ptr, ptr, std::min(existed_unit_available_space, size));
+    }
 
+    new_unit_head->m_type_id = unit_head->m_type_id;
     woomem_allocate_end(new_ptr, unit_head->m_attribute);
 
-    // TODO: A GC write barrier needs to be inserted after this point.
-    // NOTE: The old cells will be freed by the GC.
+    if (eager_release)
+    {
+        if (release_old_unit)
+            (void)g_gc_ctx->release_unit_eagerly(unit_head);
+        g_gc_ctx->end_eager_release();
+    }
+    // Units allocated while marking survive but are not scanned, shade the
+    // copy so the references moved into it are traced.
+    else if (woomem_gc_marking_state_flag)
+        woomem_mark_unit_head(new_ptr);
+
+    // NOTE: Otherwise the old cells will be freed by the GC.
     return new_ptr;
 }
 
+void woomem_write_barrier(void* holder, void* new_value)
+{
+    assert(g_gc_ctx != nullptr);
+
+    if (new_value == nullptr)
+        return;
+
+    if (woomem_gc_marking_state_flag)
+        // Dijkstra style: shade the new referent, so it cannot hide behind a
+        // holder which has been scanned already.
+        woomem_mark_unit_head(new_value);
+
+    if (!g_gc_ctx->m_gc_generational)
+        return;
+
+    UnitHead* const holder_head =
+        reinterpret_cast<UnitHead*>(holder) - 1;
+
+    // Young holders are traced by minor cycles anyway, and get their card
+    // dirtied once promoted.
+    if (is_old_unit(holder_head))
+        g_global_context.chunks().dirty_card(get_page_of_unit(holder_head));
+}
+
 void* woomem_validate_addr(void* ptr_may_invalid)
 {
-    PageHead* const page_head = g_global_context.chunk().validate(ptr_may_invalid);
+    PageHead* const page_head = g_global_context.chunks().validate(ptr_may_invalid);
     if (page_head != nullptr
         && !page_head->m_page_just_allocated.load(std::memory_order::memory_order_acquire))
     {
@@ -157,7 +416,7 @@ void* woomem_validate_addr(void* ptr_may_invalid)
                 reinterpret_cast<PageUnitAlloc*>(page_head + 1);
 
             const size_t unit_size_with_head =
-                page_alloc_head->m_unit_size_in_page + sizeof(UnitHead);
+                page_alloc_head->get_unit_size() + sizeof(UnitHead);
 
             const uintptr_t addr = reinterpret_cast<uintptr_t>(ptr_may_invalid);
             const uintptr_t storage_begin = reinterpret_cast<uintptr_t>(page_alloc_head + 1);
@@ -168,6 +427,13 @@ void* woomem_validate_addr(void* ptr_may_invalid)
             const size_t offset_in_units = addr - storage_begin;
             const size_t unit_index = offset_in_units / unit_size_with_head;
 
+            const size_t carved_unit_count =
+                (page_head->m_unit_high_water_granule.load(std::memory_order::memory_order_acquire)
+                    * UNIT_GRANULE_SIZE - sizeof(PageUnitAlloc)) / unit_size_with_head;
+
+            if (unit_index >= carved_unit_count)
+                return nullptr;
+
             unit_head = reinterpret_cast<UnitHead*>(
                 storage_begin + unit_index * unit_size_with_head);
         }
@@ -2,9 +2,16 @@
 
 #include "woomem_chunk.hpp"
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 #include <cassert>
+#include <mutex>
+#include <vector>
+
+#ifdef _MSC_VER
+#   include <intrin.h>
+#endif
 
 namespace woomem
 {
@@ -31,45 +38,107 @@ namespace woomem
             PageHead::NORMAL_PAGE_SIZE;
     }
 
-    Chunk::Chunk(size_t reserved_size)
+    Chunk::Chunk(size_t reserved_size, bool huge_page_backing, size_t numa_node)
         : base_(nullptr)
         , reserved_size_(0)
         , total_pages_(0)
         , count_(nullptr)
         , free_prev_(nullptr)
         , free_next_(nullptr)
-        , free_head_(INDEX_NULL)
+        , free_bin_head_{}
+        , free_bin_bitmap_(0)
         , commit_(nullptr)
+        , free_dirty_(nullptr)
+        , free_epoch_(nullptr)
+        , dirty_free_page_count_(0)
+        , epoch_(0)
+        , free_run_count_(0)
+        , free_page_count_(0)
+        , owner_(nullptr)
+        , mark_bitmap_(nullptr)
+        , root_bitmap_(nullptr)
+        , bitmap_section_size_(0)
+        , bitmap_commit_(nullptr)
+        , root_count_(nullptr)
+        , card_(nullptr)
+        , published_(nullptr)
     {
+        for (uint32_t& head : free_bin_head_)
+            head = INDEX_NULL;
+
         if (reserved_size == 0)
             return;
 
-        total_pages_ =
-            (reserved_size + PageHead::NORMAL_PAGE_SIZE - 1) /
-            PageHead::NORMAL_PAGE_SIZE;
-        reserved_size_ = total_pages_ * PageHead::NORMAL_PAGE_SIZE;
+        const size_t reserve_granularity =
+            huge_page_backing ? HUGE_PAGE_SIZE : PageHead::NORMAL_PAGE_SIZE;
+
+        reserved_size_ =
+            (reserved_size + reserve_granularity - 1) / reserve_granularity * reserve_granularity;
+        total_pages_ = reserved_size_ / PageHead::NORMAL_PAGE_SIZE;
+
+        if (numa_node != ANY_NUMA_NODE)
+            base_ = woomem_os_reserve_memory_on_numa_node(
+                reserved_size_, huge_page_backing ? HUGE_PAGE_SIZE : 0, numa_node);
 
-        base_ = woomem_os_reserve_memory(reserved_size_);
         if (!base_)
+            base_ = huge_page_backing
+                ? woomem_os_reserve_memory_aligned(reserved_size_, HUGE_PAGE_SIZE)
+                : woomem_os_reserve_memory(reserved_size_);
+
+        if (base_ && huge_page_backing)
+            // NOTE: Only a hint, failure just leaves normal pages.
+            (void)woomem_os_advise_huge_page(base_, reserved_size_);
+
+        if (!base_)
+        {
+            total_pages_ = 0;
+            reserved_size_ = 0;
+            return;
+        }
+
+        // The root bitmap follows the mark bitmap, both start on an OS page
+        // so that they are committed alike, see `commit_bitmaps`.
+        const size_t os_page_size = woomem_os_page_size();
+        bitmap_section_size_ =
+            (total_pages_ * MARK_BITMAP_SIZE_PER_PAGE + os_page_size - 1) / os_page_size * os_page_size;
+
+        void* const mark_bitmap = woomem_os_reserve_memory(2 * bitmap_section_size_);
+        if (mark_bitmap == nullptr)
         {
+            woomem_os_release_memory(base_, reserved_size_);
+            base_ = nullptr;
             total_pages_ = 0;
             reserved_size_ = 0;
+            bitmap_section_size_ = 0;
             return;
         }
+        mark_bitmap_ = static_cast<MarkBitmapWord*>(mark_bitmap);
+        root_bitmap_ = mark_bitmap_ + bitmap_section_size_ / sizeof(MarkBitmapWord);
+        bitmap_commit_ = new uint8_t[bitmap_section_size_ / os_page_size]();
 
         count_      = new uint32_t[total_pages_]();
         free_prev_  = new uint32_t[total_pages_];
         free_next_  = new uint32_t[total_pages_];
         commit_     = new uint8_t[total_pages_]();
+        free_dirty_ = new uint32_t[total_pages_];
+        free_epoch_ = new uint32_t[total_pages_];
+        owner_      = new std::atomic<uint32_t>[total_pages_];
+        card_       = new std::atomic<uint8_t>[total_pages_];
+        root_count_ = new std::atomic<uint32_t>[total_pages_];
+        published_  = new std::atomic<uint64_t>[(total_pages_ + 63) / 64];
 
         for (size_t i = 0; i < total_pages_; ++i)
         {
             free_prev_[i] = INDEX_NULL;
             free_next_[i] = INDEX_NULL;
+            owner_[i].store(INDEX_NULL, std::memory_order_relaxed);
+            card_[i].store(0, std::memory_order_relaxed);
+            root_count_[i].store(0, std::memory_order_relaxed);
         }
+        for (size_t i = 0; i < (total_pages_ + 63) / 64; ++i)
+            published_[i].store(0, std::memory_order_relaxed);
 
-        count_[0] = static_cast<uint32_t>(total_pages_);
-        free_head_ = 0;
+        free_list_push(0, static_cast<uint32_t>(total_pages_), 0, epoch_);
     }
 
     Chunk::~Chunk()
@@ -78,6 +147,17 @@ namespace woomem
         delete[] free_prev_;
         delete[] free_next_;
         delete[] commit_;
+        delete[] free_dirty_;
+        delete[] free_epoch_;
+        delete[] owner_;
+        delete[] card_;
+        delete[] root_count_;
+        delete[] published_;
+        delete[] bitmap_commit_;
+        if (mark_bitmap_)
+        {
+            woomem_os_release_memory(mark_bitmap_, 2 * bitmap_section_size_);
+        }
         if (base_)
         {
             woomem_os_release_memory(base_, reserved_size_);
@@ -89,15 +169,89 @@ namespace woomem
         return base_ == nullptr && total_pages_ == 0;
     }
 
-    PageHead* Chunk::commit_page(size_t idx)
+    uint32_t Chunk::commit_pages(uint32_t idx, uint32_t count)
+    {
+        // Every contiguous uncommitted part is committed by a single call.
+        // Returns the number of pages which were committed already.
+        uint32_t committed_already = 0;
+        for (uint32_t j = 0; j < count;)
+        {
+            if (commit_[idx + j])
+            {
+                ++committed_already;
+                ++j;
+                continue;
+            }
+
+            uint32_t end = j + 1;
+            while (end < count && !commit_[idx + end])
+                ++end;
+
+            woomem_os_commit_memory(
+                index_to_page(idx + j),
+                static_cast<size_t>(end - j) * PageHead::NORMAL_PAGE_SIZE);
+            memset(commit_ + idx + j, 1, end - j);
+            commit_bitmaps(idx + j, end - j);
+
+            j = end;
+        }
+        return committed_already;
+    }
+
+    void Chunk::commit_bitmaps(uint32_t idx, uint32_t count)
     {
-        PageHead* const p = index_to_page(idx);
-        if (!commit_[idx])
+        // Bitmap pages are shared by neighbor runs and never decommitted, the
+        // OS gives them zero-filled like the pages they cover.
+        const size_t os_page_size = woomem_os_page_size();
+        const size_t begin = idx * MARK_BITMAP_SIZE_PER_PAGE / os_page_size;
+        const size_t end =
+            ((idx + count) * MARK_BITMAP_SIZE_PER_PAGE + os_page_size - 1) / os_page_size;
+
+        for (size_t i = begin; i < end;)
         {
-            woomem_os_commit_memory(p, PageHead::NORMAL_PAGE_SIZE);
-            commit_[idx] = 1;
+            if (bitmap_commit_[i])
+            {
+                ++i;
+                continue;
+            }
+
+            size_t run_end = i + 1;
+            while (run_end < end && !bitmap_commit_[run_end])
+                ++run_end;
+
+            char* const mark_bitmap = reinterpret_cast<char*>(mark_bitmap_) + i * os_page_size;
+            const size_t size = (run_end - i) * os_page_size;
+            woomem_os_commit_memory(mark_bitmap, size);
+            woomem_os_commit_memory(mark_bitmap + bitmap_section_size_, size);
+            memset(bitmap_commit_ + i, 1, run_end - i);
+
+            i = run_end;
         }
-        return p;
+    }
+
+    static uint32_t floor_log2(uint32_t v)
+    {
+        assert(v != 0);
+#ifdef _MSC_VER
+        unsigned long r;
+        _BitScanReverse(&r, v);
+        return static_cast<uint32_t>(r);
+#else
+        return 31u - static_cast<uint32_t>(__builtin_clz(v));
+#endif
+    }
+
+    uint32_t Chunk::free_bin_of(uint32_t count)
+    {
+        assert(count != 0);
+        if (count <= FREE_BIN_EXACT_COUNT)
+            return count - 1;
+
+        const uint32_t log2 = floor_log2(count);
+        const uint32_t sub = (count >> (log2 - 2)) & 3;
+        const uint32_t bin = FREE_BIN_EXACT_COUNT + (log2 - 4) * 4 + sub;
+
+        return bin < FREE_BIN_COUNT ? bin : FREE_BIN_COUNT - 1;
     }
 
     void Chunk::free_list_remove(uint32_t idx)
@@ -108,117 +262,171 @@ namespace woomem
         if (prev != INDEX_NULL)
             free_next_[prev] = next;
         else
-            free_head_ = next;
+        {
+            const uint32_t bin = free_bin_of(count_[idx]);
+            free_bin_head_[bin] = next;
+            if (next == INDEX_NULL)
+                free_bin_bitmap_ &= ~(static_cast<uint64_t>(1) << bin);
+        }
 
         if (next != INDEX_NULL)
             free_prev_[next] = prev;
 
         free_prev_[idx] = INDEX_NULL;
         free_next_[idx] = INDEX_NULL;
+
+        --free_run_count_;
+        free_page_count_ -= count_[idx];
     }
 
-    void Chunk::free_list_insert(uint32_t idx, uint32_t count)
+    void Chunk::free_list_push(uint32_t idx, uint32_t count, uint32_t dirty, uint32_t epoch)
     {
-    restart:
-        uint32_t prev = INDEX_NULL;
-        uint32_t next = free_head_;
-        while (next != INDEX_NULL && next < idx)
-        {
-            prev = next;
-            next = free_next_[next];
-        }
+        count_[idx] = count;
+        count_[idx + count - 1] = count;
+        free_dirty_[idx] = dirty;
+        free_epoch_[idx] = epoch;
 
-        if (prev != INDEX_NULL)
+        const uint32_t bin = free_bin_of(count);
+        const uint32_t next = free_bin_head_[bin];
+
+        free_prev_[idx] = INDEX_NULL;
+        free_next_[idx] = next;
+        if (next != INDEX_NULL)
+            free_prev_[next] = idx;
+
+        free_bin_head_[bin] = idx;
+        free_bin_bitmap_ |= static_cast<uint64_t>(1) << bin;
+
+        ++free_run_count_;
+        free_page_count_ += count;
+    }
+
+    void Chunk::free_list_insert(uint32_t idx, uint32_t count, uint32_t dirty, uint32_t epoch)
+    {
+        // The merged run counts as idle since the latest of its parts was freed.
+        auto merge_epoch = [this, &epoch](uint32_t other)
+            {
+                if (epoch_ - other < epoch_ - epoch)
+                    epoch = other;
+            };
+
+        if (idx != 0)
         {
-            uint32_t prev_count = count_[prev];
-            if (prev + prev_count == idx)
+            const uint32_t prev_tag = count_[idx - 1];
+            if (!(prev_tag & ALLOCATED_FLAG))
             {
+                const uint32_t prev = idx - prev_tag;
+                dirty += free_dirty_[prev];
+                merge_epoch(free_epoch_[prev]);
+
                 free_list_remove(prev);
-                count = prev_count + count;
                 idx = prev;
-                goto restart;
+                count += prev_tag;
             }
         }
 
-        if (next != INDEX_NULL)
+        const size_t next = static_cast<size_t>(idx) + count;
+        if (next < total_pages_)
         {
-            uint32_t next_count = count_[next];
-            if (idx + count == next)
+            const uint32_t next_tag = count_[next];
+            if (!(next_tag & ALLOCATED_FLAG))
             {
-                free_list_remove(next);
-                count = count + next_count;
-                goto restart;
+                dirty += free_dirty_[next];
+                merge_epoch(free_epoch_[next]);
+
+                free_list_remove(static_cast<uint32_t>(next));
+                count += next_tag;
             }
         }
 
-        free_prev_[idx] = prev;
-        free_next_[idx] = next;
-
-        if (prev != INDEX_NULL)
-            free_next_[prev] = idx;
-        else
-            free_head_ = idx;
-
-        if (next != INDEX_NULL)
-            free_prev_[next] = idx;
-
-        count_[idx] = count;
+        free_list_push(idx, count, dirty, epoch);
     }
 
     uint32_t Chunk::free_list_find_block(uint32_t required) const
     {
-        uint32_t curr = free_head_;
-        while (curr != INDEX_NULL)
+        const uint32_t bin = free_bin_of(required);
+
+        // Runs in exact bins always fit; in a ranged bin they might be smaller
+        // than required, so prefer any non-empty bin above it.
+        const uint32_t first_fit_bin =
+            required <= FREE_BIN_EXACT_COUNT ? bin : bin + 1;
+
+        if (first_fit_bin < FREE_BIN_COUNT)
+        {
+            const uint64_t candidates =
+                free_bin_bitmap_ & (~static_cast<uint64_t>(0) << first_fit_bin);
+            if (candidates != 0)
+                return free_bin_head_[lowest_set_bit(candidates)];
+        }
+
+        if (first_fit_bin != bin)
         {
-            if ((count_[curr] & COUNT_MASK) >= required)
-                return curr;
-            curr = free_next_[curr];
+            for (uint32_t curr = free_bin_head_[bin];
+                curr != INDEX_NULL;
+                curr = free_next_[curr])
+            {
+                if (count_[curr] >= required)
+                    return curr;
+            }
         }
         return INDEX_NULL;
     }
 
     PageHead* Chunk::allocate_pages(uint32_t required_pages)
     {
-        ReadWriteSpinlock::WriteGuard guard(rwlock_);
+        std::lock_guard g(lock_);
 
         uint32_t idx = free_list_find_block(required_pages);
         if (idx == INDEX_NULL)
             return nullptr;
 
-        uint32_t block_count = count_[idx] & COUNT_MASK;
+        const uint32_t block_count = count_[idx];
+        const uint32_t block_dirty = free_dirty_[idx];
+        const uint32_t block_epoch = free_epoch_[idx];
 
         free_list_remove(idx);
 
+        const uint32_t taken_dirty = commit_pages(idx, required_pages);
+        dirty_free_page_count_ -= taken_dirty;
+
         if (block_count > required_pages)
         {
-            uint32_t left_idx = idx + required_pages;
-            uint32_t left_count = block_count - required_pages;
-
-            count_[left_idx] = left_count;
-            for (uint32_t j = 1; j < left_count; ++j)
-                count_[left_idx + j] = 0;
-
-            free_list_insert(left_idx, left_count);
+            // Both neighbors of the remainder are in use, no need to coalesce.
+            free_list_push(
+                idx + required_pages,
+                block_count - required_pages,
+                block_dirty - taken_dirty,
+                block_epoch);
         }
 
         count_[idx] = required_pages | ALLOCATED_FLAG;
-        for (uint32_t j = 1; j < required_pages; ++j)
-            count_[idx + j] = 0;
-
-        for (uint32_t j = 0; j < required_pages; ++j)
-            (void)commit_page(idx + j);
+        count_[idx + required_pages - 1] = required_pages | ALLOCATED_FLAG;
 
         PageHead* const page = index_to_page(idx);
         page->m_page_just_allocated.store(
             true, std::memory_order_relaxed);
+
+        // NOTE: Publish the owner after the page is committed and marked as just
+        //      allocated, `validate` read it with acquire order.
+        for (uint32_t j = 0; j < required_pages; ++j)
+            owner_[idx + j].store(idx, std::memory_order_release);
+
         return page;
     }
 
-    PageHead* Chunk::allocate_page()
+    PageHead* Chunk::allocate_page(size_t span_page_count)
     {
-        PageHead* page = allocate_pages(1);
+        assert(span_page_count != 0 && span_page_count <= UINT8_MAX);
+
+        if (span_page_count > total_pages_)
+            return nullptr;
+
+        PageHead* page = allocate_pages(static_cast<uint32_t>(span_page_count));
         if (page != nullptr)
+        {
             page->m_page_count_if_huge = 0;
+            page->m_span_page_count = static_cast<uint8_t>(span_page_count);
+        }
         return page;
     }
 
@@ -235,17 +443,104 @@ namespace woomem
 
         PageHead* page = allocate_pages(static_cast<uint32_t>(required_pages));
         if (page != nullptr)
+        {
             page->m_page_count_if_huge = required_pages;
+            page->m_span_page_count = 1;
+        }
         return page;
     }
 
+    bool Chunk::resize_huge_page(PageHead* page, size_t size)
+    {
+        assert(base_ != nullptr
+            && page != nullptr
+            && validate(page) == page
+            && page->m_page_count_if_huge != 0
+            && size != 0);
+
+        const size_t required_pages =
+            (size + PageHead::NORMAL_PAGE_SIZE - 1) /
+            PageHead::NORMAL_PAGE_SIZE;
+
+        if (required_pages > total_pages_)
+            return false;
+
+        std::lock_guard g(lock_);
+
+        const uint32_t idx = static_cast<uint32_t>(page_to_index(page));
+        const uint32_t count = count_[idx] & COUNT_MASK;
+        const uint32_t required = static_cast<uint32_t>(required_pages);
+
+        assert((count_[idx] & ALLOCATED_FLAG) && count == page->m_page_count_if_huge);
+
+        if (required == count)
+            return true;
+
+        if (required < count)
+        {
+            // Pages of allocated runs are always committed.
+            const uint32_t tail = idx + required;
+            const uint32_t tail_count = count - required;
+
+            for (uint32_t j = 0; j < tail_count; ++j)
+                owner_[tail + j].store(INDEX_NULL, std::memory_order_relaxed);
+
+            count_[idx] = required | ALLOCATED_FLAG;
+            count_[tail - 1] = required | ALLOCATED_FLAG;
+
+            dirty_free_page_count_ += tail_count;
+            free_list_insert(tail, tail_count, tail_count, epoch_);
+        }
+        else
+        {
+            const size_t next = static_cast<size_t>(idx) + count;
+            if (next >= total_pages_)
+                return false;
+
+            // Runs being purged are tagged as allocated, they are skipped too.
+            const uint32_t next_tag = count_[next];
+            if ((next_tag & ALLOCATED_FLAG) || count + next_tag < required)
+                return false;
+
+            const uint32_t taken = required - count;
+            const uint32_t block_dirty = free_dirty_[next];
+            const uint32_t block_epoch = free_epoch_[next];
+
+            free_list_remove(static_cast<uint32_t>(next));
+
+            const uint32_t taken_dirty = commit_pages(static_cast<uint32_t>(next), taken);
+            dirty_free_page_count_ -= taken_dirty;
+
+            if (next_tag > taken)
+            {
+                // The remainder is followed by an allocated run or the end.
+                free_list_push(
+                    static_cast<uint32_t>(next) + taken,
+                    next_tag - taken,
+                    block_dirty - taken_dirty,
+                    block_epoch);
+            }
+
+            count_[idx] = required | ALLOCATED_FLAG;
+            count_[idx + required - 1] = required | ALLOCATED_FLAG;
+
+            // NOTE: Same as `allocate_pages`, publish the owner after the pages
+            //      are committed.
+            for (uint32_t j = count; j < required; ++j)
+                owner_[idx + j].store(idx, std::memory_order_release);
+        }
+
+        page->m_page_count_if_huge = required_pages;
+        return true;
+    }
+
     void Chunk::free_page(PageHead* page)
     {
         assert(base_ != nullptr
             && page != nullptr
             && validate(page) == page);
 
-        ReadWriteSpinlock::WriteGuard guard(rwlock_);
+        std::lock_guard g(lock_);
 
         size_t idx = page_to_index(page);
         uint32_t c = count_[idx];
@@ -256,11 +551,91 @@ namespace woomem
         uint32_t block_count = c & COUNT_MASK;
 
         for (uint32_t j = 0; j < block_count; ++j)
-            count_[idx + j] = 0;
+            owner_[idx + j].store(INDEX_NULL, std::memory_order_relaxed);
+
+        card_[idx].store(0, std::memory_order_relaxed);
+        published_[idx / 64].fetch_and(
+            ~(static_cast<uint64_t>(1) << (idx % 64)), std::memory_order_relaxed);
+
+        // Root units are always alive, they must be removed before.
+        assert(root_count_[idx].load(std::memory_order_relaxed) == 0);
 
-        count_[idx] = block_count;
+        // Pages of allocated runs are always committed.
+        dirty_free_page_count_ += block_count;
 
-        free_list_insert(static_cast<uint32_t>(idx), block_count);
+        free_list_insert(static_cast<uint32_t>(idx), block_count, block_count, epoch_);
+    }
+
+    size_t Chunk::purge(size_t retained_dirty_size, uint32_t min_idle_epochs)
+    {
+        struct PurgingRun
+        {
+            uint32_t m_idx;
+            uint32_t m_count;
+            uint32_t m_dirty;
+            uint32_t m_epoch;
+        };
+        std::vector<PurgingRun> purging_runs;
+
+        do
+        {
+            std::lock_guard g(lock_);
+
+            ++epoch_;
+
+            const size_t retained_pages = retained_dirty_size / PageHead::NORMAL_PAGE_SIZE;
+            if (dirty_free_page_count_ <= retained_pages)
+                return 0;
+
+            size_t pages_to_purge = dirty_free_page_count_ - retained_pages;
+
+            // Larger runs first, they release more memory per syscall.
+            for (uint32_t bin = FREE_BIN_COUNT; bin-- > 0 && pages_to_purge != 0;)
+            {
+                for (uint32_t curr = free_bin_head_[bin];
+                    curr != INDEX_NULL && pages_to_purge != 0;)
+                {
+                    const uint32_t next = free_next_[curr];
+                    const uint32_t dirty = free_dirty_[curr];
+
+                    if (dirty != 0 && epoch_ - free_epoch_[curr] >= min_idle_epochs)
+                    {
+                        const uint32_t count = count_[curr];
+                        purging_runs.push_back(PurgingRun{ curr, count, dirty, free_epoch_[curr] });
+
+                        // Take the run out while the syscall is running, tag it as
+                        // allocated so freed neighbors do not merge into it.
+                        free_list_remove(curr);
+                        count_[curr] = count | ALLOCATED_FLAG;
+                        count_[curr + count - 1] = count | ALLOCATED_FLAG;
+
+                        dirty_free_page_count_ -= dirty;
+                        pages_to_purge -= dirty < pages_to_purge ? dirty : pages_to_purge;
+                    }
+                    curr = next;
+                }
+            }
+        } while (0);
+
+        size_t purged_size = 0;
+        for (PurgingRun& run : purging_runs)
+        {
+            const size_t run_size = static_cast<size_t>(run.m_count) * PageHead::NORMAL_PAGE_SIZE;
+            if (0 == woomem_os_decommit_memory(index_to_page(run.m_idx), run_size))
+            {
+                memset(commit_ + run.m_idx, 0, run.m_count);
+                purged_size += static_cast<size_t>(run.m_dirty) * PageHead::NORMAL_PAGE_SIZE;
+                run.m_dirty = 0;
+            }
+        }
+
+        std::lock_guard g(lock_);
+        for (const PurgingRun& run : purging_runs)
+        {
+            dirty_free_page_count_ += run.m_dirty;
+            free_list_insert(run.m_idx, run.m_count, run.m_dirty, run.m_epoch);
+        }
+        return purged_size;
     }
 
     PageHead* Chunk::validate(void* ptr)
@@ -275,26 +650,39 @@ namespace woomem
 
         size_t idx = (addr - base_addr) / PageHead::NORMAL_PAGE_SIZE;
 
-        ReadWriteSpinlock::ReadGuard guard(rwlock_);
+        const uint32_t head_idx = owner_[idx].load(std::memory_order_acquire);
+        if (head_idx == INDEX_NULL)
+            return nullptr;
 
-        size_t head_idx = idx;
-        while (count_[head_idx] == 0)
-        {
-            if (head_idx == 0)
-                return nullptr;
-            --head_idx;
-        }
+        return index_to_page(head_idx);
+    }
 
-        uint32_t c = count_[head_idx];
+    void Chunk::publish_page(PageHead* page)
+    {
+        assert(published_ != nullptr && owner_[page_to_index(page)].load(
+            std::memory_order_relaxed) == page_to_index(page));
 
-        if ((c & ALLOCATED_FLAG) == 0)
-            return nullptr;
+        const size_t idx = page_to_index(page);
 
-        uint32_t block_count = c & COUNT_MASK;
-        if (idx >= head_idx + block_count)
-            return nullptr;
+        // Pairs with `collect_published_pages`, the page head is written.
+        published_[idx / 64].fetch_or(
+            static_cast<uint64_t>(1) << (idx % 64), std::memory_order_release);
+    }
 
-        return index_to_page(head_idx);
+    void Chunk::collect_published_pages(std::vector<PageHead*>& out_pages) const
+    {
+        const size_t word_count = (total_pages_ + 63) / 64;
+        for (size_t i = 0; i < word_count; ++i)
+        {
+            for (uint64_t word = published_[i].load(std::memory_order_acquire);
+                word != 0; word &= word - 1)
+                out_pages.push_back(index_to_page(i * 64 + lowest_set_bit(word)));
+        }
+    }
+
+    void* Chunk::get_base_address() const
+    {
+        return base_;
     }
 
     size_t Chunk::get_total_size() const
@@ -306,4 +694,109 @@ namespace woomem
     {
         return total_pages_;
     }
+
+    MarkBitmapWord* Chunk::get_mark_bitmap(PageHead* page) const
+    {
+        assert(mark_bitmap_ != nullptr && page_to_index(page) < total_pages_);
+        return mark_bitmap_ + page_to_index(page) * MARK_BITMAP_WORDS_PER_PAGE;
+    }
+
+    bool Chunk::add_root(PageHead* page, size_t first_granule)
+    {
+        assert(root_bitmap_ != nullptr && owner_[page_to_index(page)].load(
+            std::memory_order_relaxed) == page_to_index(page));
+
+        const size_t idx = page_to_index(page);
+        if (!mark_bitmap_try_set(
+            root_bitmap_ + idx * MARK_BITMAP_WORDS_PER_PAGE, first_granule))
+            return false;
+
+        root_count_[idx].fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool Chunk::remove_root(PageHead* page, size_t first_granule)
+    {
+        assert(root_bitmap_ != nullptr && owner_[page_to_index(page)].load(
+            std::memory_order_relaxed) == page_to_index(page));
+
+        const size_t idx = page_to_index(page);
+        if (!mark_bitmap_try_reset(
+            root_bitmap_ + idx * MARK_BITMAP_WORDS_PER_PAGE, first_granule))
+            return false;
+
+        root_count_[idx].fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void Chunk::collect_root_pages(std::vector<PageHead*>& out_pages) const
+    {
+        for (size_t idx = 0; idx < total_pages_; ++idx)
+        {
+            if (root_count_[idx].load(std::memory_order_relaxed) != 0)
+                out_pages.push_back(index_to_page(idx));
+        }
+    }
+
+    const MarkBitmapWord* Chunk::get_root_bitmap(PageHead* page) const
+    {
+        assert(root_bitmap_ != nullptr && page_to_index(page) < total_pages_);
+        return root_bitmap_ + page_to_index(page) * MARK_BITMAP_WORDS_PER_PAGE;
+    }
+
+    void Chunk::dirty_card(PageHead* page)
+    {
+        assert(card_ != nullptr && page_to_index(page) < total_pages_);
+
+        std::atomic<uint8_t>& card = card_[page_to_index(page)];
+        if (card.load(std::memory_order_relaxed) == 0)
+            card.store(1, std::memory_order_relaxed);
+    }
+
+    void Chunk::collect_dirty_cards(std::vector<PageHead*>& out_pages)
+    {
+        for (size_t idx = 0; idx < total_pages_; ++idx)
+        {
+            if (card_[idx].load(std::memory_order_relaxed) == 0
+                || card_[idx].exchange(0, std::memory_order_relaxed) == 0)
+                continue;
+
+            // Cards of freed runs are cleaned in `free_page`, only keep runs
+            // which are still allocated in case this races with it.
+            if (owner_[idx].load(std::memory_order_acquire) == idx)
+                out_pages.push_back(index_to_page(idx));
+        }
+    }
+
+    size_t Chunk::get_dirty_free_size()
+    {
+        std::lock_guard g(lock_);
+        return dirty_free_page_count_ * PageHead::NORMAL_PAGE_SIZE;
+    }
+
+    Chunk::Stats Chunk::get_stats()
+    {
+        std::lock_guard g(lock_);
+
+        Stats stats;
+        // Pages of allocated runs are always committed.
+        stats.m_committed_size =
+            (total_pages_ - free_page_count_ + dirty_free_page_count_) * PageHead::NORMAL_PAGE_SIZE;
+        stats.m_free_run_count = free_run_count_;
+
+        uint32_t largest_free_run = 0;
+        if (free_bin_bitmap_ != 0)
+        {
+            uint32_t bin = FREE_BIN_COUNT - 1;
+            while (!(free_bin_bitmap_ & (static_cast<uint64_t>(1) << bin)))
+                --bin;
+
+            for (uint32_t curr = free_bin_head_[bin]; curr != INDEX_NULL; curr = free_next_[curr])
+                largest_free_run = std::max(largest_free_run, count_[curr]);
+        }
+        stats.m_largest_free_run_size =
+            static_cast<size_t>(largest_free_run) * PageHead::NORMAL_PAGE_SIZE;
+
+        return stats;
+    }
 }
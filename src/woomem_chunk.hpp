@@ -1,17 +1,26 @@
 #pragma once
 
 #include "woomem_page.hpp"
-#include "woomem_rwlock.hpp"
+#include "woomem_lock.hpp"
+#include "woomem_mark_bitmap.hpp"
 
+#include <atomic>
 #include <cstdint>
 #include <cstddef>
+#include <vector>
 
 namespace woomem
 {
     class Chunk
     {
     public:
-        Chunk(size_t reserved_size);
+        static constexpr size_t ANY_NUMA_NODE = SIZE_MAX;
+
+        // With `huge_page_backing`, the reservation is aligned and rounded to
+        // HUGE_PAGE_SIZE and the OS is asked to back it with huge pages. With
+        // a `numa_node`, pages prefer that node once committed if the OS can
+        // tell, the chunk is reserved without a node otherwise.
+        Chunk(size_t reserved_size, bool huge_page_backing = false, size_t numa_node = ANY_NUMA_NODE);
         ~Chunk();
 
         Chunk(const Chunk&) = delete;
@@ -21,29 +30,92 @@ namespace woomem
 
         bool is_init_failed() const;
 
-        PageHead* allocate_page();
+        // A run of `span_page_count` pages for units, see `m_span_page_count`.
+        PageHead* allocate_page(size_t span_page_count = 1);
         PageHead* allocate_huge_page(size_t size);
         void free_page(PageHead* page);
 
+        // Resizes the huge run `page` in place to hold `size` bytes: it grows
+        // into the free run right after it, or gives its trailing pages back.
+        // Returns false if it cannot grow, `page` is left unchanged then.
+        bool resize_huge_page(PageHead* page, size_t size);
+
         PageHead* validate(void* ptr);
 
+        // Published runs are enumerated by the GC: `page` must be the head
+        // page of an allocated run of this chunk, it is unpublished when freed.
+        void publish_page(PageHead* page);
+        // Appends the head pages of all published runs in address order.
+        void collect_published_pages(std::vector<PageHead*>& out_pages) const;
+
+        // `page` must be a page of this chunk, see woomem_mark_bitmap.hpp.
+        MarkBitmapWord* get_mark_bitmap(PageHead* page) const;
+
+        // Root units, one bit per granule like the mark bitmap, and a count of
+        // roots per run so that `collect_root_pages` skips runs without any.
+        // `page` must be the head page of an allocated run of this chunk.
+        // Returns false if the bit was already in the requested state.
+        bool add_root(PageHead* page, size_t first_granule);
+        bool remove_root(PageHead* page, size_t first_granule);
+        void collect_root_pages(std::vector<PageHead*>& out_pages) const;
+        const MarkBitmapWord* get_root_bitmap(PageHead* page) const;
+
+        // Card table, one card per run: `page` must be the head page of an
+        // allocated run of this chunk.
+        void dirty_card(PageHead* page);
+        // Clean all dirty cards, appending the head pages of runs which are
+        // still allocated to `out_pages`.
+        void collect_dirty_cards(std::vector<PageHead*>& out_pages);
+
+        // Advance the idle epoch, then decommit free runs which have not been
+        // touched for `min_idle_epochs` epochs until no more than
+        // `retained_dirty_size` bytes of committed free pages remain.
+        // Returns the decommitted size in bytes.
+        size_t purge(size_t retained_dirty_size, uint32_t min_idle_epochs);
+
+        void* get_base_address() const;
         size_t get_total_size() const;
         size_t get_total_page_count() const;
+        size_t get_dirty_free_size();
+
+        // Sizes in bytes. Free runs being purged count as committed.
+        struct Stats
+        {
+            size_t m_committed_size;
+            size_t m_free_run_count;
+            size_t m_largest_free_run_size;
+        };
+        // Taken under the lock, only the runs of the highest non-empty bin
+        // are visited.
+        Stats get_stats();
+
+        static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
 
     private:
         static constexpr uint32_t INDEX_NULL       = UINT32_MAX;
         static constexpr uint32_t ALLOCATED_FLAG   = 0x80000000u;
         static constexpr uint32_t COUNT_MASK       = 0x7FFFFFFFu;
 
+        // Free runs are binned by page count: runs of 1~16 pages get exact bins,
+        // larger runs are split into 4 sub-bins per power of two, everything
+        // from 2^15 + 3 * 2^13 pages on shares the last bin.
+        static constexpr uint32_t FREE_BIN_EXACT_COUNT  = 16;
+        static constexpr uint32_t FREE_BIN_COUNT        = 64;
+
+        static uint32_t free_bin_of(uint32_t count);
+
         size_t page_to_index(PageHead* page) const;
         PageHead* index_to_page(size_t idx) const;
         size_t addr_to_index(void* ptr) const;
 
-        PageHead* commit_page(size_t idx);
+        uint32_t commit_pages(uint32_t idx, uint32_t count);
+        // Commits the mark and root bitmaps of pages [idx, idx + count).
+        void commit_bitmaps(uint32_t idx, uint32_t count);
 
         PageHead* allocate_pages(uint32_t required_pages);
 
-        void free_list_insert(uint32_t idx, uint32_t count);
+        void free_list_push(uint32_t idx, uint32_t count, uint32_t dirty, uint32_t epoch);
+        void free_list_insert(uint32_t idx, uint32_t count, uint32_t dirty, uint32_t epoch);
         void free_list_remove(uint32_t idx);
 
         uint32_t free_list_find_block(uint32_t required) const;
@@ -52,12 +124,55 @@ namespace woomem
         size_t      reserved_size_;
         size_t      total_pages_;
 
+        // Boundary tags: both the first and the last page of every run store
+        // the run's page count (with ALLOCATED_FLAG if in use), so neighbors
+        // can be found in O(1) when coalescing.
         uint32_t*   count_;
         uint32_t*   free_prev_;
         uint32_t*   free_next_;
-        uint32_t    free_head_;
+        uint32_t    free_bin_head_[FREE_BIN_COUNT];
+        uint64_t    free_bin_bitmap_;
         uint8_t*    commit_;
 
-        ReadWriteSpinlock rwlock_;
+        // Per free run, indexed by its head: committed page count and the
+        // epoch it was last freed in.
+        uint32_t*   free_dirty_;
+        uint32_t*   free_epoch_;
+        size_t      dirty_free_page_count_;
+        uint32_t    epoch_;
+
+        // Runs in the free lists and their pages in total.
+        size_t      free_run_count_;
+        size_t      free_page_count_;
+
+        // Head index of the allocated run each page belongs to, INDEX_NULL if
+        // the page is free. Written under `lock_`, read by `validate` without
+        // any lock.
+        std::atomic<uint32_t>* owner_;
+
+        // MARK_BITMAP_WORDS_PER_PAGE words per page, zero-filled by the OS and
+        // only touched for pages used by normal units.
+        MarkBitmapWord* mark_bitmap_;
+
+        // Laid out like `mark_bitmap_` in the same reservation,
+        // `bitmap_section_size_` bytes after it.
+        MarkBitmapWord* root_bitmap_;
+        // The bitmaps are committed along with the pages they cover, an OS
+        // page at a time. One flag per OS page of `mark_bitmap_`, standing for
+        // the same range of `root_bitmap_` too.
+        size_t      bitmap_section_size_;
+        uint8_t*    bitmap_commit_;
+        // Indexed by run head, updated together with `root_bitmap_`.
+        std::atomic<uint32_t>* root_count_;
+
+        // Indexed by run head, set by write barriers without any lock and
+        // cleaned by the GC or when the run is freed.
+        std::atomic<uint8_t>* card_;
+
+        // One bit per run head, set once the run is published and reset when
+        // it is freed.
+        std::atomic<uint64_t>* published_;
+
+        Spinlock    lock_;
     };
 }
@@ -0,0 +1,376 @@
+#include "woomem_chunk_registry.hpp"
+#include "woomem_trace.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace woomem
+{
+    ChunkRegistry::ChunkRegistry(size_t initial_chunk_size, bool huge_page_backing, size_t numa_node_count)
+        : m_numa_node_count(std::max<size_t>(numa_node_count, 1))
+        , m_ranges(nullptr)
+        , m_allocating_chunk_hints(m_numa_node_count)
+        , m_next_chunk_size(std::min(initial_chunk_size * 2, MAX_GROWING_CHUNK_SIZE))
+        , m_huge_page_backing(huge_page_backing)
+    {
+        m_ranges.store(new ChunkRangeTable{}, std::memory_order_relaxed);
+
+        for (size_t node = 0; node < m_numa_node_count; ++node)
+        {
+            Chunk* const chunk = reserve_chunk_locked(initial_chunk_size, node);
+            if (chunk == nullptr)
+            {
+                for (Chunk* reserved_chunk : m_chunks)
+                    delete reserved_chunk;
+                m_chunks.clear();
+                return;
+            }
+            (void)publish_chunk_locked(chunk, node);
+        }
+    }
+
+    ChunkRegistry::~ChunkRegistry()
+    {
+        for (const ChunkRangeTable* ranges : m_retired_ranges)
+            delete ranges;
+        delete m_ranges.load(std::memory_order_relaxed);
+
+        for (Chunk* chunk : m_chunks)
+            delete chunk;
+    }
+
+    bool ChunkRegistry::is_init_failed() const
+    {
+        return m_chunks.empty();
+    }
+
+    Chunk* ChunkRegistry::reserve_chunk_locked(size_t chunk_size, size_t numa_node)
+    {
+        Chunk* const chunk = new Chunk(
+            chunk_size,
+            m_huge_page_backing,
+            m_numa_node_count > 1 ? numa_node : Chunk::ANY_NUMA_NODE);
+        if (chunk->is_init_failed())
+        {
+            delete chunk;
+            return nullptr;
+        }
+        m_chunks.push_back(chunk);
+        return chunk;
+    }
+
+    size_t ChunkRegistry::publish_chunk_locked(Chunk* chunk, size_t numa_node)
+    {
+        const ChunkRangeTable* const old_ranges = m_ranges.load(std::memory_order_relaxed);
+        ChunkRangeTable* const new_ranges = new ChunkRangeTable(*old_ranges);
+
+        const ChunkRange range{
+            reinterpret_cast<uintptr_t>(chunk->get_base_address()),
+            reinterpret_cast<uintptr_t>(chunk->get_base_address()) + chunk->get_total_size(),
+            chunk,
+            numa_node };
+
+        const auto insert_at = std::upper_bound(
+            new_ranges->begin(), new_ranges->end(), range,
+            [](const ChunkRange& a, const ChunkRange& b) { return a.m_begin < b.m_begin; });
+
+        const size_t index = static_cast<size_t>(insert_at - new_ranges->begin());
+        new_ranges->insert(insert_at, range);
+
+        m_retired_ranges.push_back(old_ranges);
+        m_ranges.store(new_ranges, std::memory_order_release);
+
+        return index;
+    }
+
+    template<typename AllocateFunc>
+    PageHead* ChunkRegistry::allocate_from_chunks(size_t required_size, size_t numa_node, AllocateFunc&& allocate)
+    {
+        assert(numa_node < m_numa_node_count);
+
+        std::atomic<size_t>& hint_slot = m_allocating_chunk_hints[numa_node];
+
+        auto try_chunks_of_node = [&](const ChunkRangeTable& ranges) -> PageHead*
+        {
+            const size_t chunk_count = ranges.size();
+            const size_t hint = hint_slot.load(std::memory_order_relaxed) % chunk_count;
+
+            for (size_t i = 0; i < chunk_count; ++i)
+            {
+                const size_t idx = (hint + i) % chunk_count;
+                if (ranges[idx].m_numa_node != numa_node)
+                    continue;
+
+                PageHead* const page = allocate(ranges[idx].m_chunk);
+                if (page != nullptr)
+                {
+                    if (idx != hint)
+                        hint_slot.store(idx, std::memory_order_relaxed);
+                    return page;
+                }
+            }
+            return nullptr;
+        };
+
+        const ChunkRangeTable* const ranges = m_ranges.load(std::memory_order_acquire);
+        if (PageHead* const page = try_chunks_of_node(*ranges))
+            return page;
+
+        std::lock_guard g(m_grow_mx);
+
+        // Another thread might have grown the heap just now.
+        const ChunkRangeTable* const current_ranges = m_ranges.load(std::memory_order_relaxed);
+        if (ranges != current_ranges)
+        {
+            if (PageHead* const page = try_chunks_of_node(*current_ranges))
+                return page;
+        }
+
+        const size_t chunk_size = std::max(m_next_chunk_size, required_size);
+        Chunk* const chunk = reserve_chunk_locked(chunk_size, numa_node);
+        if (chunk == nullptr)
+        {
+            trace_event(WOOMEM_TRACE_CHUNK_RESERVE_FAILED, WOOMEM_GC_PHASE_COUNT, chunk_size);
+
+            // Out of address space, memory of another node is better than none.
+            for (const ChunkRange& range : *current_ranges)
+            {
+                if (range.m_numa_node == numa_node)
+                    continue;
+
+                if (PageHead* const page = allocate(range.m_chunk))
+                    return page;
+            }
+            return nullptr;
+        }
+
+        if (m_next_chunk_size < MAX_GROWING_CHUNK_SIZE)
+            m_next_chunk_size = std::min(m_next_chunk_size * 2, MAX_GROWING_CHUNK_SIZE);
+
+        // NOTE: Allocate before publishing, the new chunk has room for this
+        //      request and nobody else can see it yet.
+        PageHead* const page = allocate(chunk);
+        assert(page != nullptr);
+
+        hint_slot.store(publish_chunk_locked(chunk, numa_node), std::memory_order_relaxed);
+
+        return page;
+    }
+
+    PageHead* ChunkRegistry::allocate_page(size_t span_page_count, size_t numa_node)
+    {
+        return allocate_from_chunks(
+            span_page_count * PageHead::NORMAL_PAGE_SIZE,
+            numa_node,
+            [span_page_count](Chunk* chunk) { return chunk->allocate_page(span_page_count); });
+    }
+
+    PageHead* ChunkRegistry::allocate_huge_page(size_t size, size_t numa_node)
+    {
+        return allocate_from_chunks(
+            size,
+            numa_node,
+            [size](Chunk* chunk) { return chunk->allocate_huge_page(size); });
+    }
+
+    void ChunkRegistry::free_page(PageHead* page)
+    {
+        Chunk* const chunk = find_chunk(page);
+        assert(chunk != nullptr);
+
+        chunk->free_page(page);
+    }
+
+    bool ChunkRegistry::resize_huge_page(PageHead* page, size_t size) const
+    {
+        Chunk* const chunk = find_chunk(page);
+        assert(chunk != nullptr);
+
+        return chunk->resize_huge_page(page, size);
+    }
+
+    const ChunkRegistry::ChunkRange* ChunkRegistry::find_range(void* ptr) const
+    {
+        const ChunkRangeTable& ranges = *m_ranges.load(std::memory_order_acquire);
+        const uintptr_t addr = reinterpret_cast<uintptr_t>(ptr);
+
+        // Find the first range which ends after `addr`.
+        size_t lo = 0, hi = ranges.size();
+        while (lo < hi)
+        {
+            const size_t mid = (lo + hi) / 2;
+            if (ranges[mid].m_end <= addr)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+
+        if (lo < ranges.size() && ranges[lo].m_begin <= addr)
+            return &ranges[lo];
+
+        return nullptr;
+    }
+
+    Chunk* ChunkRegistry::find_chunk(void* ptr) const
+    {
+        const ChunkRange* const range = find_range(ptr);
+        return range != nullptr ? range->m_chunk : nullptr;
+    }
+
+    size_t ChunkRegistry::get_numa_node(void* ptr) const
+    {
+        const ChunkRange* const range = find_range(ptr);
+        assert(range != nullptr);
+
+        return range->m_numa_node;
+    }
+
+    PageHead* ChunkRegistry::validate(void* ptr) const
+    {
+        Chunk* const chunk = find_chunk(ptr);
+        if (chunk == nullptr)
+            return nullptr;
+
+        return chunk->validate(ptr);
+    }
+
+    MarkBitmapWord* ChunkRegistry::get_mark_bitmap(PageHead* page) const
+    {
+        Chunk* const chunk = find_chunk(page);
+        assert(chunk != nullptr);
+
+        return chunk->get_mark_bitmap(page);
+    }
+
+    bool ChunkRegistry::add_root(PageHead* page, size_t first_granule) const
+    {
+        Chunk* const chunk = find_chunk(page);
+        assert(chunk != nullptr);
+
+        return chunk->add_root(page, first_granule);
+    }
+
+    bool ChunkRegistry::remove_root(PageHead* page, size_t first_granule) const
+    {
+        Chunk* const chunk = find_chunk(page);
+        assert(chunk != nullptr);
+
+        return chunk->remove_root(page, first_granule);
+    }
+
+    void ChunkRegistry::collect_root_pages(std::vector<PageHead*>& out_pages) const
+    {
+        const ChunkRangeTable& ranges = *m_ranges.load(std::memory_order_acquire);
+        for (const ChunkRange& range : ranges)
+            range.m_chunk->collect_root_pages(out_pages);
+    }
+
+    const MarkBitmapWord* ChunkRegistry::get_root_bitmap(PageHead* page) const
+    {
+        Chunk* const chunk = find_chunk(page);
+        assert(chunk != nullptr);
+
+        return chunk->get_root_bitmap(page);
+    }
+
+    void ChunkRegistry::publish_page(PageHead* page) const
+    {
+        Chunk* const chunk = find_chunk(page);
+        assert(chunk != nullptr);
+
+        chunk->publish_page(page);
+    }
+
+    void ChunkRegistry::collect_published_pages(std::vector<PageHead*>& out_pages) const
+    {
+        // Ranges are sorted by address.
+        const ChunkRangeTable& ranges = *m_ranges.load(std::memory_order_acquire);
+        for (const ChunkRange& range : ranges)
+            range.m_chunk->collect_published_pages(out_pages);
+    }
+
+    void ChunkRegistry::collect_published_pages(std::vector<PageHead*>& out_pages, size_t numa_node) const
+    {
+        const ChunkRangeTable& ranges = *m_ranges.load(std::memory_order_acquire);
+        for (const ChunkRange& range : ranges)
+        {
+            if (range.m_numa_node == numa_node)
+                range.m_chunk->collect_published_pages(out_pages);
+        }
+    }
+
+    void ChunkRegistry::dirty_card(PageHead* page) const
+    {
+        Chunk* const chunk = find_chunk(page);
+        assert(chunk != nullptr);
+
+        chunk->dirty_card(page);
+    }
+
+    void ChunkRegistry::collect_dirty_cards(std::vector<PageHead*>& out_pages) const
+    {
+        const ChunkRangeTable& ranges = *m_ranges.load(std::memory_order_acquire);
+        for (const ChunkRange& range : ranges)
+            range.m_chunk->collect_dirty_cards(out_pages);
+    }
+
+    size_t ChunkRegistry::purge(size_t retained_dirty_size, uint32_t min_idle_epochs)
+    {
+        const ChunkRangeTable& ranges = *m_ranges.load(std::memory_order_acquire);
+
+        size_t total_dirty_size = 0;
+        for (const ChunkRange& range : ranges)
+            total_dirty_size += range.m_chunk->get_dirty_free_size();
+
+        size_t size_to_purge =
+            total_dirty_size > retained_dirty_size ? total_dirty_size - retained_dirty_size : 0;
+
+        size_t purged_size = 0;
+        for (const ChunkRange& range : ranges)
+        {
+            // NOTE: Call purge for every chunk even if nothing is to be purged,
+            //      to advance its idle epoch.
+            const size_t dirty_size = range.m_chunk->get_dirty_free_size();
+            const size_t purge_here = std::min(dirty_size, size_to_purge);
+
+            const size_t purged = range.m_chunk->purge(dirty_size - purge_here, min_idle_epochs);
+
+            purged_size += purged;
+            size_to_purge -= std::min(purged, size_to_purge);
+        }
+        return purged_size;
+    }
+
+    Chunk::Stats ChunkRegistry::get_stats() const
+    {
+        Chunk::Stats total_stats{};
+        for (const ChunkRange& range : *m_ranges.load(std::memory_order_acquire))
+        {
+            const Chunk::Stats stats = range.m_chunk->get_stats();
+
+            total_stats.m_committed_size += stats.m_committed_size;
+            total_stats.m_free_run_count += stats.m_free_run_count;
+            total_stats.m_largest_free_run_size =
+                std::max(total_stats.m_largest_free_run_size, stats.m_largest_free_run_size);
+        }
+        return total_stats;
+    }
+
+    size_t ChunkRegistry::get_chunk_count() const
+    {
+        return m_ranges.load(std::memory_order_acquire)->size();
+    }
+
+    size_t ChunkRegistry::get_total_size() const
+    {
+        size_t total_size = 0;
+        for (const ChunkRange& range : *m_ranges.load(std::memory_order_acquire))
+            total_size += range.m_chunk->get_total_size();
+        return total_size;
+    }
+
+    size_t ChunkRegistry::get_numa_node_count() const
+    {
+        return m_numa_node_count;
+    }
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "woomem_chunk.hpp"
+#include "woomem_page.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace woomem
+{
+    /*
+    All chunks of the heap. It starts with a single chunk and reserves a new
+    one whenever none of the existing chunks can serve an allocation.
+
+    Chunks are never released before the registry is destroyed, so the
+    address ranges only grow. Readers find the owning chunk in an immutable,
+    address-sorted range table published through an atomic pointer; replaced
+    tables are kept until destruction since readers never take a lock.
+
+    With more than one NUMA node, every chunk belongs to a node and prefers
+    it for its pages. Allocations for a node are served by its own chunks,
+    which are grown for it, and only fall back to other nodes' chunks when
+    no more address space can be reserved.
+    */
+    class ChunkRegistry
+    {
+    public:
+        // Chunks reserved for growth double in size up to this limit.
+        static constexpr size_t MAX_GROWING_CHUNK_SIZE = static_cast<size_t>(4) * 1024 * 1024 * 1024;
+
+        // Every node gets a chunk of `initial_chunk_size`.
+        ChunkRegistry(size_t initial_chunk_size, bool huge_page_backing, size_t numa_node_count = 1);
+        ~ChunkRegistry();
+
+        ChunkRegistry(const ChunkRegistry&) = delete;
+        ChunkRegistry(ChunkRegistry&&) = delete;
+        ChunkRegistry& operator=(const ChunkRegistry&) = delete;
+        ChunkRegistry& operator=(ChunkRegistry&&) = delete;
+
+        bool is_init_failed() const;
+
+        PageHead* allocate_page(size_t span_page_count = 1, size_t numa_node = 0);
+        PageHead* allocate_huge_page(size_t size, size_t numa_node = 0);
+        void free_page(PageHead* page);
+        // See Chunk::resize_huge_page, a run never grows into another chunk.
+        bool resize_huge_page(PageHead* page, size_t size) const;
+
+        Chunk* find_chunk(void* ptr) const;
+        size_t get_numa_node(void* ptr) const;
+        PageHead* validate(void* ptr) const;
+        MarkBitmapWord* get_mark_bitmap(PageHead* page) const;
+
+        bool add_root(PageHead* page, size_t first_granule) const;
+        bool remove_root(PageHead* page, size_t first_granule) const;
+        void collect_root_pages(std::vector<PageHead*>& out_pages) const;
+        const MarkBitmapWord* get_root_bitmap(PageHead* page) const;
+
+        void publish_page(PageHead* page) const;
+        void collect_published_pages(std::vector<PageHead*>& out_pages) const;
+        // Only the pages of chunks belonging to `numa_node`.
+        void collect_published_pages(std::vector<PageHead*>& out_pages, size_t numa_node) const;
+
+        void dirty_card(PageHead* page) const;
+        void collect_dirty_cards(std::vector<PageHead*>& out_pages) const;
+
+        // Same as Chunk::purge, but `retained_dirty_size` is shared by all chunks.
+        size_t purge(size_t retained_dirty_size, uint32_t min_idle_epochs);
+
+        // Summed up over all chunks, the largest free run is the largest of any.
+        Chunk::Stats get_stats() const;
+
+        size_t get_chunk_count() const;
+        size_t get_total_size() const;
+        size_t get_numa_node_count() const;
+
+    private:
+        struct ChunkRange
+        {
+            uintptr_t   m_begin;
+            uintptr_t   m_end;
+            Chunk*      m_chunk;
+            size_t      m_numa_node;
+        };
+        using ChunkRangeTable = std::vector<ChunkRange>;
+
+        template<typename AllocateFunc>
+        PageHead* allocate_from_chunks(size_t required_size, size_t numa_node, AllocateFunc&& allocate);
+
+        const ChunkRange* find_range(void* ptr) const;
+        Chunk* reserve_chunk_locked(size_t chunk_size, size_t numa_node);
+        // Returns the index of the chunk in the new range table.
+        size_t publish_chunk_locked(Chunk* chunk, size_t numa_node);
+
+        const size_t                        m_numa_node_count;
+        std::atomic<const ChunkRangeTable*> m_ranges;
+        // Index in the range table of the chunk last allocated from, per node.
+        std::vector<std::atomic<size_t>>    m_allocating_chunk_hints;
+
+        std::mutex                          m_grow_mx;
+        std::vector<Chunk*>                 m_chunks;
+        std::vector<const ChunkRangeTable*> m_retired_ranges;
+        size_t                              m_next_chunk_size;
+        bool                                m_huge_page_backing;
+    };
+}
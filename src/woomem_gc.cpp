@@ -9,6 +9,12 @@
 #include "woomem_page_unit_alloc.hpp"
 #include "woomem_lock.hpp"
 #include "woomem_rwlock.hpp"
+#include "woomem_os_thread.h"
+#include "woomem_type_layout.hpp"
+#include "woomem_prefetch.hpp"
+#include "woomem_trace.hpp"
+
+#include <algorithm>
 
 uint8_t woomem_gc_marking_round_counter = 0;
 bool woomem_gc_marking_state_flag = false;
@@ -24,37 +30,131 @@ namespace woomem
         return count == 0 ? 1 : count;
     }
 
-    GC::GC(
-        size_t worker_count,
-        woomem_GCCallback callback_for_marking_root,
-        woomem_GCCallback callback_stop_marking,
-        woomem_MarkCallback user_mark_callback,
-        woomem_FreeCallback user_free_callback,
-        woomem_GCMainThreadEntryCallback main_entry_callback,
-        woomem_GCWorkerThreadEntryCallback worker_entry_callback)
-        : m_gc_worker_count(worker_count != 0 ? worker_count : default_gc_worker_count())
+    // Bit of the unit in its page's mark bitmap and root bitmap, huge units
+    // use the first bit of their run.
+    static size_t get_mark_granule_of_unit(const UnitHead* unit_head)
+    {
+        static_assert(MARK_GRANULE_SIZE == UNIT_GRANULE_SIZE
+            && sizeof(PageUnitAlloc) == UNIT_GRANULE_SIZE);
+
+        if (unit_head->m_next_free_unit_granule == 0)
+            return 0;
+
+        return unit_head->m_next_free_unit_granule - 1u;
+    }
+
+    /*
+        将单元置灰，若该单元已经被标记（或不可标记）则返回 false。
+
+        普通页中的单元只在其页的标记位图中置位，不写入单元头，m_life 保持
+        UNMARKED；巨型单元仍在单元头中经历 SELF_MARKED -> FULL_MARKED。
+
+        minor 轮次中，除非 trace_old_unit，老年代单元不会被置灰，它们指向
+        新生代单元的引用由卡表记录。
+    */
+    static bool try_mark_unit_as_gray(UnitHead* unit_head, bool trace_old_unit)
+    {
+        if (unit_head->m_life.load(std::memory_order::memory_order_relaxed)
+            != UnitLife::UNMARKED)
+            return false;
+
+        if (!trace_old_unit && is_old_unit(unit_head))
+            return false;
+
+        if (unit_head->m_next_free_unit_granule == 0)
+        {
+            // Huge unit.
+            uint8_t expected = UnitLife::UNMARKED;
+            return unit_head->m_life.compare_exchange_strong(
+                expected,
+                UnitLife::SELF_MARKED,
+                std::memory_order::memory_order_release,
+                std::memory_order::memory_order_relaxed);
+        }
+
+        return mark_bitmap_try_set(
+            g_global_context.chunks().get_mark_bitmap(get_page_of_unit(unit_head)),
+            get_mark_granule_of_unit(unit_head));
+    }
+
+    // Units `sweep_units_in_page` will visit, plus a fixed cost for the page.
+    static size_t estimate_page_sweep_cost(PageHead* page)
+    {
+        constexpr size_t PAGE_SWEEP_BASE_COST = 16;
+
+        if (page->m_page_count_if_huge != 0)
+            return PAGE_SWEEP_BASE_COST + 1;
+
+        const PageUnitAlloc* const page_alloc_head =
+            reinterpret_cast<const PageUnitAlloc*>(page + 1);
+
+        return PAGE_SWEEP_BASE_COST
+            + (page->m_unit_high_water_granule.load(std::memory_order_relaxed) - 1u)
+            / (page_alloc_head->m_unit_granules_in_page + 1u);
+    }
+
+    GC::GC(const woomem_InitConfig* config)
+        : m_gc_max_worker_count(std::max(
+            config->gc_worker_count != 0 ? config->gc_worker_count : default_gc_worker_count(),
+            config->gc_max_worker_count))
+        , m_gc_requested_worker_count{
+            config->gc_worker_count != 0 ? config->gc_worker_count : default_gc_worker_count() }
+        , m_gc_cycle_worker_count{ m_gc_requested_worker_count.load(std::memory_order_relaxed) }
+        , m_gc_worker_cpus(
+            config->gc_worker_cpus,
+            config->gc_worker_cpus + (config->gc_worker_cpus != nullptr ? config->gc_worker_cpu_count : 0))
+        , m_numa_node_count(g_global_context.numa_node_count())
         , m_gc_assigned_thread_idx{}
         , m_shutdown{ false }
         , m_worker_shutdown{ false }
-        , m_gc_callback_at_begin(callback_for_marking_root)
-        , m_gc_callback_at_stop_marking(callback_stop_marking)
-        , m_user_mark_callback(user_mark_callback)
-        , m_user_free_callback(user_free_callback)
-        , m_main_entry_callback(main_entry_callback)
-        , m_worker_entry_callback(worker_entry_callback)
+        , m_gc_callback_at_begin(config->gc_callback_at_begin)
+        , m_gc_callback_at_stop_marking(config->gc_callback_at_stop_marking)
+        , m_user_mark_callback(config->mark_callback)
+        , m_user_free_callback(config->free_callback)
+        , m_main_entry_callback(config->main_entry_callback)
+        , m_worker_entry_callback(config->worker_entry_callback)
         , m_gc_worker_threshold_launch_state(WorkerThresholdState::PENDING)
         , m_gc_worker_threshold_finish_counter(0)
+        , m_gc_idle_marking_worker_count{ 0 }
+        , m_gray_block_count{ 0 }
+        , m_root_page_cursor{ 0 }
+        , m_sweep_node_cursors(m_numa_node_count)
+        , m_mutator_assist_state{ MutatorAssistState::NONE }
+        , m_assisting_mutator_count{ 0 }
+        , m_assisted_alive_memory_size{ 0 }
+        , m_gc_minor_cycle{ false }
+        , m_gc_minor_cycle_count_since_major(0)
+        , m_gc_alive_size_after_last_major(0)
+        , m_gc_cycle_running{ false }
+        , m_eager_releasing_mutator_count{ 0 }
+        , m_phase_last_ns{}
+        , m_phase_total_ns{}
         , m_force_trigger_gc{ false }
+        , m_force_major_gc{ false }
         , m_gc_cycle_count{ 0 }
+        , m_gc_swept_cycle_count{ 0 }
+        , m_gc_generational(config->gc_generational)
+        , m_gc_mutator_assist(config->gc_mutator_assist)
         , m_new_allocated_size_since_last_gc{ 0 }
+        , m_gc_trigger_alloc_size{ 0 }
+        , m_gc_assist_alloc_size{ 0 }
+        , m_gc_assist_scan_ratio{ 1 }
+        , m_purge_retained_dirty_size{ DEFAULT_PURGE_RETAINED_DIRTY_SIZE }
+        , m_purge_min_idle_rounds{ DEFAULT_PURGE_MIN_IDLE_ROUNDS }
     {
-        m_gc_worker_threads = (GCWorker*)malloc(m_gc_worker_count * sizeof(GCWorker));
+        m_gc_worker_threads = (GCWorker*)malloc(m_gc_max_worker_count * sizeof(GCWorker));
         if (m_gc_worker_threads == nullptr)
             abort();
 
+        m_pacer.set_policy(
+            config->gc_heap_growth_percent,
+            config->gc_soft_memory_limit,
+            config->gc_cpu_percent);
+        update_pacer_sizes();
+
         // Pre pare for worker threads.
-        for (size_t i = 0; i < m_gc_worker_count; ++i)
-            (void)new (&m_gc_worker_threads[i]) GCWorker(this);
+        for (size_t i = 0; i < m_gc_max_worker_count; ++i)
+            (void)new (&m_gc_worker_threads[i]) GCWorker(this, i);
 
         m_gc_main_thread = std::thread(&GC::main_thread_job, this);
         do
@@ -69,39 +169,64 @@ namespace woomem
     }
     GC::~GC()
     {
-        m_shutdown.store(true, std::memory_order::memory_order_release);
+        do
+        {
+            std::lock_guard g(m_trigger_mx);
+            m_shutdown.store(true, std::memory_order::memory_order_release);
+        } while (0);
+        m_trigger_cv.notify_all();
         m_gc_main_thread.join();
 
         do
         {
             std::lock_guard g(g_global_context.m_thread_entries_mx);
             for (ThreadContext* thread_entry : g_global_context.m_thread_entries)
+            {
                 thread_entry->m_gc_marking_context = nullptr;
+
+                delete thread_entry->m_gray_block;
+                thread_entry->m_gray_block = nullptr;
+            }
         } while (0);
 
         m_worker_shutdown.store(true, std::memory_order::memory_order_release);
-        for (size_t i = 0; i < m_gc_worker_count; ++i)
+        for (size_t i = 0; i < m_gc_max_worker_count; ++i)
             m_gc_worker_threads[i].~GCWorker();
 
         free(m_gc_worker_threads);
+
+        for (GrayBlock* const block : m_free_gray_blocks)
+            delete block;
     }
 
-    void GC::launch_worker_and_wait_until_done(
+    void GC::launch_worker(
         WorkerThresholdState expected_state)
     {
-        std::unique_lock ug(m_gc_worker_threshold_mx);
+        std::lock_guard g(m_gc_worker_threshold_mx);
 
         m_gc_worker_threshold_finish_counter = 0;
+        m_gc_idle_marking_worker_count.store(0, std::memory_order_relaxed);
         m_gc_worker_threshold_launch_state = expected_state;
 
         m_gc_worker_threshold_cv.notify_all();
+    }
+    void GC::wait_until_worker_done()
+    {
+        std::unique_lock ug(m_gc_worker_threshold_mx);
         m_gc_worker_threshold_cv.wait(
             ug,
             [this]()
             {
-                return m_gc_worker_count == m_gc_worker_threshold_finish_counter;
+                return m_gc_cycle_worker_count.load(std::memory_order_relaxed)
+                    == m_gc_worker_threshold_finish_counter;
             });
     }
+    void GC::launch_worker_and_wait_until_done(
+        WorkerThresholdState expected_state)
+    {
+        launch_worker(expected_state);
+        wait_until_worker_done();
+    }
     void GC::wait_for_worker_launch(
         WorkerThresholdState expected_state)
     {
@@ -114,14 +239,16 @@ namespace woomem
             });
     }
     bool GC::wait_for_worker_launch_or_shutdown(
-        WorkerThresholdState expected_state)
+        WorkerThresholdState expected_state, size_t worker_index)
     {
         std::unique_lock ug(m_gc_worker_threshold_mx);
         m_gc_worker_threshold_cv.wait(
             ug,
-            [this, expected_state]()
+            [this, expected_state, worker_index]()
             {
-                return expected_state == m_gc_worker_threshold_launch_state
+                // Workers not taking part in this cycle stay parked here.
+                return (expected_state == m_gc_worker_threshold_launch_state
+                    && worker_index < m_gc_cycle_worker_count.load(std::memory_order_relaxed))
                     || m_worker_shutdown.load(std::memory_order_acquire);
             });
         return !m_worker_shutdown.load(std::memory_order_acquire);
@@ -137,7 +264,8 @@ namespace woomem
     {
         std::lock_guard g(m_gc_worker_threshold_mx);
 
-        if (++m_gc_worker_threshold_finish_counter == m_gc_worker_count)
+        if (++m_gc_worker_threshold_finish_counter
+            == m_gc_cycle_worker_count.load(std::memory_order_relaxed))
             m_gc_worker_threshold_cv.notify_all();
     }
     void GC::callback_worker_entry()
@@ -152,26 +280,140 @@ namespace woomem
     {
         m_user_free_callback(unit);
     }
+    void GC::assign_root_gray_unit(UnitHead* unit_head)
+    {
+        assert(woomem_gc_marking_state_flag);
+
+        const size_t assigned_worker_id =
+            m_gc_assigned_thread_idx.fetch_add(
+                1, std::memory_order::memory_order_relaxed);
+
+        auto& worker = m_gc_worker_threads[
+            assigned_worker_id % m_gc_cycle_worker_count.load(std::memory_order_relaxed)];
+
+        std::lock_guard g(worker.m_local_work_spin_for_root);
+        worker.m_local_work.push_back(unit_head);
+    }
     void GC::mark_root_unit_to_gray(UnitHead* unit_head)
     {
-        uint8_t expected = UnitLife::UNMARKED;
-        if (unit_head->m_life.compare_exchange_strong(
-            expected,
-            UnitLife::SELF_MARKED,
-            std::memory_order::memory_order_release,
-            std::memory_order::memory_order_relaxed))
+        if (try_mark_unit_as_gray(
+            unit_head, !m_gc_minor_cycle.load(std::memory_order_relaxed)))
+            assign_root_gray_unit(unit_head);
+    }
+    void GC::mark_remembered_unit_to_gray(UnitHead* unit_head)
+    {
+        if (try_mark_unit_as_gray(unit_head, true))
+            assign_root_gray_unit(unit_head);
+    }
+    void GC::mark_units_in_remembered_page(PageHead* page)
+    {
+        if (page->m_page_just_allocated.load(std::memory_order::memory_order_acquire))
+            return;
+
+        if (page->m_page_count_if_huge != 0)
+        {
+            UnitHead* const unit = reinterpret_cast<UnitHead*>(page + 1);
+            if (is_old_unit(unit))
+                mark_remembered_unit_to_gray(unit);
+            return;
+        }
+
+        PageUnitAlloc* const page_alloc_head =
+            reinterpret_cast<PageUnitAlloc*>(page + 1);
+
+        const size_t unit_size_with_head =
+            page_alloc_head->get_unit_size() + sizeof(UnitHead);
+
+        char* const unit_storage =
+            reinterpret_cast<char*>(page_alloc_head + 1);
+
+        const size_t unit_count =
+            (page->m_unit_high_water_granule.load(std::memory_order::memory_order_acquire)
+                * UNIT_GRANULE_SIZE - sizeof(PageUnitAlloc)) / unit_size_with_head;
+
+        // Young units of the page are traced from roots as usual.
+        for (size_t i = 0; i < unit_count; ++i)
+        {
+            UnitHead* const unit =
+                reinterpret_cast<UnitHead*>(unit_storage + i * unit_size_with_head);
+
+            if (is_old_unit(unit))
+                mark_remembered_unit_to_gray(unit);
+        }
+    }
+    bool GC::decide_minor_cycle()
+    {
+        static constexpr size_t GC_MAJOR_MIN_ALIVE_EDGE = 1024 * 1024;
+
+        const bool force_major =
+            m_force_major_gc.exchange(false, std::memory_order_relaxed);
+
+        if (!m_gc_generational
+            || force_major
+            || m_gc_minor_cycle_count_since_major >= GC_MAX_MINOR_CYCLES_BETWEEN_MAJOR
+            || woomem_gc_memory_size_after_last_round_sweep
+                >= std::max(GC_MAJOR_MIN_ALIVE_EDGE, m_gc_alive_size_after_last_major)
+                    * GC_MAJOR_ALIVE_GROWTH_RATIO)
+        {
+            m_gc_minor_cycle_count_since_major = 0;
+            return false;
+        }
+
+        ++m_gc_minor_cycle_count_since_major;
+        return true;
+    }
+    GrayBlock* GC::acquire_gray_block()
+    {
+        GrayBlock* block = nullptr;
+        do
         {
-            assert(woomem_gc_marking_state_flag);
+            std::lock_guard g(m_free_gray_blocks_spin);
+            if (!m_free_gray_blocks.empty())
+            {
+                block = m_free_gray_blocks.back();
+                m_free_gray_blocks.pop_back();
+            }
+        } while (0);
 
-            const size_t assigned_worker_id =
-                m_gc_assigned_thread_idx.fetch_add(
-                    1, std::memory_order::memory_order_relaxed);
+        if (block == nullptr)
+        {
+            // More gray units are in flight than ever before, grow.
+            block = new GrayBlock;
+            trace_event(
+                WOOMEM_TRACE_GRAY_QUEUE_OVERFLOW,
+                WOOMEM_GC_PHASE_COUNT,
+                m_gray_block_count.fetch_add(1, std::memory_order_relaxed) + 1);
+        }
+        block->m_count = 0;
+        return block;
+    }
+    void GC::release_gray_block(GrayBlock* block)
+    {
+        std::lock_guard g(m_free_gray_blocks_spin);
+        m_free_gray_blocks.push_back(block);
+    }
+    bool GC::collect_thread_gray_blocks(GCWorker& receiver)
+    {
+        bool collected = false;
 
-            auto& worker = m_gc_worker_threads[assigned_worker_id % m_gc_worker_count];
+        std::lock_guard g(g_global_context.m_thread_entries_mx);
+        for (ThreadContext* thread_entry : g_global_context.m_thread_entries)
+        {
+            GrayBlock* block;
+            do
+            {
+                std::lock_guard bg(thread_entry->m_gray_block_spin);
+                block = thread_entry->m_gray_block;
+                thread_entry->m_gray_block = nullptr;
+            } while (0);
 
-            std::lock_guard g(worker.m_local_work_spin_for_root);
-            worker.m_local_work.push_back(unit_head);
+            if (block != nullptr)
+            {
+                receiver.m_handed_over_blocks.push(block);
+                collected = true;
+            }
         }
+        return collected;
     }
     GCWorker* GC::fetch_thread_worker()
     {
@@ -179,22 +421,62 @@ namespace woomem
             m_gc_assigned_thread_idx.fetch_add(
                 1, std::memory_order::memory_order_relaxed);
 
-        return &m_gc_worker_threads[assigned_worker_id % m_gc_worker_count];
-    }
-    void GC::trigger_gc(bool async)
-    {
-        if (async)
+        if (m_numa_node_count > 1)
         {
-            m_force_trigger_gc.store(true, std::memory_order_release);
-            m_trigger_cv.notify_one();
+            // Units shaded by the thread are traced on the node it runs on,
+            // where it most likely allocated them.
+            const size_t numa_node = g_global_context.current_numa_node();
+            for (size_t i = 0; i < m_gc_max_worker_count; ++i)
+            {
+                GCWorker* const worker =
+                    &m_gc_worker_threads[(assigned_worker_id + i) % m_gc_max_worker_count];
+
+                if (worker->m_numa_node == numa_node)
+                    return worker;
+            }
         }
-        else
-        {
-            const size_t prev_count = m_gc_cycle_count.load(std::memory_order_acquire);
-            m_force_trigger_gc.store(true, std::memory_order_release);
-            m_trigger_cv.notify_one();
+        return &m_gc_worker_threads[assigned_worker_id % m_gc_max_worker_count];
+    }
+    size_t GC::eval_worker_numa_node(size_t worker_index) const
+    {
+        if (m_numa_node_count <= 1)
+            return 0;
+
+        if (m_gc_worker_cpus.empty())
+            return worker_index % m_numa_node_count;
+
+        size_t numa_node;
+        if (0 != woomem_os_numa_node_of_cpu(
+                m_gc_worker_cpus[worker_index % m_gc_worker_cpus.size()], &numa_node)
+            || numa_node >= m_numa_node_count)
+            return 0;
 
-            std::unique_lock ug(m_trigger_mx);
+        return numa_node;
+    }
+    void GC::set_worker_count(size_t worker_count)
+    {
+        m_gc_requested_worker_count.store(
+            std::clamp<size_t>(worker_count, 1, m_gc_max_worker_count),
+            std::memory_order_relaxed);
+    }
+    size_t GC::get_worker_count() const
+    {
+        return m_gc_requested_worker_count.load(std::memory_order_relaxed);
+    }
+    void GC::trigger_gc(bool async, bool major)
+    {
+        if (major)
+            m_force_major_gc.store(true, std::memory_order_relaxed);
+
+        // Flags are set under the lock, so that the main thread cannot miss
+        // them between checking and starting to wait.
+        std::unique_lock ug(m_trigger_mx);
+        const size_t prev_count = m_gc_cycle_count.load(std::memory_order_acquire);
+        m_force_trigger_gc.store(true, std::memory_order_release);
+        m_trigger_cv.notify_all();
+
+        if (!async)
+        {
             m_trigger_cv.wait(ug, [this, prev_count]()
                 {
                     return m_gc_cycle_count.load(std::memory_order_acquire) > prev_count
@@ -202,19 +484,219 @@ namespace woomem
                 });
         }
     }
+    void GC::wait_for_sweep()
+    {
+        std::unique_lock ug(m_trigger_mx);
+        const size_t cycle_count = m_gc_cycle_count.load(std::memory_order_acquire);
 
+        m_trigger_cv.wait(ug, [this, cycle_count]()
+            {
+                return m_gc_swept_cycle_count.load(std::memory_order_acquire) >= cycle_count
+                    || m_shutdown.load(std::memory_order_acquire);
+            });
+    }
+    void GC::notify_allocation_trigger()
+    {
+        do
+        {
+            std::lock_guard g(m_trigger_mx);
+        } while (0);
+        m_trigger_cv.notify_all();
+    }
+    void GC::set_pacer_policy(
+        size_t heap_growth_percent, size_t soft_memory_limit, size_t gc_cpu_percent)
+    {
+        do
+        {
+            std::lock_guard g(m_trigger_mx);
+            m_pacer.set_policy(heap_growth_percent, soft_memory_limit, gc_cpu_percent);
+            update_pacer_sizes();
+        } while (0);
+
+        // The trigger might have been lowered below the allocated size.
+        m_trigger_cv.notify_all();
+    }
+    void GC::update_pacer_sizes()
+    {
+        m_gc_trigger_alloc_size.store(m_pacer.get_trigger_size(), std::memory_order_relaxed);
+        m_gc_assist_alloc_size.store(m_pacer.get_cycle_allowance_size(), std::memory_order_relaxed);
+        m_gc_assist_scan_ratio.store(m_pacer.get_assist_scan_ratio(), std::memory_order_relaxed);
+    }
+    void GC::purge_idle_pages()
+    {
+        (void)g_global_context.chunks().purge(
+            m_purge_retained_dirty_size.load(std::memory_order_relaxed),
+            static_cast<uint32_t>(
+                m_purge_min_idle_rounds.load(std::memory_order_relaxed)));
+    }
+    void GC::open_mutator_assist(MutatorAssistState state)
+    {
+        if (m_gc_mutator_assist)
+            m_mutator_assist_state.store(state, std::memory_order_seq_cst);
+    }
+    void GC::close_mutator_assist()
+    {
+        if (!m_gc_mutator_assist)
+            return;
+
+        // Pairs with `assist_allocation`: a mutator either sees NONE, or is
+        // counted before its state check and waited for here.
+        m_mutator_assist_state.store(MutatorAssistState::NONE, std::memory_order_seq_cst);
+        while (m_assisting_mutator_count.load(std::memory_order_seq_cst) != 0)
+            std::this_thread::yield();
+    }
+    void GC::assist_allocation(GCWorker* context_worker, size_t allocated_size)
+    {
+        assert(m_gc_mutator_assist);
+
+        size_t scan_debt =
+            allocated_size * m_gc_assist_scan_ratio.load(std::memory_order_relaxed);
+        while (true)
+        {
+            if (m_mutator_assist_state.load(std::memory_order_relaxed) == MutatorAssistState::NONE)
+                return;
+
+            m_assisting_mutator_count.fetch_add(1, std::memory_order_seq_cst);
+            switch (m_mutator_assist_state.load(std::memory_order_seq_cst))
+            {
+            case MutatorAssistState::MARK:
+                scan_debt = context_worker->assist_marking(scan_debt);
+                break;
+            case MutatorAssistState::SWEEP:
+            {
+                size_t alive_memory_size = 0;
+                (void)context_worker->sweep_next_batch(
+                    alive_memory_size, g_global_context.current_numa_node());
+                if (alive_memory_size != 0)
+                    m_assisted_alive_memory_size.fetch_add(
+                        alive_memory_size, std::memory_order_relaxed);
+
+                scan_debt = 0;
+                break;
+            }
+            default:
+                scan_debt = 0;
+                break;
+            }
+            m_assisting_mutator_count.fetch_sub(1, std::memory_order_seq_cst);
+
+            if (scan_debt == 0)
+                return;
+
+            // Back-pressure: nothing to steal, the graph is too narrow for this
+            // thread to help. Wait outside of the assisting count so that the
+            // workers can finish marking, then try again.
+            std::this_thread::yield();
+        }
+    }
+
+    void GC::collect_stats(woomem_Stats* out_stats) const
+    {
+        out_stats->allocated_size_since_last_gc =
+            m_new_allocated_size_since_last_gc.load(std::memory_order_relaxed);
+        out_stats->alive_size_after_last_sweep = woomem_gc_memory_size_after_last_round_sweep;
+        out_stats->gc_cycle_count = m_gc_cycle_count.load(std::memory_order_relaxed);
+        out_stats->gc_swept_cycle_count = m_gc_swept_cycle_count.load(std::memory_order_relaxed);
+
+        for (size_t phase = 0; phase < WOOMEM_GC_PHASE_COUNT; ++phase)
+        {
+            out_stats->gc_phase_last_ns[phase] =
+                m_phase_last_ns[phase].load(std::memory_order_relaxed);
+            out_stats->gc_phase_total_ns[phase] =
+                m_phase_total_ns[phase].load(std::memory_order_relaxed);
+        }
+
+        out_stats->gc_worker_count = m_gc_max_worker_count;
+        for (size_t i = 0; i < m_gc_max_worker_count && i < out_stats->gc_worker_capacity; ++i)
+        {
+            woomem_GCWorkerStats& worker_stats = out_stats->gc_workers[i];
+            worker_stats.marked_unit_count =
+                m_gc_worker_threads[i].m_marked_unit_count.load(std::memory_order_relaxed);
+            worker_stats.freed_unit_count =
+                m_gc_worker_threads[i].m_freed_unit_count.load(std::memory_order_relaxed);
+            worker_stats.assisted_unit_count =
+                m_gc_worker_threads[i].m_assisted_unit_count.load(std::memory_order_relaxed);
+        }
+    }
     void GC::register_root_unit_head(UnitHead* unit_head)
     {
-        m_root_gc_unit_set_mx.lock();
-        m_root_gc_unit_set.insert(unit_head);
-        m_root_gc_unit_set_mx.unlock();
+        (void)g_global_context.chunks().add_root(
+            get_page_of_unit(unit_head), get_mark_granule_of_unit(unit_head));
     }
 
     void GC::unregister_root_unit_head(UnitHead* unit_head)
     {
-        m_root_gc_unit_set_mx.lock();
-        m_root_gc_unit_set.erase(unit_head);
-        m_root_gc_unit_set_mx.unlock();
+        (void)g_global_context.chunks().remove_root(
+            get_page_of_unit(unit_head), get_mark_granule_of_unit(unit_head));
+    }
+
+    bool GC::begin_eager_release()
+    {
+        // Pairs with the beginning of `main_thread_job`'s cycle: a mutator
+        // either sees the cycle running, or is counted before it and waited
+        // for there.
+        m_eager_releasing_mutator_count.fetch_add(1, std::memory_order_seq_cst);
+        if (m_gc_cycle_running.load(std::memory_order_seq_cst))
+        {
+            m_eager_releasing_mutator_count.fetch_sub(1, std::memory_order_release);
+            return false;
+        }
+        return true;
+    }
+    void GC::end_eager_release()
+    {
+        m_eager_releasing_mutator_count.fetch_sub(1, std::memory_order_release);
+    }
+    bool GC::can_release_unit_eagerly(UnitHead* unit_head) const
+    {
+        assert(m_eager_releasing_mutator_count.load(std::memory_order_relaxed) != 0
+            && !m_gc_cycle_running.load(std::memory_order_relaxed));
+
+        if (unit_head->m_life.load(std::memory_order::memory_order_relaxed) != UnitLife::UNMARKED)
+            return false;
+
+        return !mark_bitmap_test(
+            g_global_context.chunks().get_root_bitmap(get_page_of_unit(unit_head)),
+            get_mark_granule_of_unit(unit_head));
+    }
+    bool GC::release_unit_eagerly(UnitHead* unit_head)
+    {
+        if (!can_release_unit_eagerly(unit_head))
+            return false;
+
+        PageHead* const page = get_page_of_unit(unit_head);
+        unit_head->m_type_id = WOOMEM_UNTYPED;
+
+        if (page->m_page_count_if_huge != 0)
+        {
+            // No sweep is holding the page now.
+            unit_head->m_life.store(UnitLife::RELEASED, std::memory_order::memory_order_relaxed);
+            g_global_context.chunks().free_page(page);
+            return true;
+        }
+
+        unit_head->m_life.store(UnitLife::RELEASED, std::memory_order::memory_order_relaxed);
+        drop_freed_unit_into_page(page, unit_head);
+
+        // Sweep only gives run out pages back for units it freed itself.
+        PageUnitAlloc* const page_alloc_head =
+            reinterpret_cast<PageUnitAlloc*>(page + 1);
+
+        uint8_t run_out = 1;
+        if (page_alloc_head->m_run_out.compare_exchange_strong(
+            run_out,
+            0,
+            std::memory_order::memory_order_acq_rel,
+            std::memory_order::memory_order_relaxed))
+        {
+            const UnitAllocGroup group =
+                eval_group_by_small_unit_size(page_alloc_head->get_unit_size());
+
+            GlobalPageCollection& gpc = g_global_context.gpc_of_page(page);
+            gpc.count_span_refilled(group);
+            gpc.return_page(page, group);
+        }
+        return true;
     }
 
     void GC::main_thread_job()
@@ -222,188 +704,335 @@ namespace woomem
         m_main_entry_callback();
 
         using namespace std;
+
+        const size_t cpu_count = std::max<size_t>(1, std::thread::hardware_concurrency());
+        auto last_cycle_begin_time = chrono::steady_clock::now();
+
+        auto phase_begin_time = last_cycle_begin_time;
+        auto end_phase = [this, &phase_begin_time](woomem_GCPhase phase)
+            {
+                const auto phase_end_time = chrono::steady_clock::now();
+                const auto phase_ns = static_cast<uint64_t>(
+                    chrono::duration_cast<chrono::nanoseconds>(
+                        phase_end_time - phase_begin_time).count());
+
+                m_phase_last_ns[phase].store(phase_ns, std::memory_order_relaxed);
+                m_phase_total_ns[phase].fetch_add(phase_ns, std::memory_order_relaxed);
+                phase_begin_time = phase_end_time;
+
+                trace_event(WOOMEM_TRACE_PHASE_END, phase);
+                if (phase + 1 < WOOMEM_GC_PHASE_COUNT)
+                    trace_event(WOOMEM_TRACE_PHASE_BEGIN, phase + 1);
+            };
         do
         {
-            // Step 0: Wait with ratio-based early triggering.
+            // Step 0: 等待触发：强制触发，或自上轮起新分配的大小达到 pacer 给出的阈值
+            //      阈值由分配路径在越过时唤醒，不再轮询
+            bool triggered;
+            do
             {
-                static constexpr size_t GC_TRIGGER_NEW_ALLOC_RATIO_NUM = 1;
-                static constexpr size_t GC_TRIGGER_NEW_ALLOC_RATIO_DEN = 3;
-                static constexpr size_t GC_TRIGGER_MIN_EDGE = 1024 * 1024;
-
-                const auto cycle_start = chrono::steady_clock::now();
-                while (true)
-                {
+                std::unique_lock ug(m_trigger_mx);
+                triggered = m_trigger_cv.wait_for(
+                    ug,
+                    chrono::milliseconds(PURGE_IDLE_INTERVAL_MS),
+                    [this]()
                     {
-                        std::unique_lock ug(m_trigger_mx);
-                        m_trigger_cv.wait_for(ug, 0.1s, [this]()
-                            {
-                                return m_force_trigger_gc.load(std::memory_order_relaxed)
-                                    || m_shutdown.load(std::memory_order_acquire);
-                            });
-                    }
-
-                    if (m_shutdown.load(std::memory_order_acquire))
-                        return;
-
-                    const auto elapsed = chrono::steady_clock::now() - cycle_start;
-                    if (elapsed >= 10s)
-                        break;
-
-                    if (m_force_trigger_gc.load(std::memory_order_relaxed))
-                        break;
+                        return m_force_trigger_gc.load(std::memory_order_relaxed)
+                            || m_shutdown.load(std::memory_order_acquire)
+                            || m_new_allocated_size_since_last_gc.load(std::memory_order_relaxed)
+                            >= m_gc_trigger_alloc_size.load(std::memory_order_relaxed);
+                    });
+            } while (0);
+
+            if (m_shutdown.load(std::memory_order_acquire))
+                return;
 
-                    const size_t alive =
-                        std::max(GC_TRIGGER_MIN_EDGE, woomem_gc_memory_size_after_last_round_sweep);
+            // 空闲时没有轮次结束，定时归还闲置的空闲页，每个间隔计为一轮
+            if (!triggered)
+            {
+                purge_idle_pages();
+                continue;
+            }
 
-                    const size_t new_alloc =
-                        m_new_allocated_size_since_last_gc.load(
-                            std::memory_order_relaxed);
+            // 等待正在提前释放单元的 mutator 离开，此后直到本轮结束都不会再有
+            m_gc_cycle_running.store(true, std::memory_order_seq_cst);
+            while (m_eager_releasing_mutator_count.load(std::memory_order_seq_cst) != 0)
+                std::this_thread::yield();
 
-                    if (new_alloc * GC_TRIGGER_NEW_ALLOC_RATIO_DEN
-                        >= alive * GC_TRIGGER_NEW_ALLOC_RATIO_NUM)
-                        break;
-                }
-            }
+            const auto cycle_begin_time = chrono::steady_clock::now();
             m_force_trigger_gc.store(false, std::memory_order_relaxed);
             m_new_allocated_size_since_last_gc.store(0, std::memory_order_relaxed);
 
-            // Step 1: 更新 GC 轮次和 GC 状态
+            // Step 1: 更新 GC 轮次和 GC 状态，确定本轮参与的 Worker 数量以及是否为 minor 轮次
+            const bool minor_cycle = decide_minor_cycle();
+            m_gc_minor_cycle.store(minor_cycle, std::memory_order_relaxed);
+            trace_event(WOOMEM_TRACE_CYCLE_BEGIN, WOOMEM_GC_PHASE_COUNT, minor_cycle ? 1 : 0);
+
+            const size_t cycle_worker_count =
+                m_gc_requested_worker_count.load(std::memory_order_relaxed);
+            do
+            {
+                std::lock_guard g(m_gc_worker_threshold_mx);
+                m_gc_cycle_worker_count.store(cycle_worker_count, std::memory_order_relaxed);
+            } while (0);
+
             ++woomem_gc_marking_round_counter;
             woomem_gc_marking_state_flag = true;
 
             // Step 2: 触发 GC 起始回调，此阶段完成线程同步和根对象标记
+            phase_begin_time = chrono::steady_clock::now();
+            trace_event(WOOMEM_TRACE_PHASE_BEGIN, WOOMEM_GC_PHASE_ROOT_MARK);
             m_gc_callback_at_begin();
 
-            m_root_gc_unit_set_mx.lock();
+            // 根单元登记在各 Chunk 的根位图中，此处只收集含有根单元的页，
+            //      由 Worker 在 Step 3 开始时分批并行标记
+            m_root_pages.clear();
+            g_global_context.chunks().collect_root_pages(m_root_pages);
+            m_root_page_cursor.store(0, std::memory_order_relaxed);
+
+            // minor 轮次：从卡表中取出被写入过的老年代单元，作为额外的根
+            if (minor_cycle)
             {
-                for (UnitHead* const root_unit : m_root_gc_unit_set)
-                    mark_root_unit_to_gray(root_unit);
+                m_remembered_pages.clear();
+                g_global_context.chunks().collect_dirty_cards(m_remembered_pages);
+
+                for (PageHead* const page : m_remembered_pages)
+                    mark_units_in_remembered_page(page);
             }
-            m_root_gc_unit_set_mx.unlock();
 
             // Step 3: 根对象标记完成，收集，开始并行标记
+            //      分配过多的 mutator 在此期间协助扫描灰色单元；回调可能需要与 mutator 同步，
+            //      因此 Step 4 回调前关闭协助
+            end_phase(WOOMEM_GC_PHASE_ROOT_MARK);
+            open_mutator_assist(MutatorAssistState::MARK);
             launch_worker_and_wait_until_done(WorkerThresholdState::PARALLEL_MARK);
+            close_mutator_assist();
+            end_phase(WOOMEM_GC_PHASE_PARALLEL_MARK);
 
             // Step 4: 首轮标记结束回调，此阶段通知正在运行的其他线程不要继续标记
+            //      并发标记期间的堆内引用修改已由 woomem_write_barrier 置灰，此处只需重新标记堆外的根
             woomem_gc_marking_state_flag = false;
             m_gc_callback_at_stop_marking();
 
-            // Step 5: 收尾标记
+            // Step 5: 收尾标记，协助保持开启直到清扫开始，分配过多的 mutator 在此期间等待
+            open_mutator_assist(MutatorAssistState::MARK);
             launch_worker_and_wait_until_done(WorkerThresholdState::FINAL_MARK);
+            end_phase(WOOMEM_GC_PHASE_FINAL_MARK);
 
-            // Step 6: 从全局链表中提取所有 Page，均匀分发给每个 GCWorker
+            // Step 6: 从各 Chunk 中按地址顺序取出所有已发布的 Page，交给 GCWorker 在后台分批清扫
+            //      此后发布的 Page 不参与本轮清扫
+            size_t skipped_alive_memory_size;
             {
-                PageHead* all_pages = g_global_context.m_all_page_list.exchange(
-                    nullptr, std::memory_order::memory_order_acq_rel);
+                m_sweep_pages.clear();
+                m_sweep_batch_ends.clear();
+
+                // minor 轮次跳过近期没有新生代单元的普通页
+                skipped_alive_memory_size = 0;
 
-                if (all_pages != nullptr)
+                // 每个 NUMA 节点的 Page 各自分批，Worker 优先清扫所在节点的批次
+                for (size_t node = 0; node < m_numa_node_count; ++node)
                 {
-                    size_t total_pages = 0;
-                    for (PageHead* p = all_pages; p != nullptr; p = p->m_next_page)
-                        ++total_pages;
+                    size_t sweep_page_count = m_sweep_pages.size();
+                    g_global_context.chunks().collect_published_pages(m_sweep_pages, node);
 
-                    const size_t base_count = total_pages / m_gc_worker_count;
-                    const size_t remainder = total_pages % m_gc_worker_count;
+                    SweepNodeCursor& cursor = m_sweep_node_cursors[node];
+                    cursor.m_next_batch.store(m_sweep_batch_ends.size(), std::memory_order_relaxed);
 
-                    PageHead* current = all_pages;
-                    for (size_t i = 0; i < m_gc_worker_count; ++i)
+                    size_t batch_cost = 0;
+                    for (size_t i = sweep_page_count; i < m_sweep_pages.size(); ++i)
                     {
-                        const size_t n = base_count + (i < remainder ? 1 : 0);
-
-                        if (n == 0)
+                        PageHead* const p = m_sweep_pages[i];
+                        if (minor_cycle
+                            && p->m_page_count_if_huge == 0
+                            && static_cast<uint8_t>(woomem_gc_marking_round_counter
+                                - p->m_young_unit_round.load(std::memory_order_relaxed)) > 1)
                         {
-                            m_gc_worker_threads[i].m_sweep_page_list = nullptr;
+                            // Not swept, count everything carved as alive.
+                            skipped_alive_memory_size += sizeof(PageHead)
+                                + p->m_unit_high_water_granule.load(std::memory_order_relaxed)
+                                    * UNIT_GRANULE_SIZE;
                             continue;
                         }
 
-                        m_gc_worker_threads[i].m_sweep_page_list = current;
+                        m_sweep_pages[sweep_page_count++] = p;
 
-                        PageHead* prev = nullptr;
-                        for (size_t j = 0; j < n; ++j)
+                        batch_cost += estimate_page_sweep_cost(p);
+                        if (batch_cost >= GCWorker::SWEEP_BATCH_COST)
                         {
-                            prev = current;
-                            current = current->m_next_page;
+                            m_sweep_batch_ends.push_back(sweep_page_count);
+                            batch_cost = 0;
                         }
-                        prev->m_next_page = nullptr;
                     }
+                    m_sweep_pages.resize(sweep_page_count);
+                    if (batch_cost != 0)
+                        m_sweep_batch_ends.push_back(sweep_page_count);
+
+                    cursor.m_end_batch = m_sweep_batch_ends.size();
                 }
+
+                m_assisted_alive_memory_size.store(0, std::memory_order_relaxed);
             }
-            launch_worker_and_wait_until_done(WorkerThresholdState::SWEEP);
+            // Worker 开始清扫时会回收双端队列的旧缓冲区，此前不能再有 mutator 窃取
+            close_mutator_assist();
+            open_mutator_assist(MutatorAssistState::SWEEP);
+            launch_worker(WorkerThresholdState::SWEEP);
+
+            // Step 7: 标记已经结束，本轮 GC 对等待者而言已完成，清扫继续在后台进行
+            const size_t allocated_while_marking =
+                m_new_allocated_size_since_last_gc.load(std::memory_order_relaxed);
+            do
+            {
+                std::lock_guard g(m_trigger_mx);
+                m_gc_cycle_count.fetch_add(1, std::memory_order_release);
+            } while (0);
+            m_trigger_cv.notify_all();
 
-            // Step 7: 统计存活内存单元大小
-            size_t total_alive_memory_size = 0;
-            for (size_t i = 0; i < m_gc_worker_count; ++i)
+            // Step 8: 等待清扫完成（包括协助清扫的 mutator），统计存活内存单元大小
+            wait_until_worker_done();
+            close_mutator_assist();
+            end_phase(WOOMEM_GC_PHASE_SWEEP);
+
+            size_t total_alive_memory_size = skipped_alive_memory_size
+                + m_assisted_alive_memory_size.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < cycle_worker_count; ++i)
             {
                 total_alive_memory_size +=
                     m_gc_worker_threads[i].m_alive_memory_size_counter;
             }
             woomem_gc_memory_size_after_last_round_sweep = total_alive_memory_size;
+            if (!minor_cycle)
+                m_gc_alive_size_after_last_major = total_alive_memory_size;
 
-            g_global_context.gpc().remove_marked_run_out_pages();
+            trace_event(WOOMEM_TRACE_CYCLE_END, WOOMEM_GC_PHASE_COUNT, total_alive_memory_size);
 
-            m_gc_worker_threshold_launch_state = WorkerThresholdState::PENDING;
+            for (size_t node = 0; node < m_numa_node_count; ++node)
+                g_global_context.gpc(node).remove_marked_run_out_pages();
 
-            m_gc_cycle_count.fetch_add(1, std::memory_order_release);
+            // 根据本轮的存活大小、标记期间的分配量和耗时，计算下一轮的触发阈值
+            do
+            {
+                const auto cycle_end_time = chrono::steady_clock::now();
+                const auto busy_ns = chrono::duration_cast<chrono::nanoseconds>(
+                    cycle_end_time - cycle_begin_time).count();
+                const auto period_ns = chrono::duration_cast<chrono::nanoseconds>(
+                    cycle_end_time - last_cycle_begin_time).count();
+                last_cycle_begin_time = cycle_begin_time;
+
+                std::lock_guard g(m_trigger_mx);
+                m_pacer.end_cycle(
+                    total_alive_memory_size,
+                    allocated_while_marking,
+                    static_cast<uint64_t>(busy_ns),
+                    cycle_worker_count,
+                    static_cast<uint64_t>(period_ns),
+                    cpu_count);
+                update_pacer_sizes();
+
+                // 清扫结果已经更新，唤醒 wait_for_sweep 的等待者
+                m_gc_swept_cycle_count.fetch_add(1, std::memory_order_release);
+            } while (0);
             m_trigger_cv.notify_all();
+
+            // Step 9: 将闲置多轮的空闲页归还给操作系统
+            purge_idle_pages();
+
+            do
+            {
+                std::lock_guard g(m_gc_worker_threshold_mx);
+                m_gc_worker_threshold_launch_state = WorkerThresholdState::PENDING;
+            } while (0);
+
+            m_gc_cycle_running.store(false, std::memory_order_release);
         } while (1);
     }
 
-    GCWorker::GCWorker(GC* gc_ctx)
+    GCWorker::GCWorker(GC* gc_ctx, size_t worker_index)
         : m_gc_ctx(gc_ctx)
-        , m_sweep_page_list(nullptr)
+        , m_worker_index(worker_index)
+        , m_numa_node(gc_ctx->eval_worker_numa_node(worker_index))
+        , m_marked_unit_count{ 0 }
+        , m_freed_unit_count{ 0 }
+        , m_assisted_unit_count{ 0 }
+        , m_scanning_old_unit(nullptr)
     {
-        m_local_work.reserve(GRAY_QUEUE_CAPACITY);
+        m_local_work.reserve(LOCAL_WORK_RESERVE);
         m_gc_worker_thread = std::thread(&GCWorker::worker_thread_job, this);
     }
     GCWorker::~GCWorker()
     {
         m_gc_ctx->signal_worker_shutdown();
         m_gc_worker_thread.join();
+
+        for (GrayBlock* block = m_handed_over_blocks.take_all(); block != nullptr;)
+        {
+            GrayBlock* const next = block->m_next;
+            delete block;
+            block = next;
+        }
     }
     void GCWorker::mark_unit_to_gray(
         UnitHead* unit_head)
     {
-        uint8_t expected = UnitLife::UNMARKED;
-        if (unit_head->m_life.compare_exchange_strong(
-            expected,
-            UnitLife::SELF_MARKED,
-            std::memory_order::memory_order_release,
-            std::memory_order::memory_order_relaxed))
+        const bool on_worker_thread =
+            std::this_thread::get_id() == m_gc_worker_thread.get_id();
+
+        if (on_worker_thread
+            && m_scanning_old_unit != nullptr
+            && !is_old_unit(unit_head))
         {
-            if (std::this_thread::get_id() == m_gc_worker_thread.get_id())
-                m_local_work.push_back(unit_head);
+            // Keep the old unit remembered until its children were promoted.
+            g_global_context.chunks().dirty_card(get_page_of_unit(m_scanning_old_unit));
+            m_scanning_old_unit = nullptr;
+        }
+
+        if (try_mark_unit_as_gray(
+            unit_head, !m_gc_ctx->m_gc_minor_cycle.load(std::memory_order_relaxed)))
+        {
+            if (on_worker_thread)
+                m_mark_deque.push(unit_head);
+            else if (t_thread_context.m_is_assisting_gc)
+                t_thread_context.m_assist_gray_units.push_back(unit_head);
             else
             {
-                while (!m_gray_queue.try_enqueue(unit_head))
+                // Other threads buffer the unit in a block of their own, it is
+                // only published once full. The lock is the thread's, it is
+                // only contended by an idle worker taking the block.
+                ThreadContext& thread_ctx = t_thread_context;
+                GrayBlock* full_block = nullptr;
+                do
                 {
-                    /*
-                        如果 Worker 尚未启动（m_is_draining == false），而此时灰度队
-                        列已满，那么继续自旋等待队列空闲将会导致死锁：
-
-                        1. GC 主线程在 Step 2 等待 VM 响应 GC_CHECK
-                        2. VM 线程在此处自旋（队列满，无人消费）
-                        3. Worker 线程等待 PARALLEL_MARK 信号（Step 3 尚未到达）
-
-                        解决办法：直接推入 m_local_work（通过 m_local_work_spin_for_root）。
-
-                        注意与 Worker 的同步：Worker 在进入 process_gray_units 时，会
-                        持有同一把自旋锁将 m_is_draining 置为 true。此处持锁后二次
-                        检查 m_is_draining：若发现 Worker 已开始消费，则放弃直接推送，
-                        继续尝试 enqueue（此时 Worker 正在 drain，队列很快会有空位）。
-                    */
-                    if (!m_is_draining.load(std::memory_order_acquire))
+                    std::lock_guard g(thread_ctx.m_gray_block_spin);
+
+                    GrayBlock* block = thread_ctx.m_gray_block;
+                    if (block == nullptr)
+                        thread_ctx.m_gray_block = block = m_gc_ctx->acquire_gray_block();
+
+                    block->m_units[block->m_count++] = unit_head;
+                    if (block->m_count == GrayBlock::CAPACITY)
                     {
-                        std::lock_guard g(m_local_work_spin_for_root);
-                        if (!m_is_draining.load(std::memory_order_relaxed))
-                        {
-                            m_local_work.push_back(unit_head);
-                            break;
-                        }
+                        full_block = block;
+                        thread_ctx.m_gray_block = nullptr;
                     }
-                }
+                } while (0);
+
+                if (full_block != nullptr)
+                    hand_over_gray_block(full_block);
             }
         }
     }
+    void GCWorker::hand_over_gray_block(GrayBlock* block)
+    {
+        // Threads bound to a worker parked in this cycle hand over to an
+        // active one.
+        const size_t cycle_worker_count =
+            m_gc_ctx->m_gc_cycle_worker_count.load(std::memory_order_relaxed);
+
+        GCWorker& receiver = m_worker_index < cycle_worker_count
+            ? *this
+            : m_gc_ctx->m_gc_worker_threads[m_worker_index % cycle_worker_count];
+
+        receiver.m_handed_over_blocks.push(block);
+    }
     bool GCWorker::check_and_free_unmarked_unit(UnitHead* unit, PageHead* page_may_null)
     {
         const uint8_t life = unit->m_life.load(std::memory_order::memory_order_relaxed);
@@ -414,6 +1043,11 @@ namespace woomem
         case UnitLife::PENDING:
             return true;
         case UnitLife::UNMARKED:
+            if (m_gc_ctx->m_gc_minor_cycle.load(std::memory_order_relaxed)
+                && is_old_unit(unit))
+                // Old units are not traced in minor cycles, keep them as is.
+                return true;
+
             if ((unit->m_age != 15 || unit->m_timing != woomem_gc_marking_round_counter)
                 && 0 != (unit->m_attribute & WOOMEM_ATTRIB_NEED_SWEEP))
             {
@@ -421,6 +1055,7 @@ namespace woomem
                 if (unit->m_attribute & WOOMEM_ATTRIB_FREE_CALLBACK)
                     m_gc_ctx->callback_user_free(unit + 1);
 
+                unit->m_type_id = WOOMEM_UNTYPED;
                 unit->m_life.store(
                     UnitLife::RELEASED,
                     std::memory_order::memory_order_relaxed);
@@ -437,6 +1072,10 @@ namespace woomem
             if (unit->m_age != 0)
                 --unit->m_age;
 
+            if (m_gc_ctx->m_gc_generational && unit->m_age == OLD_UNIT_AGE)
+                // Just promoted, remember it until its children are old too.
+                g_global_context.chunks().dirty_card(get_page_of_unit(unit));
+
             unit->m_life.store(
                 UnitLife::UNMARKED,
                 std::memory_order::memory_order_relaxed);
@@ -444,7 +1083,7 @@ namespace woomem
 
         return true;
     }
-    void GCWorker::sweep_units_in_page(PageHead* page)
+    void GCWorker::sweep_units_in_page(PageHead* page, size_t& alive_memory_size)
     {
         bool drop_page = false;
         assert(!page->m_page_just_allocated.load(std::memory_order::memory_order_relaxed));
@@ -455,55 +1094,100 @@ namespace woomem
                 reinterpret_cast<PageUnitAlloc*>(page + 1);
 
             const size_t unit_size_with_head =
-                page_alloc_head->m_unit_size_in_page + sizeof(UnitHead);
+                page_alloc_head->get_unit_size() + sizeof(UnitHead);
 
             char* unit_storage =
                 reinterpret_cast<char*>(page_alloc_head + 1);
 
+            // Units beyond the high water mark are not carved yet, nothing to sweep.
             const size_t unit_count =
-                (PageHead::NORMAL_PAGE_SIZE - sizeof(PageHead) - sizeof(PageUnitAlloc)) / unit_size_with_head;
+                (page->m_unit_high_water_granule.load(std::memory_order_acquire)
+                    * UNIT_GRANULE_SIZE - sizeof(PageUnitAlloc)) / unit_size_with_head;
 
-            bool has_survivor = false, has_free_space = false;
+            bool has_survivor = false, has_free_space = false, has_young_survivor = false;
+            size_t freed_unit_count = 0;
 
             const bool current_running_out =
                 page_alloc_head->m_run_out.load(std::memory_order_acquire);
 
+            // Marked units survive without reading their heads.
+            MarkBitmapWord* const mark_bitmap =
+                g_global_context.chunks().get_mark_bitmap(page);
+            const size_t mark_bitmap_words = mark_bitmap_word_count(page);
+            const bool has_marked_unit = !mark_bitmap_is_empty(mark_bitmap, mark_bitmap_words);
+            const size_t unit_granules = unit_size_with_head / MARK_GRANULE_SIZE;
+
             for (size_t i = 0; i < unit_count; ++i)
             {
+                if (has_marked_unit && mark_bitmap_test(mark_bitmap, i * unit_granules))
+                {
+                    has_survivor = true;
+                    alive_memory_size += unit_size_with_head;
+                    continue;
+                }
+
                 UnitHead* unit =
                     reinterpret_cast<UnitHead*>(unit_storage + i * unit_size_with_head);
 
+                // Released earlier, but the page might have been dropped from
+                // the global collection as run out since, see
+                // `remove_marked_run_out_pages`.
                 if (unit->m_life.load(std::memory_order::memory_order_relaxed)
                     == UnitLife::RELEASED)
+                {
+                    has_free_space = true;
                     continue;
+                }
 
                 if (check_and_free_unmarked_unit(unit, page))
                 {
                     has_survivor = true;
-                    m_alive_memory_size_counter += unit_size_with_head;
+                    has_young_survivor = has_young_survivor || !is_old_unit(unit);
+                    alive_memory_size += unit_size_with_head;
                 }
                 else
+                {
                     has_free_space = true;
+                    ++freed_unit_count;
+                }
             }
 
+            if (freed_unit_count != 0)
+                m_freed_unit_count.fetch_add(freed_unit_count, std::memory_order_relaxed);
+
+            if (has_marked_unit)
+                mark_bitmap_clear(mark_bitmap, mark_bitmap_words);
+
+            // Marked young units have tagged the page already.
+            if (has_young_survivor && m_gc_ctx->m_gc_generational)
+                page->m_young_unit_round.store(
+                    woomem_gc_marking_round_counter, std::memory_order_relaxed);
+
             if (current_running_out && has_free_space)
             {
                 if (!has_survivor)
+                {
                     drop_page = true;
+                    g_global_context.gpc_of_page(page).count_span_freed(
+                        eval_group_by_small_unit_size(page_alloc_head->get_unit_size()));
+                }
                 else
                 {
                     page_alloc_head->m_run_out.store(
                         0, std::memory_order::memory_order_relaxed);
 
-                    g_global_context.gpc().return_page(
-                        page, eval_group_by_small_unit_size(
-                            page_alloc_head->m_unit_size_in_page));
+                    const UnitAllocGroup group =
+                        eval_group_by_small_unit_size(page_alloc_head->get_unit_size());
+
+                    GlobalPageCollection& gpc = g_global_context.gpc_of_page(page);
+                    gpc.count_span_refilled(group);
+                    gpc.return_page(page, group);
                 }
             }
 
             if (has_survivor)
             {
-                m_alive_memory_size_counter +=
+                alive_memory_size +=
                     sizeof(PageHead) + sizeof(PageUnitAlloc);
             }
             else
@@ -516,85 +1200,416 @@ namespace woomem
         {
             // Is huge unit.
             if (!check_and_free_unmarked_unit(reinterpret_cast<UnitHead*>(page + 1), nullptr))
+            {
                 drop_page = true;
+                m_freed_unit_count.fetch_add(1, std::memory_order_relaxed);
+            }
             else
             {
-                m_alive_memory_size_counter +=
+                alive_memory_size +=
                     page->m_page_count_if_huge * PageHead::NORMAL_PAGE_SIZE;
             }
         }
 
         if (drop_page)
-            // Drop this page.
-            g_global_context.chunk().free_page(page);
-        else
-            // Re-join the page into list.
-            g_global_context.add_page_back_to_into_chain(page);
+            // Drop this page, it is unpublished as well.
+            g_global_context.chunks().free_page(page);
     }
-    void GCWorker::drain_queue_into_local()
+    bool GCWorker::sweep_next_batch(size_t& alive_memory_size, size_t numa_node)
     {
-        const size_t count = m_gray_queue.drain(
-            m_drain_buf.data(), m_drain_buf.size());
+        const std::vector<PageHead*>& sweep_pages = m_gc_ctx->m_sweep_pages;
+        const std::vector<size_t>& batch_ends = m_gc_ctx->m_sweep_batch_ends;
+        const size_t numa_node_count = m_gc_ctx->m_numa_node_count;
 
-        if (count != 0)
+        for (size_t i = 0; i < numa_node_count; ++i)
         {
-            m_local_work.insert(
-                m_local_work.end(),
-                m_drain_buf.begin(),
-                m_drain_buf.begin() + count);
+            GC::SweepNodeCursor& cursor =
+                m_gc_ctx->m_sweep_node_cursors[(numa_node + i) % numa_node_count];
+
+            // Keep the cursors of finished nodes from growing needlessly.
+            if (cursor.m_next_batch.load(std::memory_order_relaxed) >= cursor.m_end_batch)
+                continue;
+
+            const size_t batch = cursor.m_next_batch.fetch_add(
+                1, std::memory_order_relaxed);
+            if (batch >= cursor.m_end_batch)
+                continue;
+
+            const size_t begin = batch == 0 ? 0 : batch_ends[batch - 1];
+            for (size_t j = begin; j < batch_ends[batch]; ++j)
+            {
+                // Pages are in address order, fetch the next head ahead.
+                if (j + 1 < batch_ends[batch])
+                    WOOMEM_PREFETCH_READ(sweep_pages[j + 1]);
+
+                sweep_units_in_page(sweep_pages[j], alive_memory_size);
+            }
+
+            return true;
         }
+        return false;
     }
-    void GCWorker::process_gray_units()
+    bool GCWorker::take_handed_over_units(GCWorker& owner)
     {
-        /*
-            与 mark_unit_to_gray 中的外部线程建立同步：
-            外部线程在持锁后二次检查 m_is_draining，若为 false 则推入
-            m_local_work。此处持同一把锁将 m_is_draining 置为 true，
-            保证 Worker 开始消费 m_local_work 之前，外部线程的推送已
-            经完成。
-        */
+        GrayBlock* block = owner.m_handed_over_blocks.take_all();
+        if (block == nullptr)
+            return false;
+
+        do
         {
-            std::lock_guard g(m_local_work_spin_for_root);
-            m_is_draining.store(true, std::memory_order_release);
+            GrayBlock* const next = block->m_next;
+            for (size_t i = 0; i < block->m_count; ++i)
+                m_mark_deque.push(block->m_units[i]);
+
+            m_gc_ctx->release_gray_block(block);
+            block = next;
+        } while (block != nullptr);
+
+        return true;
+    }
+    UnitHead* GCWorker::steal_gray_unit()
+    {
+        const size_t worker_count =
+            m_gc_ctx->m_gc_cycle_worker_count.load(std::memory_order_relaxed);
+
+        for (size_t i = 1; i < worker_count; ++i)
+        {
+            GCWorker& victim =
+                m_gc_ctx->m_gc_worker_threads[(m_worker_index + i) % worker_count];
+
+            // Blocks handed over to the victim are taken first, it may have
+            // finished the phase already and never take them itself.
+            if (take_handed_over_units(victim))
+                return m_mark_deque.pop();
+
+            UnitHead* const unit = victim.m_mark_deque.steal();
+            if (unit != nullptr)
+                return unit;
         }
+        return nullptr;
+    }
+    bool GCWorker::wait_for_gray_units_or_termination()
+    {
+        /*
+            终止协议：没有可处理的灰色单元时，Worker 将空闲计数加一，然后等待。
+            只有正在工作的 Worker 会向自己的双端队列推入新的灰色单元，因此当
+            所有 Worker 同时空闲时，所有双端队列都为空，本阶段标记结束。
+
+            空闲的 Worker 若发现任何 Worker 的双端队列或移交栈中有单元，必须先将
+            空闲计数减一再去获取，避免其他 Worker 在此期间误判终止。移交栈可以被
+            任何 Worker 取走，因此已经结束本阶段的 Worker 不会让其余 Worker 空等。
+
+            其他线程置灰的单元先缓存在线程自己的块中，块满才移交，因此所有 Worker
+            空闲时，要先取走各线程未满的块再判断终止。协助标记的 mutator 持有窃取
+            的单元时也会置灰新的单元，并在离开前移交给 Worker，因此终止还要求没有
+            mutator 正在协助，且所有移交栈为空；收尾标记之后不会再有机会处理它们。
+        */
+        std::atomic_size_t& idle_count = m_gc_ctx->m_gc_idle_marking_worker_count;
+        const size_t worker_count =
+            m_gc_ctx->m_gc_cycle_worker_count.load(std::memory_order_relaxed);
 
+        idle_count.fetch_add(1, std::memory_order_acq_rel);
         while (true)
         {
-            if (m_local_work.empty())
-                // NOTE: `drain_queue_into_local` contains a acquire order.
-                //      So, we can sure the `m_life` of the unit to full mark
-                //      is `SELF_MARKED` we can read.
-                drain_queue_into_local();
-            if (m_local_work.empty())
+            if (idle_count.load(std::memory_order_seq_cst) == worker_count
+                && !m_gc_ctx->collect_thread_gray_blocks(*this)
+                && m_gc_ctx->m_assisting_mutator_count.load(std::memory_order_seq_cst) == 0)
             {
-                m_is_draining.store(false, std::memory_order_release);
-                return;
+                bool has_handed_over_units = false;
+                for (size_t i = 0; !has_handed_over_units && i < worker_count; ++i)
+                    has_handed_over_units =
+                        !m_gc_ctx->m_gc_worker_threads[i].m_handed_over_blocks.empty();
+
+                if (!has_handed_over_units)
+                    return false;
+            }
+
+            bool has_gray_units = false;
+            for (size_t i = 0; !has_gray_units && i < worker_count; ++i)
+            {
+                const GCWorker& worker = m_gc_ctx->m_gc_worker_threads[i];
+                has_gray_units =
+                    !worker.m_handed_over_blocks.empty() || !worker.m_mark_deque.empty();
+            }
+
+            if (has_gray_units)
+            {
+                idle_count.fetch_sub(1, std::memory_order_acq_rel);
+                return true;
             }
 
-            UnitHead* const unit = m_local_work.back();
-            m_local_work.pop_back();
+            std::this_thread::yield();
+        }
+    }
+    void GCWorker::mark_root_pages()
+    {
+        const std::vector<PageHead*>& root_pages = m_gc_ctx->m_root_pages;
+        while (true)
+        {
+            const size_t begin = m_gc_ctx->m_root_page_cursor.fetch_add(
+                ROOT_PAGE_BATCH, std::memory_order_relaxed);
+            if (begin >= root_pages.size())
+                break;
+
+            const size_t end = std::min(begin + ROOT_PAGE_BATCH, root_pages.size());
+            for (size_t i = begin; i < end; ++i)
+                mark_root_units_in_page(root_pages[i]);
+        }
+    }
+    void GCWorker::mark_root_units_in_page(PageHead* page)
+    {
+        // Huge runs only use the first bit, their unit follows the page head.
+        char* const unit_storage = page->m_page_count_if_huge != 0
+            ? reinterpret_cast<char*>(page + 1)
+            : reinterpret_cast<char*>(reinterpret_cast<PageUnitAlloc*>(page + 1) + 1);
+
+        mark_bitmap_for_each_set(
+            g_global_context.chunks().get_root_bitmap(page),
+            mark_bitmap_word_count(page),
+            [&](size_t granule)
+            {
+                UnitHead* const unit = reinterpret_cast<UnitHead*>(
+                    unit_storage + granule * MARK_GRANULE_SIZE);
+
+                // Root units are written without barriers, trace them even if old.
+                if (try_mark_unit_as_gray(unit, true))
+                    m_mark_deque.push(unit);
+            });
+    }
+    void GCWorker::process_gray_units()
+    {
+        do
+        {
+            std::lock_guard g(m_local_work_spin_for_root);
+            for (UnitHead* const unit : m_local_work)
+                m_mark_deque.push(unit);
+            m_local_work.clear();
+        } while (0);
 
-            assert(SELF_MARKED == unit->m_life.load(
-                std::memory_order::memory_order_relaxed));
+        /*
+            灰色单元取出后先预取，放入一个小的 FIFO 环中，等到它从环中出队时才
+            扫描，此时它的单元头和开头的内容大多已经在缓存中了。环中的单元不会
+            被其他 Worker 窃取，但只要环不为空，本 Worker 就不会进入空闲状态。
+        */
+        UnitHead* prefetch_fifo[MARK_PREFETCH_FIFO_SIZE];
+        size_t fifo_begin = 0, fifo_count = 0;
+        size_t scanned_unit_count = 0;
 
-            if (unit->m_attribute & WOOMEM_ATTRIB_MARK_CALLBACK)
+        while (true)
+        {
+            while (fifo_count < MARK_PREFETCH_FIFO_SIZE)
             {
-                m_gc_ctx->callback_user_mark(unit + 1);
+                // 环中还有单元时，不为失败的 pop / drain 付出代价。
+                if (fifo_count != 0 && m_mark_deque.empty())
+                    break;
+
+                UnitHead* unit = m_mark_deque.pop();
+                if (unit == nullptr && take_handed_over_units(*this))
+                {
+                    // NOTE: `take_handed_over_units` contains a acquire order.
+                    //      So, we can sure the `m_life` of the unit to full mark
+                    //      is `SELF_MARKED` we can read.
+                    unit = m_mark_deque.pop();
+                }
+                if (unit == nullptr && fifo_count == 0)
+                    unit = steal_gray_unit();
+                if (unit == nullptr)
+                    break;
+
+                WOOMEM_PREFETCH_READ(unit);
+                prefetch_fifo[(fifo_begin + fifo_count++) % MARK_PREFETCH_FIFO_SIZE] = unit;
             }
-            if (unit->m_attribute & WOOMEM_ATTRIB_AUTO_MARK)
+            if (fifo_count == 0)
             {
-                const size_t auto_mark_step =
-                    unit->get_unit_available_size() / sizeof(void*);
+                // Out of work for now, the counter is up to date while idle.
+                m_marked_unit_count.fetch_add(scanned_unit_count, std::memory_order_relaxed);
+                scanned_unit_count = 0;
+
+                if (wait_for_gray_units_or_termination())
+                    continue;
 
-                void** const p = reinterpret_cast<void**>(unit + 1);
-                for (size_t i = 0; i < auto_mark_step; ++i)
-                    woomem_mark_fuzzy_unit(p[i]);
+                return;
             }
 
-            // Ok mark finished.
+            UnitHead* const unit = prefetch_fifo[fifo_begin];
+            fifo_begin = (fifo_begin + 1) % MARK_PREFETCH_FIFO_SIZE;
+            --fifo_count;
+
+            scan_gray_unit(unit);
+            ++scanned_unit_count;
+        }
+    }
+    void GCWorker::scan_gray_unit(UnitHead* unit)
+    {
+        const bool is_huge_unit = unit->m_next_free_unit_granule == 0;
+        const bool on_worker_thread =
+            std::this_thread::get_id() == m_gc_worker_thread.get_id();
+
+        assert((is_huge_unit ? SELF_MARKED : UNMARKED) == unit->m_life.load(
+            std::memory_order::memory_order_relaxed));
+
+        // Only remembered units can be old here in a minor cycle.
+        if (is_old_unit(unit) && m_gc_ctx->m_gc_minor_cycle.load(std::memory_order_relaxed))
+        {
+            if (on_worker_thread)
+                m_scanning_old_unit = unit;
+            else
+                // Assisting mutator, keep it remembered without checking.
+                g_global_context.chunks().dirty_card(get_page_of_unit(unit));
+        }
+
+        if (unit->m_attribute & WOOMEM_ATTRIB_MARK_CALLBACK)
+        {
+            m_gc_ctx->callback_user_mark(unit + 1);
+        }
+        if (unit->m_type_id != WOOMEM_UNTYPED)
+        {
+            mark_typed_unit_slots(unit, g_type_layouts.get_layout(unit->m_type_id));
+        }
+        else if (unit->m_attribute & WOOMEM_ATTRIB_AUTO_MARK)
+        {
+            mark_fuzzy_slots(
+                reinterpret_cast<void* const*>(unit + 1),
+                unit->get_unit_available_size() / sizeof(void*));
+        }
+
+        if (on_worker_thread)
+            m_scanning_old_unit = nullptr;
+
+        // Ok mark finished.
+        if (is_huge_unit)
             unit->m_life.store(
                 UnitLife::FULL_MARKED,
                 std::memory_order::memory_order_release);
+        else
+        {
+            // Sweep skips marked units in normal pages, age them here
+            // while the head is still in cache.
+            if (unit->m_age != 0)
+                --unit->m_age;
+
+            if (m_gc_ctx->m_gc_generational)
+            {
+                PageHead* const page = get_page_of_unit(unit);
+
+                if (unit->m_age == OLD_UNIT_AGE)
+                    // Just promoted, remember it until its children are old too.
+                    g_global_context.chunks().dirty_card(page);
+
+                // Let the minor sweep of this round visit the page, its
+                // mark bitmap must be cleared.
+                if (page->m_young_unit_round.load(std::memory_order_relaxed)
+                    != woomem_gc_marking_round_counter)
+                    page->m_young_unit_round.store(
+                        woomem_gc_marking_round_counter,
+                        std::memory_order_relaxed);
+            }
+        }
+    }
+    size_t GCWorker::assist_marking(size_t scan_size)
+    {
+        // Units shaded while scanning go to the thread's own stack, see
+        // `mark_unit_to_gray`, only the first ones are stolen from the workers.
+        std::vector<UnitHead*>& gray_units = t_thread_context.m_assist_gray_units;
+        assert(t_thread_context.m_is_assisting_gc && gray_units.empty());
+
+        const size_t worker_count =
+            m_gc_ctx->m_gc_cycle_worker_count.load(std::memory_order_relaxed);
+
+        size_t scanned_size = 0, scanned_unit_count = 0;
+        size_t victim = 0;
+        while (scanned_size < scan_size)
+        {
+            UnitHead* unit = nullptr;
+            if (!gray_units.empty())
+            {
+                unit = gray_units.back();
+                gray_units.pop_back();
+            }
+            else
+            {
+                while (victim < worker_count)
+                {
+                    unit = m_gc_ctx->m_gc_worker_threads[
+                        (m_worker_index + victim) % worker_count].m_mark_deque.steal();
+                    if (unit != nullptr)
+                        break;
+                    ++victim;
+                }
+
+                if (unit == nullptr)
+                    break;
+            }
+
+            scan_gray_unit(unit);
+            scanned_size += sizeof(UnitHead) + unit->get_unit_available_size();
+            ++scanned_unit_count;
+        }
+        m_marked_unit_count.fetch_add(scanned_unit_count, std::memory_order_relaxed);
+        m_assisted_unit_count.fetch_add(scanned_unit_count, std::memory_order_relaxed);
+
+        // Paid off, hand the rest back before leaving the assisting count.
+        for (size_t begin = 0; begin < gray_units.size(); begin += GrayBlock::CAPACITY)
+        {
+            GrayBlock* const block = m_gc_ctx->acquire_gray_block();
+            block->m_count = std::min(GrayBlock::CAPACITY, gray_units.size() - begin);
+            std::copy_n(gray_units.begin() + begin, block->m_count, block->m_units);
+
+            hand_over_gray_block(block);
+        }
+        gray_units.clear();
+        return scanned_size < scan_size ? scan_size - scanned_size : 0;
+    }
+    void GCWorker::mark_fuzzy_slots(void* const* slots, size_t slot_count)
+    {
+        UnitHead* targets[MARK_SLOT_BATCH];
+
+        for (size_t begin = 0; begin < slot_count; begin += MARK_SLOT_BATCH)
+        {
+            const size_t end = std::min(begin + MARK_SLOT_BATCH, slot_count);
+
+            // Validate the whole batch before marking any of it, the lookups
+            // can then miss the cache in parallel instead of queueing behind
+            // the atomic RMW of every mark.
+            size_t target_count = 0;
+            for (size_t i = begin; i < end; ++i)
+            {
+                void* const target = woomem_validate_addr(slots[i]);
+                if (target != nullptr)
+                    targets[target_count++] = reinterpret_cast<UnitHead*>(target) - 1;
+            }
+            for (size_t i = 0; i < target_count; ++i)
+                mark_unit_to_gray(targets[i]);
+        }
+    }
+    void GCWorker::mark_typed_unit_slots(UnitHead* unit, const TypeLayout* layout)
+    {
+        assert(layout != nullptr && layout->m_size <= unit->get_unit_available_size());
+
+        void* const* const slots = reinterpret_cast<void* const*>(unit + 1);
+        UnitHead* targets[MARK_SLOT_BATCH];
+
+        for (size_t begin = 0; begin < layout->m_pointer_slot_count;
+            begin += MARK_SLOT_BATCH)
+        {
+            const size_t end = std::min(
+                begin + MARK_SLOT_BATCH, layout->m_pointer_slot_count);
+
+            // Issue the loads of all target heads first, then mark them.
+            size_t target_count = 0;
+            for (size_t i = begin; i < end; ++i)
+            {
+                void* const target = slots[layout->m_pointer_slots[i]];
+                if (target != nullptr)
+                {
+                    UnitHead* const target_head = reinterpret_cast<UnitHead*>(target) - 1;
+
+                    WOOMEM_PREFETCH_READ(target_head);
+                    targets[target_count++] = target_head;
+                }
+            }
+            for (size_t i = 0; i < target_count; ++i)
+                mark_unit_to_gray(targets[i]);
         }
     }
     void GCWorker::worker_thread_job()
@@ -603,34 +1618,51 @@ namespace woomem
         t_thread_context.m_is_gc_worker_context = true;
         t_thread_context.m_gc_marking_context = this;
 
+        const std::vector<size_t>& worker_cpus = m_gc_ctx->m_gc_worker_cpus;
+        // Best effort, the worker still runs if pinning is not supported.
+        if (!worker_cpus.empty())
+            (void)woomem_os_pin_current_thread_to_cpu(
+                worker_cpus[m_worker_index % worker_cpus.size()]);
+        else if (m_gc_ctx->m_numa_node_count > 1)
+            (void)woomem_os_pin_current_thread_to_numa_node(m_numa_node);
+
         m_gc_ctx->callback_worker_entry();
 
         do
         {
             if (!m_gc_ctx->wait_for_worker_launch_or_shutdown(
-                GC::WorkerThresholdState::PARALLEL_MARK))
+                GC::WorkerThresholdState::PARALLEL_MARK, m_worker_index))
             {
                 return;
             }
             else
+            {
+                trace_event(WOOMEM_TRACE_WORKER_BEGIN, WOOMEM_GC_PHASE_PARALLEL_MARK, m_worker_index);
+                mark_root_pages();
                 process_gray_units();
-
+                trace_event(WOOMEM_TRACE_WORKER_END, WOOMEM_GC_PHASE_PARALLEL_MARK, m_worker_index);
+            }
             m_gc_ctx->worker_done_and_notify_main_gc_thread();
             m_gc_ctx->wait_for_worker_launch(GC::WorkerThresholdState::FINAL_MARK);
             {
+                trace_event(WOOMEM_TRACE_WORKER_BEGIN, WOOMEM_GC_PHASE_FINAL_MARK, m_worker_index);
                 process_gray_units();
+                trace_event(WOOMEM_TRACE_WORKER_END, WOOMEM_GC_PHASE_FINAL_MARK, m_worker_index);
             }
             m_gc_ctx->worker_done_and_notify_main_gc_thread();
             m_gc_ctx->wait_for_worker_launch(GC::WorkerThresholdState::SWEEP);
             {
+                trace_event(WOOMEM_TRACE_WORKER_BEGIN, WOOMEM_GC_PHASE_SWEEP, m_worker_index);
+
+                // Marking is over, nobody is stealing from this worker now.
+                m_mark_deque.reclaim_retired_buffers();
+
                 m_alive_memory_size_counter = 0;
 
-                for (PageHead* page = m_sweep_page_list; page != nullptr;)
-                {
-                    PageHead* const next_page = page->m_next_page;
-                    sweep_units_in_page(page);
-                    page = next_page;
-                }
+                while (sweep_next_batch(m_alive_memory_size_counter, m_numa_node))
+                    ;
+
+                trace_event(WOOMEM_TRACE_WORKER_END, WOOMEM_GC_PHASE_SWEEP, m_worker_index);
             }
             m_gc_ctx->worker_done_and_notify_main_gc_thread();
 
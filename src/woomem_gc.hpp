@@ -1,42 +1,74 @@
 #pragma once
 
 #include "woomem.h"
-#include "woomem_mpsc_queue.hpp"
+#include "woomem_gray_block.hpp"
+#include "woomem_work_stealing_deque.hpp"
 #include "woomem_lock.hpp"
+#include "woomem_gc_pacer.hpp"
 
 #include <atomic>
 #include <vector>
 #include <thread>
-#include <array>
 #include <condition_variable>
-#include <unordered_set>
 
 namespace woomem
 {
     class GC;
     struct UnitHead;
     struct PageHead;
+    struct TypeLayout;
 
     class GCWorker
     {
         friend class GC;
 
         GC* m_gc_ctx;
+        const size_t m_worker_index;
+        // The node the worker runs on, it sweeps that node's pages first.
+        // Always 0 unless the heap is NUMA aware.
+        const size_t m_numa_node;
 
-        static constexpr size_t GRAY_QUEUE_CAPACITY = 8192;
-        MpscGrayQueue<GRAY_QUEUE_CAPACITY> m_gray_queue;
+        // Capacity reserved up front for the root units of `m_local_work`.
+        static constexpr size_t LOCAL_WORK_RESERVE = 8192;
+        // Estimated sweep cost of a batch, in units to visit.
+        static constexpr size_t SWEEP_BATCH_COST = 8192;
+        // Gray units are prefetched this many scans ahead of being scanned.
+        static constexpr size_t MARK_PREFETCH_FIFO_SIZE = 8;
+        // Slots of a unit are loaded (and validated if conservative) in
+        // groups of this size before their targets are marked.
+        static constexpr size_t MARK_SLOT_BATCH = 8;
+        // Root pages claimed by a worker at a time, see `GC::m_root_pages`.
+        static constexpr size_t ROOT_PAGE_BATCH = 16;
 
+        // Blocks of gray units handed over by other threads, see
+        // `mark_unit_to_gray`. Any worker may take them, not only this one.
+        GrayBlockStack m_handed_over_blocks;
+
+        // Root units assigned to this worker by `GC::assign_root_gray_unit`,
+        // moved into `m_mark_deque` once marking starts.
         Spinlock m_local_work_spin_for_root;
         std::vector<UnitHead*> m_local_work;
-        std::atomic<bool> m_is_draining{false};
-        std::array<UnitHead*, GRAY_QUEUE_CAPACITY> m_drain_buf;
 
-        PageHead* m_sweep_page_list;
+        // Gray units owned by this worker while draining, idle workers steal
+        // from its top.
+        WorkStealingDeque m_mark_deque;
+
         size_t m_alive_memory_size_counter;
 
+        // Since woomem_init, for woomem_get_stats. Mutators assisting the
+        // worker add theirs too, so both are updated once per batch of work.
+        std::atomic_size_t m_marked_unit_count;
+        std::atomic_size_t m_freed_unit_count;
+        // Part of `m_marked_unit_count` scanned by assisting mutators.
+        std::atomic_size_t m_assisted_unit_count;
+
+        // Old unit being scanned by this worker in a minor cycle. Its card is
+        // dirtied again if it still refers to young units.
+        UnitHead* m_scanning_old_unit;
+
         std::thread m_gc_worker_thread;
     public:
-        GCWorker(GC* gc_ctx);
+        GCWorker(GC* gc_ctx, size_t worker_index);
         ~GCWorker();
 
         GCWorker(const GCWorker&) = delete;
@@ -46,18 +78,39 @@ namespace woomem
 
     public:
         void mark_unit_to_gray(UnitHead* unit_head);
+        // Pushes a block of gray units to this worker, or to an active one if
+        // this worker is parked in the cycle.
+        void hand_over_gray_block(GrayBlock* block);
         bool check_and_free_unmarked_unit(UnitHead* unit, PageHead* page_may_null);
-        void sweep_units_in_page(PageHead* page);
+        void sweep_units_in_page(PageHead* page, size_t& alive_memory_size);
+        // Claims and sweeps the next batch of `GC::m_sweep_pages`, of
+        // `numa_node` if it has any left. Returns false if none is left.
+        bool sweep_next_batch(size_t& alive_memory_size, size_t numa_node);
 
     private:
+        void mark_root_pages();
+        void mark_root_units_in_page(PageHead* page);
         void process_gray_units();
-        void drain_queue_into_local();
+        void scan_gray_unit(UnitHead* unit);
+        // Runs on a mutator thread bound to this worker, scans gray units of
+        // at least `scan_size` bytes in total. Returns the size left if there
+        // was nothing more to steal.
+        size_t assist_marking(size_t scan_size);
+        void mark_fuzzy_slots(void* const* slots, size_t slot_count);
+        void mark_typed_unit_slots(UnitHead* unit, const TypeLayout* layout);
+        // Moves the blocks handed over to `owner` into this worker's deque.
+        // Returns false if there was none.
+        bool take_handed_over_units(GCWorker& owner);
+        UnitHead* steal_gray_unit();
+        bool wait_for_gray_units_or_termination();
 
     public:
         void worker_thread_job();
     };
     class GC
     {
+        friend class GCWorker;
+
     public:
         enum class WorkerThresholdState
         {
@@ -66,9 +119,22 @@ namespace woomem
             FINAL_MARK,
             SWEEP,
         };
+        enum class MutatorAssistState : uint8_t
+        {
+            NONE,
+            MARK,
+            SWEEP,
+        };
 
     private:
-        const size_t            m_gc_worker_count;
+        // Worker threads are created up front for the limit, only the first
+        // `m_gc_cycle_worker_count` take part in a cycle, the rest stay parked.
+        const size_t            m_gc_max_worker_count;
+        std::atomic_size_t      m_gc_requested_worker_count;
+        std::atomic_size_t      m_gc_cycle_worker_count;
+        std::vector<size_t>     m_gc_worker_cpus;
+        // Worker i runs on node i % m_numa_node_count unless pinned to CPUs.
+        const size_t            m_numa_node_count;
         std::atomic_size_t      m_gc_assigned_thread_idx;
         std::atomic_bool        m_shutdown;
         std::atomic_bool        m_worker_shutdown;
@@ -87,16 +153,102 @@ namespace woomem
         GCWorker*               m_gc_worker_threads;
         std::thread             m_gc_main_thread;
 
+        // Workers of the current mark phase which found no gray unit to
+        // process or steal; the phase ends once all of them are idle.
+        std::atomic_size_t      m_gc_idle_marking_worker_count;
+
+        // Gray blocks not in use, recycled through `acquire_gray_block` and
+        // `release_gray_block`. Allocated on demand, the count never shrinks.
+        Spinlock                m_free_gray_blocks_spin;
+        std::vector<GrayBlock*> m_free_gray_blocks;
+        std::atomic_size_t      m_gray_block_count;
+
+        // Pages holding root units, collected from the chunks' root tables at
+        // the beginning of a cycle. Workers claim ROOT_PAGE_BATCH of them at a
+        // time through `m_root_page_cursor` when parallel marking starts.
+        std::vector<PageHead*>  m_root_pages;
+        std::atomic_size_t      m_root_page_cursor;
+
+        // Pages to sweep in the current cycle, cut into batches of similar
+        // estimated cost. The batches of each NUMA node are contiguous and
+        // claimed through the node's cursor while mutators keep running;
+        // threads take batches of their own node before the others'.
+        struct alignas(64) SweepNodeCursor
+        {
+            std::atomic_size_t  m_next_batch;
+            size_t              m_end_batch;
+        };
+        std::vector<PageHead*>  m_sweep_pages;
+        std::vector<size_t>     m_sweep_batch_ends;
+        std::vector<SweepNodeCursor> m_sweep_node_cursors;
+
+        // Mutator assist: while a cycle is in PARALLEL_MARK or SWEEP, threads
+        // which allocated more than `m_gc_assist_alloc_size` since its trigger
+        // scan `m_gc_assist_scan_ratio` bytes of gray units per allocated byte,
+        // or sweep a batch, themselves. Those which still owe scan work when
+        // nothing can be stolen wait until there is, or marking is over.
+        // Workers do not finish marking while mutators are assisting, and the
+        // main thread waits for them before leaving a phase.
+        std::atomic<MutatorAssistState> m_mutator_assist_state;
+        std::atomic_size_t      m_assisting_mutator_count;
+        std::atomic_size_t      m_assisted_alive_memory_size;
+
+        // Generational mode: whether the current cycle is minor, i.e. old
+        // units are neither traced nor swept, and the state used to decide it.
+        std::atomic_bool        m_gc_minor_cycle;
+        size_t                  m_gc_minor_cycle_count_since_major;
+        size_t                  m_gc_alive_size_after_last_major;
+        std::vector<PageHead*>  m_remembered_pages;
+
+        // Set from a cycle's trigger until it has swept and purged. Outside of
+        // it nobody traces or sweeps units, so that reallocation can release
+        // the old unit at once, see `begin_eager_release`.
+        std::atomic_bool        m_gc_cycle_running;
+        std::atomic_size_t      m_eager_releasing_mutator_count;
+
+        // Durations of the phases of the last cycle and of all cycles, in
+        // nanoseconds, indexed by woomem_GCPhase.
+        std::atomic<uint64_t>   m_phase_last_ns[WOOMEM_GC_PHASE_COUNT];
+        std::atomic<uint64_t>   m_phase_total_ns[WOOMEM_GC_PHASE_COUNT];
+
         std::atomic<bool>       m_force_trigger_gc;
+        std::atomic<bool>       m_force_major_gc;
         std::mutex              m_trigger_mx;
         std::condition_variable m_trigger_cv;
+        // Cycles which finished marking, what `trigger_gc` waits for, and
+        // cycles which finished sweeping as well. Both guarded by
+        // `m_trigger_mx` for writing.
         std::atomic<size_t>     m_gc_cycle_count;
+        std::atomic<size_t>     m_gc_swept_cycle_count;
 
-        Spinlock                m_root_gc_unit_set_mx;
-        std::unordered_set<UnitHead*> m_root_gc_unit_set;
+        // Guarded by `m_trigger_mx`, its trigger size is mirrored in
+        // `m_gc_trigger_alloc_size` for the allocation path.
+        GCPacer                 m_pacer;
 
     public:
+        static constexpr size_t DEFAULT_PURGE_RETAINED_DIRTY_SIZE = 64 * 1024 * 1024;
+        static constexpr size_t DEFAULT_PURGE_MIN_IDLE_ROUNDS = 2;
+        // Without cycles the main thread still purges this often, each
+        // interval counting as a round.
+        static constexpr size_t PURGE_IDLE_INTERVAL_MS = 1000;
+
+        // A major cycle runs after this many minor cycles in a row, or once
+        // the alive size has grown by GC_MAJOR_ALIVE_GROWTH_RATIO since the
+        // last major cycle.
+        static constexpr size_t GC_MAX_MINOR_CYCLES_BETWEEN_MAJOR = 8;
+        static constexpr size_t GC_MAJOR_ALIVE_GROWTH_RATIO = 2;
+
+        const bool              m_gc_generational;
+        const bool              m_gc_mutator_assist;
+
         std::atomic<size_t>     m_new_allocated_size_since_last_gc;
+        // The main thread is woken up once `m_new_allocated_size_since_last_gc`
+        // crosses it, see `notify_allocation_trigger`.
+        std::atomic<size_t>     m_gc_trigger_alloc_size;
+        std::atomic<size_t>     m_gc_assist_alloc_size;
+        std::atomic<size_t>     m_gc_assist_scan_ratio;
+        std::atomic<size_t>     m_purge_retained_dirty_size;
+        std::atomic<size_t>     m_purge_min_idle_rounds;
 
     public:
         GC(const GC&) = delete;
@@ -104,22 +256,19 @@ namespace woomem
         GC(GC&&) = delete;
         GC& operator=(GC&&) = delete;
 
-        GC(size_t worker_count, 
-            woomem_GCCallback callback_for_marking_root,
-            woomem_GCCallback callback_stop_marking,
-            woomem_MarkCallback user_mark_callback,
-            woomem_FreeCallback user_free_callback,
-            woomem_GCMainThreadEntryCallback main_entry_callback,
-            woomem_GCWorkerThreadEntryCallback worker_entry_callback);
+        explicit GC(const woomem_InitConfig* config);
         ~GC();
 
     public:
+        void launch_worker(
+            WorkerThresholdState expected_state);
+        void wait_until_worker_done();
         void launch_worker_and_wait_until_done(
             WorkerThresholdState expected_state);
         void wait_for_worker_launch(
             WorkerThresholdState expected_state);
         bool wait_for_worker_launch_or_shutdown(
-            WorkerThresholdState expected_state);
+            WorkerThresholdState expected_state, size_t worker_index);
         void signal_worker_shutdown();
         void worker_done_and_notify_main_gc_thread();
 
@@ -129,10 +278,52 @@ namespace woomem
 
     public:
         void mark_root_unit_to_gray(UnitHead* unit_head);
+        // Minor cycles only: traces `unit_head` even if it is old.
+        void mark_remembered_unit_to_gray(UnitHead* unit_head);
+        void mark_units_in_remembered_page(PageHead* page);
         GCWorker* fetch_thread_worker();
-        void trigger_gc(bool async);
+        void trigger_gc(bool async, bool major);
+        // Waits until all cycles which finished marking have been swept.
+        void wait_for_sweep();
+        // Called by the thread whose allocation crossed `m_gc_trigger_alloc_size`.
+        void notify_allocation_trigger();
+        void set_pacer_policy(
+            size_t heap_growth_percent, size_t soft_memory_limit, size_t gc_cpu_percent);
+        // Called by allocating threads which have run over their allowance in
+        // a cycle with the size they just allocated, `context_worker` is the
+        // thread's `m_gc_marking_context`.
+        void assist_allocation(GCWorker* context_worker, size_t allocated_size);
+        void set_worker_count(size_t worker_count);
+        size_t get_worker_count() const;
+        // Fills the GC part of woomem_Stats.
+        void collect_stats(woomem_Stats* out_stats) const;
         void register_root_unit_head(UnitHead* unit_head);
         void unregister_root_unit_head(UnitHead* unit_head);
+        // Returns false if a cycle is running. Otherwise no cycle starts until
+        // `end_eager_release`, units may be released by `release_unit_eagerly`
+        // meanwhile.
+        bool begin_eager_release();
+        void end_eager_release();
+        // False if the unit is a root or not allocated completely, it is left
+        // to the GC then. Changes nothing.
+        bool can_release_unit_eagerly(UnitHead* unit_head) const;
+        // Frees an unreachable unit without waiting for the sweep, and without
+        // its free callback. Returns false, see `can_release_unit_eagerly`.
+        bool release_unit_eagerly(UnitHead* unit_head);
+    private:
+        void assign_root_gray_unit(UnitHead* unit_head);
+        GrayBlock* acquire_gray_block();
+        void release_gray_block(GrayBlock* block);
+        // Pushes the partly filled gray blocks of all threads to `receiver`.
+        // Returns false if no thread had one.
+        bool collect_thread_gray_blocks(GCWorker& receiver);
+        size_t eval_worker_numa_node(size_t worker_index) const;
+        bool decide_minor_cycle();
+        void open_mutator_assist(MutatorAssistState state);
+        void close_mutator_assist();
+        void update_pacer_sizes();
+        void purge_idle_pages();
+
     public:
         void main_thread_job();
     };
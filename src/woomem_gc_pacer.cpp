@@ -0,0 +1,111 @@
+#include "woomem_gc_pacer.hpp"
+
+#include <algorithm>
+
+namespace woomem
+{
+    GCPacer::GCPacer()
+        : m_heap_growth_percent(DEFAULT_HEAP_GROWTH_PERCENT)
+        , m_soft_memory_limit(0)
+        , m_gc_cpu_percent(0)
+        , m_alive_size(0)
+        , m_runway_size(0)
+        , m_gc_cpu_share(0.0)
+        , m_budget_size(0)
+        , m_trigger_size(0)
+    {
+        update();
+    }
+
+    void GCPacer::set_policy(
+        size_t heap_growth_percent, size_t soft_memory_limit, size_t gc_cpu_percent)
+    {
+        m_heap_growth_percent =
+            heap_growth_percent != 0 ? heap_growth_percent : DEFAULT_HEAP_GROWTH_PERCENT;
+        m_soft_memory_limit = soft_memory_limit;
+        m_gc_cpu_percent = std::min<size_t>(gc_cpu_percent, 100);
+
+        update();
+    }
+
+    void GCPacer::end_cycle(
+        size_t alive_size,
+        size_t allocated_while_marking,
+        uint64_t busy_ns,
+        size_t busy_thread_count,
+        uint64_t period_ns,
+        size_t cpu_count)
+    {
+        m_alive_size = alive_size;
+
+        // Half of the weight goes to the last cycle, so a change of the
+        // allocation rate is followed within a few cycles.
+        m_runway_size = m_runway_size / 2 + allocated_while_marking / 2;
+
+        if (period_ns != 0 && cpu_count != 0)
+        {
+            const double share = std::min(1.0,
+                static_cast<double>(busy_ns) * static_cast<double>(busy_thread_count)
+                / (static_cast<double>(period_ns) * static_cast<double>(cpu_count)));
+
+            m_gc_cpu_share = (m_gc_cpu_share + share) / 2;
+        }
+
+        update();
+    }
+
+    size_t GCPacer::get_trigger_size() const
+    {
+        return m_trigger_size;
+    }
+    size_t GCPacer::get_budget_size() const
+    {
+        return m_budget_size;
+    }
+    size_t GCPacer::get_cycle_allowance_size() const
+    {
+        return std::max(m_budget_size - m_trigger_size, MIN_BUDGET);
+    }
+    size_t GCPacer::get_assist_scan_ratio() const
+    {
+        const size_t alive = std::max(MIN_ALIVE_EDGE, m_alive_size);
+        const size_t allowance = get_cycle_allowance_size();
+
+        return (alive + allowance - 1) / allowance;
+    }
+
+    void GCPacer::update()
+    {
+        const size_t alive = std::max(MIN_ALIVE_EDGE, m_alive_size);
+
+        double budget = static_cast<double>(alive)
+            * static_cast<double>(m_heap_growth_percent) / 100.0;
+
+        // Collecting too often, let the heap grow more between cycles.
+        if (m_gc_cpu_percent != 0)
+        {
+            const double target = static_cast<double>(m_gc_cpu_percent) / 100.0;
+            if (m_gc_cpu_share > target)
+                budget *= std::min(
+                    m_gc_cpu_share / target, static_cast<double>(MAX_CPU_STRETCH));
+        }
+
+        // The limit wins over the CPU target.
+        if (m_soft_memory_limit != 0)
+        {
+            const size_t headroom = m_soft_memory_limit > m_alive_size
+                ? m_soft_memory_limit - m_alive_size
+                : 0;
+            budget = std::min(budget, static_cast<double>(headroom));
+        }
+
+        m_budget_size = std::max(MIN_BUDGET, static_cast<size_t>(budget));
+
+        // Start early enough for marking to end within the budget, but never
+        // collect again right after a cycle.
+        const size_t trigger = m_budget_size > m_runway_size
+            ? m_budget_size - m_runway_size
+            : 0;
+        m_trigger_size = std::max(trigger, m_budget_size / 4);
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace woomem
+{
+    /*
+    Decides how many bytes may be allocated after a cycle before the next one
+    starts. The budget is `heap_growth_percent` of the alive size, stretched
+    while the GC uses more than `gc_cpu_percent` of the machine and capped so
+    that the heap stays below `soft_memory_limit`. Marking runs concurrently
+    with mutators, so the trigger is placed the expected allocation during
+    marking (the runway) before the end of the budget.
+
+    Not thread safe, the owner serializes all calls.
+    */
+    class GCPacer
+    {
+    public:
+        // The old fixed trigger: a third of the alive size.
+        static constexpr size_t DEFAULT_HEAP_GROWTH_PERCENT = 33;
+        // Smaller alive sizes are considered this large.
+        static constexpr size_t MIN_ALIVE_EDGE = 1024 * 1024;
+        // Lower bound of the budget, even when over the soft memory limit.
+        static constexpr size_t MIN_BUDGET = 256 * 1024;
+        // The CPU target stretches the budget by at most this factor.
+        static constexpr size_t MAX_CPU_STRETCH = 4;
+
+        GCPacer();
+
+        GCPacer(const GCPacer&) = delete;
+        GCPacer(GCPacer&&) = delete;
+        GCPacer& operator=(const GCPacer&) = delete;
+        GCPacer& operator=(GCPacer&&) = delete;
+
+        // 0 selects the default growth, and disables the limit or CPU target.
+        void set_policy(
+            size_t heap_growth_percent, size_t soft_memory_limit, size_t gc_cpu_percent);
+
+        // Records a finished cycle: `allocated_while_marking` bytes were
+        // allocated between its trigger and the end of marking, its threads
+        // were busy for `busy_ns` of the `period_ns` since the previous cycle
+        // started, on `cpu_count` CPUs.
+        void end_cycle(
+            size_t alive_size,
+            size_t allocated_while_marking,
+            uint64_t busy_ns,
+            size_t busy_thread_count,
+            uint64_t period_ns,
+            size_t cpu_count);
+
+        // Allocated bytes since the last trigger which start the next cycle.
+        size_t get_trigger_size() const;
+        // Bytes which may be allocated in total before marking should end.
+        size_t get_budget_size() const;
+        // Bytes which may be allocated once a cycle started, at least
+        // MIN_BUDGET. Threads allocating beyond it should assist the cycle.
+        size_t get_cycle_allowance_size() const;
+        // Bytes an assisting thread scans per byte it allocated, such that
+        // marking the alive size is paid for within the cycle's allowance.
+        size_t get_assist_scan_ratio() const;
+
+    private:
+        void update();
+
+        size_t      m_heap_growth_percent;
+        size_t      m_soft_memory_limit;
+        size_t      m_gc_cpu_percent;
+
+        size_t      m_alive_size;
+        // Averaged over the past cycles, the share is a fraction of the
+        // whole machine.
+        size_t      m_runway_size;
+        double      m_gc_cpu_share;
+
+        size_t      m_budget_size;
+        size_t      m_trigger_size;
+    };
+}
@@ -7,10 +7,12 @@
 namespace woomem
 {
     GlobalContext::GlobalContext()
-        : m_chunk_storage{}
-        , m_gpc_storage{}
-        , m_globalcontext_alive(true)
+        : m_globalcontext_alive(true)
         , m_globalcontext_inited(false)
+        , m_chunk_huge_page_backing(false)
+        , m_numa_aware(false)
+        , m_chunks_storage{}
+        , m_numa_node_count(1)
     {}
 
     GlobalContext::~GlobalContext()
@@ -27,13 +29,19 @@ namespace woomem
     {
         assert(!m_globalcontext_inited);
 
-        (void)new (&chunk()) Chunk(reserved_chunk_size);
-        if (chunk().is_init_failed())
+        m_numa_node_count = m_numa_aware ? woomem_os_numa_node_count() : 1;
+
+        (void)new (&chunks()) ChunkRegistry(
+            reserved_chunk_size, m_chunk_huge_page_backing, m_numa_node_count);
+        if (chunks().is_init_failed())
         {
-            chunk().~Chunk();
+            chunks().~ChunkRegistry();
+            m_numa_node_count = 1;
             return false;
         }
-        (void)new (&gpc()) GlobalPageCollection(&chunk());
+        for (size_t node = 0; node < m_numa_node_count; ++node)
+            m_gpcs.push_back(new GlobalPageCollection(&chunks(), node));
+
         m_globalcontext_inited = true;
 
         do
@@ -42,7 +50,7 @@ namespace woomem
             for (auto* thread_ctx : m_thread_entries)
             {
                 thread_ctx->m_thread_page_collection.init_manually(
-                    &gpc());
+                    gpcs(), m_numa_node_count);
             }
         } while (0);
 
@@ -62,13 +70,16 @@ namespace woomem
             }
         } while (0);
 
-        gpc().~GlobalPageCollection();
-        chunk().~Chunk();
+        for (GlobalPageCollection* gpc : m_gpcs)
+            delete gpc;
+        m_gpcs.clear();
+        chunks().~ChunkRegistry();
+        m_numa_node_count = 1;
 
         m_globalcontext_inited = false;
     }
 
-    void GlobalContext::add_new_page_into_chain(PageHead* page)
+    void GlobalContext::publish_new_page(PageHead* page)
     {
         assert(page->m_page_just_allocated.load(
             std::memory_order::memory_order_relaxed));
@@ -76,23 +87,12 @@ namespace woomem
         page->m_page_just_allocated.store(
             false, std::memory_order::memory_order_release);
 
-        add_page_back_to_into_chain(page);
-    }
-    void GlobalContext::add_page_back_to_into_chain(PageHead* page)
-    {
-        page->m_next_page = m_all_page_list.load(std::memory_order_relaxed);
-
-        while (!m_all_page_list.compare_exchange_weak(
-            page->m_next_page,
-            page,
-            std::memory_order_release,
-            std::memory_order_relaxed))
-            /* Atomic retry */;
+        chunks().publish_page(page);
     }
 
     PageHead* GlobalContext::allocate_huge_page(size_t size)
     {
-        return chunk().allocate_huge_page(size);
+        return chunks().allocate_huge_page(size, current_numa_node());
     }
 
     GlobalContext g_global_context;
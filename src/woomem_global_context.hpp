@@ -1,11 +1,12 @@
 #pragma once
 
-#include "woomem_chunk.hpp"
+#include "woomem_chunk_registry.hpp"
 #include "woomem_global_page_collection.hpp"
 
 #include <atomic>
 #include <mutex>
 #include <unordered_set>
+#include <vector>
 
 namespace woomem
 {
@@ -16,10 +17,11 @@ namespace woomem
     public:
         bool m_globalcontext_alive;
         bool m_globalcontext_inited;
+        bool m_chunk_huge_page_backing;
+        bool m_numa_aware;
 
         std::mutex m_thread_entries_mx;
         std::unordered_set<ThreadContext*> m_thread_entries;
-        std::atomic<PageHead*> m_all_page_list;
 
         GlobalContext();
         ~GlobalContext();
@@ -29,21 +31,34 @@ namespace woomem
         GlobalContext(GlobalContext&&) = delete;
         GlobalContext& operator=(GlobalContext&&) = delete;
 
+        // With `m_numa_aware` on a NUMA machine, chunks and page collections
+        // are kept per node.
         bool init(size_t reserved_chunk_size);
         void shutdown();
 
-        void add_new_page_into_chain(PageHead* page);
-        void add_page_back_to_into_chain(PageHead* page);
+        // Hands a just allocated page over to the GC, which finds it through
+        // its chunk from then on until it is freed.
+        void publish_new_page(PageHead* page);
+        // Taken from the node the calling thread runs on.
         PageHead* allocate_huge_page(size_t size);
 
-        Chunk& chunk() { return reinterpret_cast<Chunk&>(m_chunk_storage); }
-        const Chunk& chunk() const { return reinterpret_cast<const Chunk&>(m_chunk_storage); }
-        GlobalPageCollection& gpc() { return reinterpret_cast<GlobalPageCollection&>(m_gpc_storage); }
-        const GlobalPageCollection& gpc() const { return reinterpret_cast<const GlobalPageCollection&>(m_gpc_storage); }
+        size_t numa_node_count() const { return m_numa_node_count; }
+        size_t current_numa_node() const { return GlobalPageCollection::current_numa_node(m_numa_node_count); }
+
+        ChunkRegistry& chunks() { return reinterpret_cast<ChunkRegistry&>(m_chunks_storage); }
+        const ChunkRegistry& chunks() const { return reinterpret_cast<const ChunkRegistry&>(m_chunks_storage); }
+        GlobalPageCollection& gpc(size_t numa_node) { return *m_gpcs[numa_node]; }
+        // The collection of the node `page` belongs to.
+        GlobalPageCollection& gpc_of_page(PageHead* page)
+        {
+            return *m_gpcs[m_numa_node_count > 1 ? chunks().get_numa_node(page) : 0];
+        }
+        GlobalPageCollection* const* gpcs() const { return m_gpcs.data(); }
 
     private:
-        alignas(Chunk) char m_chunk_storage[sizeof(Chunk)];
-        alignas(GlobalPageCollection) char m_gpc_storage[sizeof(GlobalPageCollection)];
+        alignas(ChunkRegistry) char m_chunks_storage[sizeof(ChunkRegistry)];
+        size_t m_numa_node_count;
+        std::vector<GlobalPageCollection*> m_gpcs;
     };
 
     extern GlobalContext g_global_context;
@@ -2,81 +2,177 @@
 
 #include <atomic>
 #include <cassert>
-#include <vector>
+#include <mutex>
 
-#include "woomem_chunk.hpp"
+#include "woomem.h"
+#include "woomem_chunk_registry.hpp"
+#include "woomem_lock.hpp"
+#include "woomem_os_thread.h"
 #include "woomem_page.hpp"
 #include "woomem_page_unit_alloc.hpp"
 
 namespace woomem
 {
+    /*
+    Spans of one NUMA node, the heap has a collection for each node. Spans
+    are always given back to the collection of the node they belong to.
+    */
     class GlobalPageCollection
     {
-        struct FreePageList
+    public:
+        // Recycled spans of every group are spread over this many stacks, so
+        // that refilling threads and sweeping workers rarely meet on a lock.
+        static constexpr size_t FREE_PAGE_SHARD_COUNT = 8;
+
+    private:
+        /*
+        An intrusive stack of spans linked through `m_next_free_page`. Spans
+        marked as run out are unlinked when met, no slot is left behind.
+
+        NOTE: Not lock-free on purpose: a popping thread reading the link of a
+            span which another thread has just taken could find it freed and
+            decommitted by then.
+        */
+        struct alignas(64) FreePageShard
         {
-            std::atomic_flag        m_spin;
-            std::vector<PageHead*>  m_pages;
+            Spinlock                m_spin;
+            // Loaded without the lock to skip empty shards.
+            std::atomic<PageHead*>  m_top;
+            // Written under the lock, read without it for woomem_get_stats.
+            std::atomic_size_t      m_page_count;
 
-            FreePageList()
+            FreePageShard()
+                : m_top(nullptr)
+                , m_page_count(0)
             {
-                m_spin.clear();
             }
 
-            FreePageList(const FreePageList&) = delete;
-            FreePageList(FreePageList&&) = delete;
-            FreePageList& operator=(const FreePageList&) = delete;
-            FreePageList& operator=(FreePageList&&) = delete;
+            FreePageShard(const FreePageShard&) = delete;
+            FreePageShard(FreePageShard&&) = delete;
+            FreePageShard& operator=(const FreePageShard&) = delete;
+            FreePageShard& operator=(FreePageShard&&) = delete;
 
-            PageHead* pick_free_page()
+            static bool drop_if_marked_as_run_out(PageHead* page)
             {
-                while (m_spin.test_and_set(std::memory_order_acquire))
-                    ;
+                PageUnitAlloc* const page_alloc_head =
+                    reinterpret_cast<PageUnitAlloc*>(page + 1);
 
-                PageHead* page = nullptr;
-                while (!m_pages.empty())
-                {
-                    page = m_pages.back();
-                    m_pages.pop_back();
+                if (!page_alloc_head->m_mark_as_run_out_in_global_pool)
+                    return false;
 
-                    if (page == nullptr)
-                        continue;
+                page_alloc_head->m_mark_as_run_out_in_global_pool = false;
+                page_alloc_head->m_run_out.store(
+                    1, std::memory_order::memory_order_release);
 
-                    PageUnitAlloc* const page_alloc_head = 
-                        reinterpret_cast<PageUnitAlloc*>(page + 1);
+                return true;
+            }
 
-                    if (page_alloc_head->m_mark_as_run_out_in_global_pool)
-                    {
-                        page_alloc_head->m_mark_as_run_out_in_global_pool = false;
-                        page_alloc_head->m_run_out.store(
-                            1, std::memory_order::memory_order_release);
+            // Dropped spans are counted into `dropped_count`.
+            size_t pick_free_pages(PageHead** out_pages, size_t max_count, size_t& dropped_count)
+            {
+                if (m_top.load(std::memory_order_relaxed) == nullptr)
+                    return 0;
 
-                        page = nullptr;
-                        continue;
-                    }
-                    break;
+                std::lock_guard g(m_spin);
+
+                size_t count = 0, unlinked_count = 0;
+                PageHead* page = m_top.load(std::memory_order_relaxed);
+                while (count < max_count && page != nullptr)
+                {
+                    PageHead* const next = page->m_next_free_page;
+                    if (!drop_if_marked_as_run_out(page))
+                        out_pages[count++] = page;
+
+                    ++unlinked_count;
+                    page = next;
                 }
+                m_top.store(page, std::memory_order_relaxed);
+                m_page_count.store(
+                    m_page_count.load(std::memory_order_relaxed) - unlinked_count,
+                    std::memory_order_relaxed);
 
-                m_spin.clear(std::memory_order_release);
-                return page;
+                dropped_count += unlinked_count - count;
+                return count;
             }
             void return_free_page(PageHead* page)
             {
-                while (m_spin.test_and_set(std::memory_order_acquire))
-                    ;
+                std::lock_guard g(m_spin);
+
+                page->m_next_free_page = m_top.load(std::memory_order_relaxed);
+                m_top.store(page, std::memory_order_relaxed);
+                m_page_count.store(
+                    m_page_count.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_relaxed);
+            }
+            // Returns the count of dropped spans.
+            size_t remove_marked_run_out_pages()
+            {
+                if (m_top.load(std::memory_order_relaxed) == nullptr)
+                    return 0;
 
-                m_pages.push_back(page);
+                std::lock_guard g(m_spin);
 
-                m_spin.clear(std::memory_order_release);
+                size_t dropped_count = 0;
+                PageHead* kept_top = nullptr;
+                PageHead** kept_tail = &kept_top;
+                for (PageHead* page = m_top.load(std::memory_order_relaxed), *next;
+                    page != nullptr;
+                    page = next)
+                {
+                    next = page->m_next_free_page;
+                    if (!drop_if_marked_as_run_out(page))
+                    {
+                        *kept_tail = page;
+                        kept_tail = &page->m_next_free_page;
+                    }
+                    else
+                        ++dropped_count;
+                }
+                *kept_tail = nullptr;
+                m_top.store(kept_top, std::memory_order_relaxed);
+                m_page_count.store(
+                    m_page_count.load(std::memory_order_relaxed) - dropped_count,
+                    std::memory_order_relaxed);
+
+                return dropped_count;
             }
         };
 
-        Chunk* m_chunk;
-        FreePageList m_free_pages[UnitAllocGroup::MAX_GROUP];
+        static size_t current_shard()
+        {
+            static std::atomic_size_t s_assigned_shard_count{ 0 };
+            static thread_local const size_t t_shard =
+                s_assigned_shard_count.fetch_add(1, std::memory_order_relaxed)
+                % FREE_PAGE_SHARD_COUNT;
+
+            return t_shard;
+        }
+
+        /*
+        Spans of a group carved in this collection and not freed yet, and
+        those of them without a free unit. Only summed up for woomem_get_stats:
+        a span is counted by the collection of the chunk it lives in, except
+        that threads count their spans running out with the collection they
+        took them from, which differs only if the span was borrowed from
+        another node.
+        */
+        struct alignas(64) SpanCounter
+        {
+            std::atomic_size_t m_live_span_count{ 0 };
+            std::atomic_size_t m_run_out_span_count{ 0 };
+        };
+
+        ChunkRegistry* m_chunks;
+        const size_t m_numa_node;
+        FreePageShard m_free_pages[MAX_GROUP][FREE_PAGE_SHARD_COUNT];
+        SpanCounter m_span_counters[MAX_GROUP];
     public:
-        GlobalPageCollection(Chunk* chunk)
-            : m_chunk(chunk)
+        GlobalPageCollection(ChunkRegistry* chunks, size_t numa_node = 0)
+            : m_chunks(chunks)
+            , m_numa_node(numa_node)
         {
-            assert(chunk != nullptr && !chunk->is_init_failed());
+            assert(chunks != nullptr && !chunks->is_init_failed()
+                && numa_node < chunks->get_numa_node_count());
         }
 
         GlobalPageCollection(const GlobalPageCollection&) = delete;
@@ -85,59 +181,113 @@ namespace woomem
         GlobalPageCollection& operator=(GlobalPageCollection&&) = delete;
 
     public:
-        PageHead* require_normal_page(UnitAllocGroup group)
+        // The node the calling thread runs on, 0 if it cannot be told.
+        static size_t current_numa_node(size_t numa_node_count)
         {
-            PageHead* page = m_free_pages[group].pick_free_page();
-            if (page != nullptr)
-            {
-                assert(page->m_page_count_if_huge == 0
-                    && reinterpret_cast<PageUnitAlloc*>(page + 1)->m_run_out == false
-                    && reinterpret_cast<PageUnitAlloc*>(page + 1)->m_unit_size_in_page == GROUP_SIZE_LOOKUP_TABLE[group]);
+            if (numa_node_count <= 1)
+                return 0;
 
-                return page;
-            }
+            size_t node;
+            if (0 != woomem_os_current_numa_node(&node) || node >= numa_node_count)
+                return 0;
+
+            return node;
+        }
+
+        // Fill `out_pages` with up to `max_count` recycled spans in one go, or
+        // with a single fresh span if there is none. Returns the span count.
+        size_t require_normal_pages(UnitAllocGroup group, PageHead** out_pages, size_t max_count)
+        {
+            assert(max_count != 0);
+
+            // The thread's own shard first, then take from the others.
+            const size_t first_shard = current_shard();
+
+            size_t count = 0, dropped_count = 0;
+            for (size_t i = 0; count == 0 && i < FREE_PAGE_SHARD_COUNT; ++i)
+                count = m_free_pages[group][(first_shard + i) % FREE_PAGE_SHARD_COUNT]
+                    .pick_free_pages(out_pages, max_count, dropped_count);
 
-            page = m_chunk->allocate_page();
-            if (page != nullptr)
+            if (dropped_count != 0)
+                m_span_counters[group].m_run_out_span_count.fetch_add(
+                    dropped_count, std::memory_order_relaxed);
+
+            if (count != 0)
             {
-                init_page_for_unit_allocating(page, group);
+#ifndef NDEBUG
+                for (size_t i = 0; i < count; ++i)
+                {
+                    PageHead* const page = out_pages[i];
+                    assert(page->m_page_count_if_huge == 0
+                        && reinterpret_cast<PageUnitAlloc*>(page + 1)->m_run_out == false
+                        && page->m_span_page_count == GROUP_SPAN_PAGE_COUNT_LOOKUP_TABLE[group]
+                        && reinterpret_cast<PageUnitAlloc*>(page + 1)->get_unit_size() == GROUP_SIZE_LOOKUP_TABLE[group]);
+                }
+#endif
+                return count;
             }
-            return page;
+
+            PageHead* const page = m_chunks->allocate_page(
+                GROUP_SPAN_PAGE_COUNT_LOOKUP_TABLE[group], m_numa_node);
+            if (page == nullptr)
+                return 0;
+
+            m_span_counters[group].m_live_span_count.fetch_add(1, std::memory_order_relaxed);
+
+            init_page_for_unit_allocating(page, group);
+            out_pages[0] = page;
+            return 1;
         }
         void return_page(PageHead* page, UnitAllocGroup group)
         {
-            m_free_pages[group].return_free_page(page);
+            m_free_pages[group][current_shard()].return_free_page(page);
         }
 
         void remove_marked_run_out_pages()
         {
-            for (size_t group = 0; group < UnitAllocGroup::MAX_GROUP; ++group)
+            for (size_t group = 0; group < MAX_GROUP; ++group)
             {
-                FreePageList& free_list = m_free_pages[group];
+                size_t dropped_count = 0;
+                for (FreePageShard& shard : m_free_pages[group])
+                    dropped_count += shard.remove_marked_run_out_pages();
 
-                while (free_list.m_spin.test_and_set(std::memory_order_acquire))
-                    ;
+                if (dropped_count != 0)
+                    m_span_counters[group].m_run_out_span_count.fetch_add(
+                        dropped_count, std::memory_order_relaxed);
+            }
+        }
 
-                auto& pages = free_list.m_pages;
-                for (auto& page : pages)
-                {
-                    if (page != nullptr)
-                    {
-                        PageUnitAlloc* alloc_head =
-                            reinterpret_cast<PageUnitAlloc*>(page + 1);
+        // A thread found no free unit left in the span.
+        void count_span_run_out(UnitAllocGroup group)
+        {
+            m_span_counters[group].m_run_out_span_count.fetch_add(1, std::memory_order_relaxed);
+        }
+        // A run out span has free units again and is given back.
+        void count_span_refilled(UnitAllocGroup group)
+        {
+            m_span_counters[group].m_run_out_span_count.fetch_sub(1, std::memory_order_relaxed);
+        }
+        // A run out span without any survivor is given back to its chunk.
+        void count_span_freed(UnitAllocGroup group)
+        {
+            m_span_counters[group].m_run_out_span_count.fetch_sub(1, std::memory_order_relaxed);
+            m_span_counters[group].m_live_span_count.fetch_sub(1, std::memory_order_relaxed);
+        }
 
-                        if (alloc_head->m_mark_as_run_out_in_global_pool)
-                        {
-                            alloc_head->m_mark_as_run_out_in_global_pool = false;
-                            alloc_head->m_run_out.store(
-                                1, std::memory_order::memory_order_release);
+        // Adds the span counts of every group to `out_stats`, MAX_GROUP of them.
+        void collect_span_stats(woomem_SizeClassStats* out_stats) const
+        {
+            for (size_t group = 0; group < MAX_GROUP; ++group)
+            {
+                woomem_SizeClassStats& stats = out_stats[group];
 
-                            page = nullptr;
-                        }
-                    }
-                }
+                stats.live_span_count +=
+                    m_span_counters[group].m_live_span_count.load(std::memory_order_relaxed);
+                stats.run_out_span_count +=
+                    m_span_counters[group].m_run_out_span_count.load(std::memory_order_relaxed);
 
-                free_list.m_spin.clear(std::memory_order_release);
+                for (const FreePageShard& shard : m_free_pages[group])
+                    stats.free_span_count += shard.m_page_count.load(std::memory_order_relaxed);
             }
         }
     };
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace woomem
+{
+    struct UnitHead;
+
+    /*
+    Gray units handed over to the GC workers by other threads travel in blocks.
+    A thread fills a block of its own, and publishes it once full with a single
+    CAS, instead of one CAS per unit on a shared queue.
+    */
+    struct GrayBlock
+    {
+        static constexpr size_t CAPACITY = 256;
+
+        GrayBlock*  m_next;
+        size_t      m_count;
+        UnitHead*   m_units[CAPACITY];
+    };
+
+    /*
+    Unbounded lock-free stack of gray blocks. Any thread may `push`. Blocks are
+    only taken all at once by `take_all`, which has no ABA problem, so any
+    thread may take them too.
+    */
+    class alignas(64) GrayBlockStack
+    {
+        std::atomic<GrayBlock*> m_top{nullptr};
+
+    public:
+        GrayBlockStack() = default;
+
+        GrayBlockStack(const GrayBlockStack&) = delete;
+        GrayBlockStack& operator=(const GrayBlockStack&) = delete;
+        GrayBlockStack(GrayBlockStack&&) = delete;
+        GrayBlockStack& operator=(GrayBlockStack&&) = delete;
+
+        void push(GrayBlock* block)
+        {
+            GrayBlock* top = m_top.load(std::memory_order_relaxed);
+            do
+                block->m_next = top;
+            while (!m_top.compare_exchange_weak(top, block,
+                std::memory_order_release, std::memory_order_relaxed));
+        }
+
+        // Returns the blocks linked through `m_next`, the last pushed first.
+        GrayBlock* take_all()
+        {
+            if (m_top.load(std::memory_order_relaxed) == nullptr)
+                return nullptr;
+            return m_top.exchange(nullptr, std::memory_order_acquire);
+        }
+
+        bool empty() const
+        {
+            return m_top.load(std::memory_order_acquire) == nullptr;
+        }
+    };
+}
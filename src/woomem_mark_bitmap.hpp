@@ -0,0 +1,124 @@
+#pragma once
+
+#include "woomem_page.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+
+#ifdef _MSC_VER
+#   include <intrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   include <emmintrin.h>
+#   define WOOMEM_MARK_BITMAP_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#   include <arm_neon.h>
+#   define WOOMEM_MARK_BITMAP_NEON 1
+#endif
+
+namespace woomem
+{
+    /*
+    Every normal page owns a mark bitmap in its chunk's side table, one bit per
+    8-byte granule of the page. A unit in a normal page is marked by setting
+    the bit of its first granule (counted from the end of PageUnitAlloc), so
+    marking never writes the unit head and sweep does not need to read the
+    heads of marked units at all. The bitmaps of the pages of a span follow
+    each other, the span uses them as one of `mark_bitmap_word_count` words.
+
+    Bits are set concurrently by markers, and only read and cleared by the
+    sweeper of the page after marking has finished.
+    */
+    static constexpr size_t MARK_GRANULE_SIZE = 8;
+    static constexpr size_t MARK_BITMAP_WORDS_PER_PAGE =
+        PageHead::NORMAL_PAGE_SIZE / MARK_GRANULE_SIZE / 64;
+    static constexpr size_t MARK_BITMAP_SIZE_PER_PAGE =
+        MARK_BITMAP_WORDS_PER_PAGE * sizeof(uint64_t);
+
+    using MarkBitmapWord = std::atomic<uint64_t>;
+    static_assert(sizeof(MarkBitmapWord) == sizeof(uint64_t));
+
+    inline size_t mark_bitmap_word_count(const PageHead* page)
+    {
+        return page->m_span_page_count * MARK_BITMAP_WORDS_PER_PAGE;
+    }
+
+    inline uint32_t lowest_set_bit(uint64_t v)
+    {
+        assert(v != 0);
+#ifdef _MSC_VER
+        unsigned long r;
+        _BitScanForward64(&r, v);
+        return static_cast<uint32_t>(r);
+#else
+        return static_cast<uint32_t>(__builtin_ctzll(v));
+#endif
+    }
+
+    // `first_granule` counts granules from the end of PageUnitAlloc.
+    inline bool mark_bitmap_try_set(MarkBitmapWord* bitmap, size_t first_granule)
+    {
+        const uint64_t bit = static_cast<uint64_t>(1) << (first_granule % 64);
+        return 0 == (bitmap[first_granule / 64].fetch_or(
+            bit, std::memory_order_relaxed) & bit);
+    }
+    inline bool mark_bitmap_try_reset(MarkBitmapWord* bitmap, size_t first_granule)
+    {
+        const uint64_t bit = static_cast<uint64_t>(1) << (first_granule % 64);
+        return 0 != (bitmap[first_granule / 64].fetch_and(
+            ~bit, std::memory_order_relaxed) & bit);
+    }
+    inline bool mark_bitmap_test(const MarkBitmapWord* bitmap, size_t first_granule)
+    {
+        const uint64_t bit = static_cast<uint64_t>(1) << (first_granule % 64);
+        return 0 != (bitmap[first_granule / 64].load(std::memory_order_relaxed) & bit);
+    }
+
+    // Calls `func(first_granule)` for every set bit, in ascending order.
+    template<typename Func>
+    inline void mark_bitmap_for_each_set(
+        const MarkBitmapWord* bitmap, size_t word_count, Func&& func)
+    {
+        for (size_t i = 0; i < word_count; ++i)
+        {
+            for (uint64_t word = bitmap[i].load(std::memory_order_relaxed);
+                word != 0; word &= word - 1)
+                func(i * 64 + lowest_set_bit(word));
+        }
+    }
+
+    // Sweeper only, nobody may be setting bits of this page.
+    inline bool mark_bitmap_is_empty(const MarkBitmapWord* bitmap, size_t word_count)
+    {
+        assert(word_count % 2 == 0);
+
+        const uint64_t* const words = reinterpret_cast<const uint64_t*>(bitmap);
+#if defined(WOOMEM_MARK_BITMAP_SSE2)
+        __m128i acc = _mm_setzero_si128();
+        for (size_t i = 0; i < word_count; i += 2)
+            acc = _mm_or_si128(
+                acc, _mm_loadu_si128(reinterpret_cast<const __m128i*>(words + i)));
+
+        return 0xFFFF == _mm_movemask_epi8(_mm_cmpeq_epi8(acc, _mm_setzero_si128()));
+#elif defined(WOOMEM_MARK_BITMAP_NEON)
+        uint64x2_t acc = vdupq_n_u64(0);
+        for (size_t i = 0; i < word_count; i += 2)
+            acc = vorrq_u64(acc, vld1q_u64(words + i));
+
+        return 0 == vmaxvq_u32(vreinterpretq_u32_u64(acc));
+#else
+        uint64_t acc = 0;
+        for (size_t i = 0; i < word_count; ++i)
+            acc |= words[i];
+        return acc == 0;
+#endif
+    }
+    inline void mark_bitmap_clear(MarkBitmapWord* bitmap, size_t word_count)
+    {
+        for (size_t i = 0; i < word_count; ++i)
+            bitmap[i].store(0, std::memory_order_relaxed);
+    }
+}
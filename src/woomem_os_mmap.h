@@ -13,9 +13,22 @@ extern "C" {
 
     size_t woomem_os_page_size(void);
     /* OPTIONAL */ void* woomem_os_reserve_memory(size_t size);
+    /* OPTIONAL */ void* woomem_os_reserve_memory_aligned(size_t size, size_t alignment);
+    /*
+    Same as woomem_os_reserve_memory (or _aligned if `alignment` is not 0),
+    but pages committed in the range prefer NUMA node `node`. NULL if not
+    supported, the caller may reserve without a node then.
+    */
+    /* OPTIONAL */ void* woomem_os_reserve_memory_on_numa_node(size_t size, size_t alignment, size_t node);
     int /* 0 means OK */ woomem_os_commit_memory(void* addr, size_t size);
     int /* 0 means OK */ woomem_os_decommit_memory(void* addr, size_t size);
     int /* 0 means OK */ woomem_os_release_memory(void* addr, size_t size);
+    int /* 0 means OK */ woomem_os_advise_huge_page(void* addr, size_t size);
+    /*
+    Moves the committed pages of `old_addr` to `new_addr` (committed as well)
+    without copying, `old_addr` stays committed and reads as zero after.
+    */
+    int /* 0 means OK */ woomem_os_remap_memory(void* old_addr, void* new_addr, size_t size);
 
 
 #ifdef __cplusplus
@@ -1,3 +1,9 @@
+#ifndef _WIN32
+#   if defined(__linux__) && !defined(_GNU_SOURCE)
+#       define _GNU_SOURCE
+#   endif
+#endif
+
 #include "woomem_os_mmap.h"
 
 #ifndef _WIN32
@@ -5,6 +11,9 @@
 #   include <sys/mman.h>
 #   include <unistd.h>
 #   include <errno.h>
+#   ifdef __linux__
+#       include <sys/syscall.h>
+#   endif
 
 size_t woomem_os_page_size(void)
 {
@@ -31,6 +40,68 @@ size_t woomem_os_page_size(void)
 #   endif
     return result == MAP_FAILED ? NULL : result;
 }
+/* OPTIONAL */ void* woomem_os_reserve_memory_aligned(size_t size, size_t alignment)
+{
+    const size_t padded_size = size + alignment;
+    char* const padded = (char*)woomem_os_reserve_memory(padded_size);
+    if (padded == NULL)
+        return NULL;
+
+    char* const aligned = (char*)(
+        ((uintptr_t)padded + alignment - 1) & ~(uintptr_t)(alignment - 1));
+
+    const size_t head_size = (size_t)(aligned - padded);
+    const size_t tail_size = padded_size - head_size - size;
+
+    if (head_size != 0)
+        (void)munmap(padded, head_size);
+    if (tail_size != 0)
+        (void)munmap(aligned + size, tail_size);
+
+    return aligned;
+}
+/* OPTIONAL */ void* woomem_os_reserve_memory_on_numa_node(size_t size, size_t alignment, size_t node)
+{
+#   if defined(__linux__) && defined(SYS_mbind) && !defined(__ANDROID__) && !defined(__EMSCRIPTEN__)
+    /*
+    MPOL_PREFERRED of <numaif.h>, which comes with libnuma. Unlike MPOL_BIND
+    it falls back to other nodes instead of failing when the node is full.
+    */
+    const int mpol_preferred = 1;
+    unsigned long node_mask[16] = { 0 };
+    const size_t bits_per_mask_word = sizeof(node_mask[0]) * 8;
+
+    if (node >= sizeof(node_mask) * 8)
+        return NULL;
+    node_mask[node / bits_per_mask_word] = 1ul << (node % bits_per_mask_word);
+
+    void* const result = alignment != 0
+        ? woomem_os_reserve_memory_aligned(size, alignment)
+        : woomem_os_reserve_memory(size);
+    if (result == NULL)
+        return NULL;
+
+    /* The policy stays with the range when it is committed later. */
+    if (0 != syscall(
+        SYS_mbind,
+        result,
+        size,
+        mpol_preferred,
+        node_mask,
+        sizeof(node_mask) * 8 + 1,
+        0))
+    {
+        (void)munmap(result, size);
+        return NULL;
+    }
+    return result;
+#   else
+    (void)size;
+    (void)alignment;
+    (void)node;
+    return NULL;
+#   endif
+}
 int /* 0 means OK */ woomem_os_commit_memory(void* addr, size_t size)
 {
 #   ifdef __EMSCRIPTEN__
@@ -49,6 +120,14 @@ int /* 0 means OK */ woomem_os_decommit_memory(void* addr, size_t size)
 #   ifdef __EMSCRIPTEN__
     return 0;
 #   else
+    /* mprotect alone keeps the physical pages, drop them first. */
+#       ifdef __APPLE__
+    if (madvise(addr, size, MADV_FREE) != 0)
+#       else
+    if (madvise(addr, size, MADV_DONTNEED) != 0)
+#       endif
+        return errno;
+
     int result = mprotect(
         addr,
         size,
@@ -63,5 +142,37 @@ int /* 0 means OK */ woomem_os_release_memory(void* addr, size_t size)
         size);
     return result == 0 ? 0 : errno;
 }
+int /* 0 means OK */ woomem_os_advise_huge_page(void* addr, size_t size)
+{
+#   ifdef MADV_HUGEPAGE
+    int result = madvise(
+        addr,
+        size,
+        MADV_HUGEPAGE);
+    return result == 0 ? 0 : errno;
+#   else
+    (void)addr;
+    (void)size;
+    return ENOTSUP;
+#   endif
+}
+int /* 0 means OK */ woomem_os_remap_memory(void* old_addr, void* new_addr, size_t size)
+{
+#   if defined(__linux__) && defined(MREMAP_DONTUNMAP) && !defined(__EMSCRIPTEN__)
+    /* Linux 5.7+, older kernels fail with EINVAL and the caller copies. */
+    void* result = mremap(
+        old_addr,
+        size,
+        size,
+        MREMAP_MAYMOVE | MREMAP_FIXED | MREMAP_DONTUNMAP,
+        new_addr);
+    return result == MAP_FAILED ? errno : 0;
+#   else
+    (void)old_addr;
+    (void)new_addr;
+    (void)size;
+    return ENOTSUP;
+#   endif
+}
 
 #endif
\ No newline at end of file
@@ -18,6 +18,76 @@ size_t woomem_os_page_size(void)
         MEM_RESERVE,
         PAGE_NOACCESS);
 }
+/* OPTIONAL */ void* woomem_os_reserve_memory_aligned(size_t size, size_t alignment)
+{
+    /*
+    Reserve a padded range to find an aligned address, release it and reserve
+    again exactly there. Another thread may take the range in between, retry.
+    */
+    for (int retry = 0; retry < 8; ++retry)
+    {
+        void* padded = VirtualAlloc(
+            NULL,
+            size + alignment,
+            MEM_RESERVE,
+            PAGE_NOACCESS);
+        if (padded == NULL)
+            return NULL;
+
+        void* const aligned = (void*)(
+            ((uintptr_t)padded + alignment - 1) & ~(uintptr_t)(alignment - 1));
+
+        VirtualFree(padded, 0, MEM_RELEASE);
+
+        void* result = VirtualAlloc(
+            aligned,
+            size,
+            MEM_RESERVE,
+            PAGE_NOACCESS);
+        if (result != NULL)
+            return result;
+    }
+    return NULL;
+}
+/* OPTIONAL */ void* woomem_os_reserve_memory_on_numa_node(size_t size, size_t alignment, size_t node)
+{
+    if (alignment == 0)
+        return VirtualAllocExNuma(
+            GetCurrentProcess(),
+            NULL,
+            size,
+            MEM_RESERVE,
+            PAGE_NOACCESS,
+            (DWORD)node);
+
+    /* Same as woomem_os_reserve_memory_aligned. */
+    for (int retry = 0; retry < 8; ++retry)
+    {
+        void* padded = VirtualAlloc(
+            NULL,
+            size + alignment,
+            MEM_RESERVE,
+            PAGE_NOACCESS);
+        if (padded == NULL)
+            return NULL;
+
+        void* const aligned = (void*)(
+            ((uintptr_t)padded + alignment - 1) & ~(uintptr_t)(alignment - 1));
+
+        VirtualFree(padded, 0, MEM_RELEASE);
+
+        void* result = VirtualAllocExNuma(
+            GetCurrentProcess(),
+            aligned,
+            size,
+            MEM_RESERVE,
+            PAGE_NOACCESS,
+            (DWORD)node);
+        if (result != NULL)
+            return result;
+    }
+    return NULL;
+}
 int /* 0 means OK */ woomem_os_commit_memory(void* addr, size_t size)
 {
     void* result = VirtualAlloc(
@@ -43,5 +113,22 @@ int /* 0 means OK */ woomem_os_release_memory(void* addr, size_t size)
         MEM_RELEASE);
     return result == FALSE ? (int)GetLastError() : 0;
 }
+int /* 0 means OK */ woomem_os_advise_huge_page(void* addr, size_t size)
+{
+    /*
+    MEM_LARGE_PAGES can only be requested when reserving and committing the
+    whole range at once, which does not fit the lazily committed chunk.
+    */
+    (void)addr;
+    (void)size;
+    return ERROR_NOT_SUPPORTED;
+}
+int /* 0 means OK */ woomem_os_remap_memory(void* old_addr, void* new_addr, size_t size)
+{
+    (void)old_addr;
+    (void)new_addr;
+    (void)size;
+    return ERROR_NOT_SUPPORTED;
+}
 
 #endif
\ No newline at end of file
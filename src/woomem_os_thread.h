@@ -0,0 +1,24 @@
+#pragma once
+
+/*
+woomem_os_thread.h
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    int /* 0 means OK */ woomem_os_pin_current_thread_to_cpu(size_t cpu_index);
+    int /* 0 means OK */ woomem_os_pin_current_thread_to_numa_node(size_t node);
+
+    /* 1 if the machine is not NUMA or it cannot be told. */
+    size_t woomem_os_numa_node_count(void);
+    int /* 0 means OK */ woomem_os_current_numa_node(size_t* out_node);
+    int /* 0 means OK */ woomem_os_numa_node_of_cpu(size_t cpu_index, size_t* out_node);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,161 @@
+#ifndef _WIN32
+#   if defined(__linux__) && !defined(_GNU_SOURCE)
+#       define _GNU_SOURCE
+#   endif
+#endif
+
+#include "woomem_os_thread.h"
+
+#ifndef _WIN32
+
+#   include <pthread.h>
+#   include <sched.h>
+#   include <errno.h>
+
+#   if defined(__linux__) && !defined(__ANDROID__) && !defined(__EMSCRIPTEN__)
+#       include <stdio.h>
+#       include <stdlib.h>
+#       include <unistd.h>
+#       include <sys/syscall.h>
+
+/* Reads a sysfs index list such as "0-3,8-11" into `out_set`. */
+static int woomem_os_read_index_list(const char* path, cpu_set_t* out_set)
+{
+    char buf[4096];
+
+    FILE* const file = fopen(path, "r");
+    if (file == NULL)
+        return errno;
+
+    const size_t length = fread(buf, 1, sizeof(buf) - 1, file);
+    fclose(file);
+    buf[length] = '\0';
+
+    CPU_ZERO(out_set);
+
+    const char* p = buf;
+    while (*p >= '0' && *p <= '9')
+    {
+        char* end;
+        unsigned long first = strtoul(p, &end, 10);
+        unsigned long last = first;
+        if (*end == '-')
+            last = strtoul(end + 1, &end, 10);
+
+        for (; first <= last && first < CPU_SETSIZE; ++first)
+            CPU_SET(first, out_set);
+
+        p = *end == ',' ? end + 1 : end;
+    }
+    return 0;
+}
+
+static int woomem_os_read_numa_node_cpus(size_t node, cpu_set_t* out_set)
+{
+    char path[64];
+    (void)snprintf(path, sizeof(path), "/sys/devices/system/node/node%zu/cpulist", node);
+
+    return woomem_os_read_index_list(path, out_set);
+}
+#   endif
+
+int woomem_os_pin_current_thread_to_cpu(size_t cpu_index)
+{
+#   if defined(__linux__) && !defined(__ANDROID__) && !defined(__EMSCRIPTEN__)
+    cpu_set_t cpu_set;
+
+    if (cpu_index >= CPU_SETSIZE)
+        return EINVAL;
+
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu_index, &cpu_set);
+
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+#   else
+    (void)cpu_index;
+    return ENOTSUP;
+#   endif
+}
+
+int woomem_os_pin_current_thread_to_numa_node(size_t node)
+{
+#   if defined(__linux__) && !defined(__ANDROID__) && !defined(__EMSCRIPTEN__)
+    cpu_set_t cpu_set;
+
+    const int result = woomem_os_read_numa_node_cpus(node, &cpu_set);
+    if (result != 0)
+        return result;
+
+    /* Memory only nodes have no CPU. */
+    if (CPU_COUNT(&cpu_set) == 0)
+        return EINVAL;
+
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+#   else
+    (void)node;
+    return ENOTSUP;
+#   endif
+}
+
+size_t woomem_os_numa_node_count(void)
+{
+#   if defined(__linux__) && !defined(__ANDROID__) && !defined(__EMSCRIPTEN__)
+    cpu_set_t node_set;
+
+    if (0 != woomem_os_read_index_list("/sys/devices/system/node/online", &node_set))
+        return 1;
+
+    for (size_t node = CPU_SETSIZE; node > 0; --node)
+    {
+        if (CPU_ISSET(node - 1, &node_set))
+            return node;
+    }
+    return 1;
+#   else
+    return 1;
+#   endif
+}
+
+int woomem_os_current_numa_node(size_t* out_node)
+{
+#   if defined(__linux__) && defined(SYS_getcpu) && !defined(__ANDROID__) && !defined(__EMSCRIPTEN__)
+    unsigned cpu, node;
+
+    if (0 != syscall(SYS_getcpu, &cpu, &node, NULL))
+        return errno;
+
+    *out_node = node;
+    return 0;
+#   else
+    (void)out_node;
+    return ENOTSUP;
+#   endif
+}
+
+int woomem_os_numa_node_of_cpu(size_t cpu_index, size_t* out_node)
+{
+#   if defined(__linux__) && !defined(__ANDROID__) && !defined(__EMSCRIPTEN__)
+    cpu_set_t cpu_set;
+
+    if (cpu_index >= CPU_SETSIZE)
+        return EINVAL;
+
+    const size_t node_count = woomem_os_numa_node_count();
+    for (size_t node = 0; node < node_count; ++node)
+    {
+        if (0 == woomem_os_read_numa_node_cpus(node, &cpu_set)
+            && CPU_ISSET(cpu_index, &cpu_set))
+        {
+            *out_node = node;
+            return 0;
+        }
+    }
+    return ENOENT;
+#   else
+    (void)cpu_index;
+    (void)out_node;
+    return ENOTSUP;
+#   endif
+}
+
+#endif
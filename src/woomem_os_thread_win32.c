@@ -0,0 +1,82 @@
+#include "woomem_os_thread.h"
+
+#ifdef _WIN32
+
+#   include <windows.h>
+
+int woomem_os_pin_current_thread_to_cpu(size_t cpu_index)
+{
+    /* Processor groups are not handled, only the first 64 CPUs can be used. */
+    if (cpu_index >= sizeof(DWORD_PTR) * 8)
+        return ERROR_INVALID_PARAMETER;
+
+    if (0 == SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu_index))
+        return (int)GetLastError();
+
+    return 0;
+}
+
+int woomem_os_pin_current_thread_to_numa_node(size_t node)
+{
+    GROUP_AFFINITY affinity;
+
+    if (node > 0xFFFF)
+        return ERROR_INVALID_PARAMETER;
+
+    if (!GetNumaNodeProcessorMaskEx((USHORT)node, &affinity))
+        return (int)GetLastError();
+
+    /* Memory only nodes have no CPU. */
+    if (affinity.Mask == 0)
+        return ERROR_INVALID_PARAMETER;
+
+    if (!SetThreadGroupAffinity(GetCurrentThread(), &affinity, NULL))
+        return (int)GetLastError();
+
+    return 0;
+}
+
+size_t woomem_os_numa_node_count(void)
+{
+    ULONG highest_node;
+
+    if (!GetNumaHighestNodeNumber(&highest_node))
+        return 1;
+
+    return (size_t)highest_node + 1;
+}
+
+int woomem_os_current_numa_node(size_t* out_node)
+{
+    PROCESSOR_NUMBER processor;
+    USHORT node;
+
+    GetCurrentProcessorNumberEx(&processor);
+    if (!GetNumaProcessorNodeEx(&processor, &node))
+        return (int)GetLastError();
+
+    *out_node = node;
+    return 0;
+}
+
+int woomem_os_numa_node_of_cpu(size_t cpu_index, size_t* out_node)
+{
+    PROCESSOR_NUMBER processor;
+    USHORT node;
+
+    /* Same as woomem_os_pin_current_thread_to_cpu, only the first group. */
+    if (cpu_index >= sizeof(DWORD_PTR) * 8)
+        return ERROR_INVALID_PARAMETER;
+
+    processor.Group = 0;
+    processor.Number = (BYTE)cpu_index;
+    processor.Reserved = 0;
+
+    if (!GetNumaProcessorNodeEx(&processor, &node))
+        return (int)GetLastError();
+
+    *out_node = node;
+    return 0;
+}
+
+#endif
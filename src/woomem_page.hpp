@@ -11,8 +11,22 @@ namespace woomem
         static constexpr size_t NORMAL_PAGE_SIZE = 32768;
         // =================================================
         alignas(8) size_t       m_page_count_if_huge;
-        alignas(8) PageHead*    m_next_page;
+        // Unit pages only: link of GlobalPageCollection's free page stacks.
+        alignas(8) PageHead*    m_next_free_page;
         alignas(8) std::atomic_bool        m_page_just_allocated;
+
+        // Unit pages only: the latest GC round in which the page was known to
+        // hold young units, minor cycles only sweep pages tagged recently.
+        std::atomic_uint8_t     m_young_unit_round;
+
+        // Pages of the run whose mark and root bitmaps are in use: the span
+        // length of unit pages, 1 for huge runs which only use the first bit.
+        uint8_t                 m_span_page_count;
+
+        // Unit pages only: offset (from PageUnitAlloc, in 8-byte granules) of
+        // the end of the units carved so far. Only the owner thread advances
+        // it, with release order; no unit head beyond it has been written yet.
+        std::atomic_uint16_t    m_unit_high_water_granule;
     };
     static_assert(sizeof(PageHead) == 24);
 }
\ No newline at end of file
@@ -1,3 +1,4 @@
+#include "woomem.h"
 #include "woomem_page.hpp"
 #include "woomem_page_unit_alloc.hpp"
 
@@ -14,40 +15,24 @@ namespace woomem
 
         page_alloc_head->m_run_out.store(0, std::memory_order::memory_order_relaxed);
         page_alloc_head->m_mark_as_run_out_in_global_pool = false;
-        page_alloc_head->m_freed_unit_offset.store(0, std::memory_order::memory_order_relaxed);
-        page_alloc_head->m_next_allocate_unit_offset = sizeof(PageUnitAlloc);
-        page_alloc_head->m_unit_size_in_page =
-            static_cast<uint16_t>(GROUP_SIZE_LOOKUP_TABLE[group_type]);
-
-        const size_t group_unit_size_include_unit_head =
-            sizeof(UnitHead) + page_alloc_head->m_unit_size_in_page;
-
-        const size_t available_for_units =
-            PageHead::NORMAL_PAGE_SIZE - (sizeof(PageHead) + sizeof(PageUnitAlloc));
-        const size_t unit_count =
-            available_for_units / group_unit_size_include_unit_head;
-
-        size_t offset = sizeof(PageUnitAlloc);
-        for (size_t i = 0; i < unit_count; i++)
-        {
-            UnitHead* const current_unit =
-                reinterpret_cast<UnitHead*>(
-                    reinterpret_cast<char*>(page_alloc_head) + offset);
-
-            offset += group_unit_size_include_unit_head;
-
-            current_unit->m_next_free_unit_offset =
-                (i + 1 < unit_count) ? static_cast<uint16_t>(offset) : 0;
-            current_unit->m_age = 0;
-            current_unit->m_timing = 0;
-            current_unit->m_attribute = 0;
-            current_unit->m_life.store(
-                UnitLife::RELEASED, std::memory_order::memory_order_relaxed);
-
-        }
+        page_alloc_head->m_freed_unit_granule.store(0, std::memory_order::memory_order_relaxed);
+        page_alloc_head->m_next_allocate_unit_granule = 0;
+        page_alloc_head->m_unit_granules_in_page =
+            static_cast<uint16_t>(GROUP_SIZE_LOOKUP_TABLE[group_type] / UNIT_GRANULE_SIZE);
+
+        assert(page->m_span_page_count == GROUP_SPAN_PAGE_COUNT_LOOKUP_TABLE[group_type]);
+
+        // Units are carved lazily by `pick_unit_from_page_without_init`, so the
+        // span is not touched beyond its head here.
+        page->m_unit_high_water_granule.store(
+            static_cast<uint16_t>(sizeof(PageUnitAlloc) / UNIT_GRANULE_SIZE),
+            std::memory_order::memory_order_relaxed);
+        page->m_young_unit_round.store(
+            woomem_gc_marking_round_counter,
+            std::memory_order::memory_order_relaxed);
 
         // NOTE: No need for fence. new allocated page will be used for current thread.
         //      If drop back to global list, there will be a release/acquire order.
-        g_global_context.add_new_page_into_chain(page);
+        g_global_context.publish_new_page(page);
     }
 }
\ No newline at end of file
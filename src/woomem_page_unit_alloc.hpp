@@ -5,94 +5,198 @@
 #include <cassert>
 #include <atomic>
 #include <array>
+#include <algorithm>
 #include <utility>
 
+#include "woomem.h"
 #include "woomem_page.hpp"
+#include "woomem_prefetch.hpp"
 
 namespace woomem
 {
-    enum UnitAllocGroup
+#ifndef WOOMEM_SIZE_CLASS_STEPS
+    // Size classes per doubling of the unit size, the spacing of neighbouring
+    // classes is about 1/WOOMEM_SIZE_CLASS_STEPS. Selected per build, see the
+    // WOOMEM_SIZE_CLASS_STEPS cache variable.
+#   define WOOMEM_SIZE_CLASS_STEPS 8
+#endif
+
+    /*
+    * Span layout: [PageHead(24)] [PageUnitAlloc(8)] [[UnitHead(8)][payload(x)]]...
+    *
+    * A span is a run of 1 ~ MAX_SPAN_PAGE_COUNT pages holding units of one size
+    * class. Offsets of units in a span are counted in 8-byte granules from
+    * PageUnitAlloc, so that they fit in 16 bits for spans up to 512 KiB.
+    */
+    static constexpr size_t UNIT_GRANULE_SIZE = 8;
+    static constexpr size_t MAX_SPAN_PAGE_COUNT = 16;
+
+    constexpr size_t get_span_available_size(size_t span_page_count)
     {
-        SMALL_16,
-        SMALL_40,
-        SMALL_88,
-        SMALL_168,
-        SMALL_344,
-        SMALL_520,
-        SMALL_736,
-        SMALL_1048,
-        MAX_SMALL_GROUP = SMALL_1048,
-
-        MIDIUM_2720,
-        MIDIUM_5448,
-        MIDIUM_8176,
-        MIDIUM_10904,
-        MIDIUM_16360,
-
-        MAX_GROUP
-    };
+        return span_page_count * PageHead::NORMAL_PAGE_SIZE
+            - (sizeof(PageHead) + 8 /* sizeof(PageUnitAlloc) */);
+    }
 
-    static constexpr size_t MAX_SMALL_UNIT_SIZE = 1048;
-    static constexpr size_t MAX_IN_PAGE_UNIT_SIZE = 16360;
+    // Larger units get a huge run of their own; at least two of them fit in
+    // the largest span.
+    static constexpr size_t MAX_IN_PAGE_UNIT_SIZE =
+        (get_span_available_size(MAX_SPAN_PAGE_COUNT) / 2 - 8 /* sizeof(UnitHead) */)
+        / UNIT_GRANULE_SIZE * UNIT_GRANULE_SIZE;
 
-    static constexpr size_t GROUP_SIZE_LOOKUP_TABLE[MAX_GROUP] = {
-        16, 40, 88, 168, 344, 520, 736, 1048, 2720, 5448, 8176, 10904, 16360
+    struct SizeClass
+    {
+        size_t m_unit_size;
+        size_t m_span_page_count;
     };
-    static_assert(GROUP_SIZE_LOOKUP_TABLE[MIDIUM_16360] == MAX_IN_PAGE_UNIT_SIZE);
 
-    static constexpr UnitAllocGroup SMALL_UNIT_GROUP_FAST_LOOKUP_TABLE[] =
+    template<size_t STEPS_PER_DOUBLING>
+    struct SizeClassTable
     {
-        // 0
-        SMALL_16,
-        // 1~16(2)
-        SMALL_16, SMALL_16,
-        // 17~40(5)
-        SMALL_40, SMALL_40, SMALL_40,
-        // 41~88(11)
-        SMALL_88, SMALL_88, SMALL_88, SMALL_88, SMALL_88, SMALL_88,
-        // 89~168(21)
-        SMALL_168, SMALL_168, SMALL_168, SMALL_168, SMALL_168, SMALL_168, SMALL_168, SMALL_168,
-        SMALL_168, SMALL_168,
-        // 169~344(43)
-        SMALL_344, SMALL_344, SMALL_344, SMALL_344, SMALL_344, SMALL_344, SMALL_344, SMALL_344,
-        SMALL_344, SMALL_344, SMALL_344, SMALL_344, SMALL_344, SMALL_344, SMALL_344, SMALL_344,
-        SMALL_344, SMALL_344, SMALL_344, SMALL_344, SMALL_344, SMALL_344,
-        // 345~520(65)
-        SMALL_520, SMALL_520, SMALL_520, SMALL_520, SMALL_520, SMALL_520, SMALL_520, SMALL_520,
-        SMALL_520, SMALL_520, SMALL_520, SMALL_520, SMALL_520, SMALL_520, SMALL_520, SMALL_520,
-        SMALL_520, SMALL_520, SMALL_520, SMALL_520, SMALL_520, SMALL_520,
-        // 521~736(92)
-        SMALL_736, SMALL_736, SMALL_736, SMALL_736, SMALL_736, SMALL_736, SMALL_736, SMALL_736,
-        SMALL_736, SMALL_736, SMALL_736, SMALL_736, SMALL_736, SMALL_736, SMALL_736, SMALL_736,
-        SMALL_736, SMALL_736, SMALL_736, SMALL_736, SMALL_736, SMALL_736, SMALL_736, SMALL_736,
-        SMALL_736, SMALL_736, SMALL_736,
-        // 737~1048(131)
-        SMALL_1048, SMALL_1048, SMALL_1048, SMALL_1048, SMALL_1048, SMALL_1048, SMALL_1048, SMALL_1048,
-        SMALL_1048, SMALL_1048, SMALL_1048, SMALL_1048, SMALL_1048, SMALL_1048, SMALL_1048, SMALL_1048,
-        SMALL_1048, SMALL_1048, SMALL_1048, SMALL_1048, SMALL_1048, SMALL_1048, SMALL_1048, SMALL_1048,
-        SMALL_1048, SMALL_1048, SMALL_1048, SMALL_1048, SMALL_1048, SMALL_1048, SMALL_1048, SMALL_1048,
-        SMALL_1048, SMALL_1048, SMALL_1048, SMALL_1048, SMALL_1048, SMALL_1048, SMALL_1048,
+        static_assert(STEPS_PER_DOUBLING >= 1 && STEPS_PER_DOUBLING <= 16);
+
+        static constexpr size_t MIN_UNIT_SIZE = 16;
+        static constexpr size_t MAX_CLASS_COUNT = 256;
+
+        std::array<SizeClass, MAX_CLASS_COUNT> m_classes;
+        size_t m_count;
+
+        static constexpr size_t step_of(size_t unit_size)
+        {
+            size_t pow2 = 1;
+            while (pow2 * 2 <= unit_size)
+                pow2 *= 2;
+
+            const size_t step = pow2 / STEPS_PER_DOUBLING / UNIT_GRANULE_SIZE * UNIT_GRANULE_SIZE;
+            return step < UNIT_GRANULE_SIZE ? UNIT_GRANULE_SIZE : step;
+        }
+
+        // Picks the span for a class of at least `unit_size`: the smallest one
+        // which wastes no more than half a step per unit of that size and 1/8
+        // of the span, or the one which wastes the least. The unit size is
+        // then raised so that the units fill the span, the tail of the span
+        // goes to the units instead of being wasted.
+        static constexpr SizeClass fit_class(size_t unit_size)
+        {
+            SizeClass best{ 0, 0 };
+            size_t best_waste = 0, best_available = 1;
+
+            for (size_t pages = 1; pages <= MAX_SPAN_PAGE_COUNT; ++pages)
+            {
+                const size_t available = get_span_available_size(pages);
+                const size_t unit_count = available / (8 /* sizeof(UnitHead) */ + unit_size);
+                if (unit_count == 0)
+                    continue;
+
+                const size_t fitted_size =
+                    (available / unit_count - 8) / UNIT_GRANULE_SIZE * UNIT_GRANULE_SIZE;
+                // Units of at most MAX_IN_PAGE_UNIT_SIZE cannot fill this span.
+                if (fitted_size > MAX_IN_PAGE_UNIT_SIZE)
+                    continue;
+
+                const size_t waste = available - unit_count * (8 + unit_size);
+
+                // Compare waste / available of both spans.
+                if (best.m_span_page_count == 0 || waste * best_available < best_waste * available)
+                {
+                    best = SizeClass{ fitted_size, pages };
+                    best_waste = waste;
+                    best_available = available;
+                }
+
+                if (waste <= unit_count * (step_of(unit_size) / 2) && waste * 8 <= available)
+                    break;
+            }
+            return best;
+        }
+
+        constexpr SizeClassTable()
+            : m_classes{}
+            , m_count(0)
+        {
+            size_t unit_size = MIN_UNIT_SIZE;
+            while (true)
+            {
+                const SizeClass size_class = fit_class(unit_size);
+                const size_t step = step_of(size_class.m_unit_size);
+
+                // The last class is always MAX_IN_PAGE_UNIT_SIZE, do not leave
+                // another one just below it.
+                if (size_class.m_unit_size + step > MAX_IN_PAGE_UNIT_SIZE)
+                {
+                    if (size_class.m_unit_size + step / 2 <= MAX_IN_PAGE_UNIT_SIZE)
+                        m_classes[m_count++] = size_class;
+
+                    m_classes[m_count++] = fit_class(MAX_IN_PAGE_UNIT_SIZE);
+                    break;
+                }
+                m_classes[m_count++] = size_class;
+                unit_size = size_class.m_unit_size + step;
+            }
+        }
     };
+
+    static constexpr SizeClassTable<WOOMEM_SIZE_CLASS_STEPS> SIZE_CLASS_TABLE{};
+
+    // Index of a size class in SIZE_CLASS_TABLE.
+    using UnitAllocGroup = uint8_t;
+    static constexpr size_t MAX_GROUP = SIZE_CLASS_TABLE.m_count;
+    static_assert(MAX_GROUP <= UINT8_MAX);
+
+    template<typename T, typename Func, size_t... Is>
+    constexpr std::array<T, sizeof...(Is)> make_lookup_table(Func&& func, std::index_sequence<Is...>)
+    {
+        return { { static_cast<T>(func(Is))... } };
+    }
+
+    static constexpr auto GROUP_SIZE_LOOKUP_TABLE = make_lookup_table<size_t>(
+        [](size_t group) { return SIZE_CLASS_TABLE.m_classes[group].m_unit_size; },
+        std::make_index_sequence<MAX_GROUP>());
+    static constexpr auto GROUP_SPAN_PAGE_COUNT_LOOKUP_TABLE = make_lookup_table<size_t>(
+        [](size_t group) { return SIZE_CLASS_TABLE.m_classes[group].m_span_page_count; },
+        std::make_index_sequence<MAX_GROUP>());
+    static_assert(GROUP_SIZE_LOOKUP_TABLE[MAX_GROUP - 1] == MAX_IN_PAGE_UNIT_SIZE);
+
+    // Smallest group of at least `unit_size`.
+    constexpr UnitAllocGroup eval_group_by_unit_size_slow(size_t unit_size)
+    {
+        size_t group = 0;
+        while (GROUP_SIZE_LOOKUP_TABLE[group] < unit_size)
+            ++group;
+        return static_cast<UnitAllocGroup>(group);
+    }
+
+    static constexpr size_t MAX_SMALL_UNIT_SIZE = 1024;
+
 #define WOOMEM_FAST_LOOKUP_GROUP_INDEX(SIZE) (((SIZE) + 7) >> 3)
-    static_assert(
-        sizeof(SMALL_UNIT_GROUP_FAST_LOOKUP_TABLE) / sizeof(UnitAllocGroup)
-        == WOOMEM_FAST_LOOKUP_GROUP_INDEX(MAX_SMALL_UNIT_SIZE) + 1);
+#define WOOMEM_MEDIUM_LOOKUP_GROUP_INDEX(SIZE) (((SIZE) + 127) >> 7)
 
-    /*
-    * (32768 - (24 + 8)) % (x + 8)
-    * Page layout: [PageHead(24)] [PageUnitAlloc(8)] [[UnitHead(8)][payload(x)]]...
-    * Available per page: 32736 bytes.
-    */
+    // Exact group of every small size, in steps of 8 bytes.
+    static constexpr auto SMALL_UNIT_GROUP_FAST_LOOKUP_TABLE = make_lookup_table<UnitAllocGroup>(
+        [](size_t index) { return eval_group_by_unit_size_slow(index * 8); },
+        std::make_index_sequence<WOOMEM_FAST_LOOKUP_GROUP_INDEX(MAX_SMALL_UNIT_SIZE) + 1>());
+
+    // Group of the smallest size in every 128 bytes, larger sizes in the same
+    // range are at most a few groups above it.
+    static constexpr auto MEDIUM_UNIT_GROUP_LOOKUP_TABLE = make_lookup_table<UnitAllocGroup>(
+        [](size_t index) { return eval_group_by_unit_size_slow(index == 0 ? 0 : index * 128 - 127); },
+        std::make_index_sequence<WOOMEM_MEDIUM_LOOKUP_GROUP_INDEX(MAX_IN_PAGE_UNIT_SIZE) + 1>());
 
     struct PageUnitAlloc
     {
-        uint16_t                m_next_allocate_unit_offset;
-        std::atomic_uint16_t    m_freed_unit_offset;
+        uint16_t                m_next_allocate_unit_granule;
+        std::atomic_uint16_t    m_freed_unit_granule;
         std::atomic_uint8_t     m_run_out;
         bool                    m_mark_as_run_out_in_global_pool;
-        uint16_t                m_unit_size_in_page;
+        uint16_t                m_unit_granules_in_page;  /* payload, without UnitHead */
+
+        size_t get_unit_size() const
+        {
+            return static_cast<size_t>(m_unit_granules_in_page) * UNIT_GRANULE_SIZE;
+        }
     };
     static_assert(sizeof(PageUnitAlloc) == 8);
+    static_assert(MAX_IN_PAGE_UNIT_SIZE / UNIT_GRANULE_SIZE <= UINT16_MAX
+        && get_span_available_size(MAX_SPAN_PAGE_COUNT) / UNIT_GRANULE_SIZE < UINT16_MAX);
 
     enum UnitLife : uint8_t
     {
@@ -105,8 +209,8 @@ namespace woomem
 
     struct UnitHead
     {
-        uint16_t            m_next_free_unit_offset /* m_unit_offset_in_page */;
-        char                __reserved__[2];
+        uint16_t            m_next_free_unit_granule /* m_unit_granule_in_page */;
+        uint16_t            m_type_id;     /* WOOMEM_UNTYPED (0) or a registered type */
         uint8_t             m_age;
         uint8_t             m_timing;
         uint8_t             m_attribute;
@@ -114,14 +218,14 @@ namespace woomem
 
         size_t get_unit_available_size() const
         {
-            if (m_next_free_unit_offset != 0)
+            if (m_next_free_unit_granule != 0)
             {
                 const PageUnitAlloc* const unit_alloc_page =
                     reinterpret_cast<const PageUnitAlloc*>(
                         reinterpret_cast<const char*>(this)
-                        - m_next_free_unit_offset);
+                        - m_next_free_unit_granule * UNIT_GRANULE_SIZE);
 
-                return unit_alloc_page->m_unit_size_in_page;
+                return unit_alloc_page->get_unit_size();
             }
             else
             {
@@ -136,46 +240,73 @@ namespace woomem
     };
     static_assert(sizeof(UnitHead) == 8);
 
+    // `m_age` starts from 15 and drops by one for every GC cycle survived. Units
+    // which have survived two cycles are old, and only traced by major cycles.
+    static constexpr uint8_t OLD_UNIT_AGE = 13;
+
+    inline bool is_old_unit(const UnitHead* unit)
+    {
+        return unit->m_age <= OLD_UNIT_AGE;
+    }
+    inline PageHead* get_page_of_unit(UnitHead* unit)
+    {
+        if (unit->m_next_free_unit_granule == 0)
+            // Huge unit.
+            return reinterpret_cast<PageHead*>(unit) - 1;
+
+        return reinterpret_cast<PageHead*>(
+            reinterpret_cast<char*>(unit)
+            - unit->m_next_free_unit_granule * UNIT_GRANULE_SIZE) - 1;
+    }
+
     void init_page_for_unit_allocating(PageHead* page, UnitAllocGroup group_type);
     inline UnitAllocGroup eval_group_by_small_unit_size(size_t unit_size)
     {
         if (unit_size <= MAX_SMALL_UNIT_SIZE)
             return SMALL_UNIT_GROUP_FAST_LOOKUP_TABLE[
                 WOOMEM_FAST_LOOKUP_GROUP_INDEX(unit_size)];
-        else
-        {
-            if (unit_size <= GROUP_SIZE_LOOKUP_TABLE[UnitAllocGroup::MIDIUM_2720])
-                return UnitAllocGroup::MIDIUM_2720;
-            else if (unit_size <= GROUP_SIZE_LOOKUP_TABLE[UnitAllocGroup::MIDIUM_5448])
-                return UnitAllocGroup::MIDIUM_5448;
-            else if (unit_size <= GROUP_SIZE_LOOKUP_TABLE[UnitAllocGroup::MIDIUM_8176])
-                return UnitAllocGroup::MIDIUM_8176;
-            else if (unit_size <= GROUP_SIZE_LOOKUP_TABLE[UnitAllocGroup::MIDIUM_10904])
-                return UnitAllocGroup::MIDIUM_10904;
-            else
-                return UnitAllocGroup::MIDIUM_16360;
-        }
+
+        assert(unit_size <= MAX_IN_PAGE_UNIT_SIZE);
+
+        UnitAllocGroup group = MEDIUM_UNIT_GROUP_LOOKUP_TABLE[
+            WOOMEM_MEDIUM_LOOKUP_GROUP_INDEX(unit_size)];
+        while (GROUP_SIZE_LOOKUP_TABLE[group] < unit_size)
+            ++group;
+        return group;
     }
-    inline UnitHead* pick_unit_from_page_without_init(PageHead* page)
+    // End offset (from PageUnitAlloc, in granules) that no unit of a span of
+    // `span_page_count` pages may cross.
+    inline size_t get_span_end_granule(size_t span_page_count)
     {
-        constexpr uint16_t UNIT_PAGE_HEAD_SIZE =
-            static_cast<uint16_t>(sizeof(PageHead) + sizeof(PageUnitAlloc));
+        return (span_page_count * PageHead::NORMAL_PAGE_SIZE - sizeof(PageHead))
+            / UNIT_GRANULE_SIZE;
+    }
 
+    inline UnitHead* pick_unit_from_page_without_init(PageHead* page)
+    {
         PageUnitAlloc* const page_alloc_head =
             reinterpret_cast<PageUnitAlloc*>(page + 1);
 
-        uint16_t current_offset = page_alloc_head->m_next_allocate_unit_offset;
+        uint16_t current_granule = page_alloc_head->m_next_allocate_unit_granule;
         do
         {
-            if (current_offset != 0)
+            if (current_granule != 0)
             {
                 UnitHead* const allocating_unit = reinterpret_cast<UnitHead*>(
-                    reinterpret_cast<char*>(page_alloc_head) + current_offset);
+                    reinterpret_cast<char*>(page_alloc_head)
+                    + current_granule * UNIT_GRANULE_SIZE);
 
-                page_alloc_head->m_next_allocate_unit_offset =
-                    allocating_unit->m_next_free_unit_offset;
-                allocating_unit->m_next_free_unit_offset =
-                    current_offset;
+                const uint16_t next_granule = allocating_unit->m_next_free_unit_granule;
+
+                page_alloc_head->m_next_allocate_unit_granule = next_granule;
+                allocating_unit->m_next_free_unit_granule =
+                    current_granule;
+
+                // The next allocation will read and write this unit's head.
+                if (next_granule != 0)
+                    WOOMEM_PREFETCH_WRITE(
+                        reinterpret_cast<char*>(page_alloc_head)
+                        + next_granule * UNIT_GRANULE_SIZE);
 
                 assert(UnitLife::RELEASED == allocating_unit->m_life.load(
                     std::memory_order::memory_order_relaxed));
@@ -184,11 +315,39 @@ namespace woomem
                 return allocating_unit;
             }
 
-            current_offset = page_alloc_head->m_freed_unit_offset.exchange(
+            // Carve a new unit from the untouched tail of the span.
+            const uint16_t high_water_granule =
+                page->m_unit_high_water_granule.load(std::memory_order::memory_order_relaxed);
+            const size_t unit_granules_with_head =
+                sizeof(UnitHead) / UNIT_GRANULE_SIZE + page_alloc_head->m_unit_granules_in_page;
+
+            if (high_water_granule + unit_granules_with_head
+                <= get_span_end_granule(page->m_span_page_count))
+            {
+                UnitHead* const allocating_unit = reinterpret_cast<UnitHead*>(
+                    reinterpret_cast<char*>(page_alloc_head)
+                    + high_water_granule * UNIT_GRANULE_SIZE);
+
+                allocating_unit->m_next_free_unit_granule = high_water_granule;
+                allocating_unit->m_type_id = WOOMEM_UNTYPED;
+                allocating_unit->m_age = 0;
+                allocating_unit->m_timing = 0;
+                allocating_unit->m_attribute = 0;
+                allocating_unit->m_life.store(UnitLife::PENDING, std::memory_order_relaxed);
+
+                // Publish the head to sweep and `woomem_validate_addr`.
+                page->m_unit_high_water_granule.store(
+                    static_cast<uint16_t>(high_water_granule + unit_granules_with_head),
+                    std::memory_order::memory_order_release);
+
+                return allocating_unit;
+            }
+
+            current_granule = page_alloc_head->m_freed_unit_granule.exchange(
                 0,
                 std::memory_order::memory_order_acquire);
 
-            if (current_offset == 0)
+            if (current_granule == 0)
             {
                 page_alloc_head->m_run_out.store(
                     1, std::memory_order::memory_order_release);
@@ -196,27 +355,124 @@ namespace woomem
                 return nullptr;
             }
 
-            page_alloc_head->m_next_allocate_unit_offset = current_offset;
+            page_alloc_head->m_next_allocate_unit_granule = current_granule;
 
         } while (1);
     }
+    // Same as `pick_unit_from_page_without_init` for up to `count` units, the
+    // payload (unit + 1) of each is stored into `out_units`. Units carved from
+    // the tail are published with a single store of the high water mark.
+    // Returns less than `count` only if the page is run out.
+    inline size_t pick_units_from_page_without_init(
+        PageHead* page, void** out_units, size_t count)
+    {
+        PageUnitAlloc* const page_alloc_head =
+            reinterpret_cast<PageUnitAlloc*>(page + 1);
+
+        const size_t unit_granules_with_head =
+            sizeof(UnitHead) / UNIT_GRANULE_SIZE + page_alloc_head->m_unit_granules_in_page;
+        const size_t span_end_granule = get_span_end_granule(page->m_span_page_count);
+
+        size_t picked_count = 0;
+        uint16_t current_granule = page_alloc_head->m_next_allocate_unit_granule;
+        while (picked_count < count)
+        {
+            if (current_granule != 0)
+            {
+                UnitHead* const allocating_unit = reinterpret_cast<UnitHead*>(
+                    reinterpret_cast<char*>(page_alloc_head)
+                    + current_granule * UNIT_GRANULE_SIZE);
+
+                const uint16_t next_granule = allocating_unit->m_next_free_unit_granule;
+                allocating_unit->m_next_free_unit_granule = current_granule;
+
+                if (next_granule != 0)
+                    WOOMEM_PREFETCH_WRITE(
+                        reinterpret_cast<char*>(page_alloc_head)
+                        + next_granule * UNIT_GRANULE_SIZE);
+
+                assert(UnitLife::RELEASED == allocating_unit->m_life.load(
+                    std::memory_order::memory_order_relaxed));
+
+                allocating_unit->m_life.store(UnitLife::PENDING, std::memory_order_relaxed);
+                out_units[picked_count++] = allocating_unit + 1;
+
+                current_granule = next_granule;
+                page_alloc_head->m_next_allocate_unit_granule = next_granule;
+                continue;
+            }
+
+            // Carve as many units as still needed and fit in the tail at once.
+            const uint16_t high_water_granule =
+                page->m_unit_high_water_granule.load(std::memory_order::memory_order_relaxed);
+
+            const size_t carve_count = std::min(
+                count - picked_count,
+                high_water_granule < span_end_granule
+                    ? (span_end_granule - high_water_granule) / unit_granules_with_head
+                    : 0);
+
+            if (carve_count != 0)
+            {
+                size_t granule = high_water_granule;
+                for (size_t i = 0; i < carve_count; ++i)
+                {
+                    UnitHead* const allocating_unit = reinterpret_cast<UnitHead*>(
+                        reinterpret_cast<char*>(page_alloc_head)
+                        + granule * UNIT_GRANULE_SIZE);
+
+                    allocating_unit->m_next_free_unit_granule = static_cast<uint16_t>(granule);
+                    allocating_unit->m_type_id = WOOMEM_UNTYPED;
+                    allocating_unit->m_age = 0;
+                    allocating_unit->m_timing = 0;
+                    allocating_unit->m_attribute = 0;
+                    allocating_unit->m_life.store(UnitLife::PENDING, std::memory_order_relaxed);
+
+                    out_units[picked_count++] = allocating_unit + 1;
+                    granule += unit_granules_with_head;
+                }
+
+                // Publish the heads to sweep and `woomem_validate_addr`.
+                page->m_unit_high_water_granule.store(
+                    static_cast<uint16_t>(granule),
+                    std::memory_order::memory_order_release);
+                continue;
+            }
+
+            current_granule = page_alloc_head->m_freed_unit_granule.exchange(
+                0,
+                std::memory_order::memory_order_acquire);
+
+            if (current_granule == 0)
+            {
+                page_alloc_head->m_run_out.store(
+                    1, std::memory_order::memory_order_release);
+
+                break;
+            }
+
+            page_alloc_head->m_next_allocate_unit_granule = current_granule;
+        }
+        return picked_count;
+    }
     inline void drop_freed_unit_into_page(PageHead* page, UnitHead* unit)
     {
         PageUnitAlloc* const page_alloc_head =
             reinterpret_cast<PageUnitAlloc*>(page + 1);
 
-        const auto unit_offset = static_cast<uint16_t>(
-            reinterpret_cast<char*>(unit) - reinterpret_cast<char*>(page_alloc_head));
+        const auto unit_granule = static_cast<uint16_t>(
+            (reinterpret_cast<char*>(unit) - reinterpret_cast<char*>(page_alloc_head))
+            / UNIT_GRANULE_SIZE);
 
         assert(UnitLife::RELEASED == unit->m_life.load(
             std::memory_order::memory_order_relaxed));
 
-        unit->m_next_free_unit_offset = page_alloc_head->m_freed_unit_offset.load(
+        unit->m_next_free_unit_granule = page_alloc_head->m_freed_unit_granule.load(
             std::memory_order::memory_order_relaxed);
 
-        while (!page_alloc_head->m_freed_unit_offset.compare_exchange_weak(
-            unit->m_next_free_unit_offset,
-            unit_offset,
+        while (!page_alloc_head->m_freed_unit_granule.compare_exchange_weak(
+            unit->m_next_free_unit_granule,
+            unit_granule,
             std::memory_order::memory_order_release,
             std::memory_order::memory_order_relaxed))
             /* Atomic retry */;
@@ -0,0 +1,18 @@
+#pragma once
+
+/*
+WOOMEM_PREFETCH_READ / WOOMEM_PREFETCH_WRITE hint the CPU to pull the cache
+line of `ADDR` in ahead of use. They never fault, so `ADDR` may be any
+address, and expand to nothing on targets without a prefetch intrinsic.
+*/
+#if defined(__GNUC__) || defined(__clang__)
+#   define WOOMEM_PREFETCH_READ(ADDR) __builtin_prefetch((ADDR), 0, 3)
+#   define WOOMEM_PREFETCH_WRITE(ADDR) __builtin_prefetch((ADDR), 1, 3)
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#   include <xmmintrin.h>
+#   define WOOMEM_PREFETCH_READ(ADDR) _mm_prefetch(reinterpret_cast<const char*>(ADDR), _MM_HINT_T0)
+#   define WOOMEM_PREFETCH_WRITE(ADDR) _mm_prefetch(reinterpret_cast<const char*>(ADDR), _MM_HINT_T0)
+#else
+#   define WOOMEM_PREFETCH_READ(ADDR) ((void)(ADDR))
+#   define WOOMEM_PREFETCH_WRITE(ADDR) ((void)(ADDR))
+#endif
@@ -9,9 +9,13 @@ namespace woomem
     ThreadContext::ThreadContext()
         : m_thread_page_collection(
             g_global_context.m_globalcontext_inited
-            ? &g_global_context.gpc()
-            : nullptr)
+            ? g_global_context.gpcs()
+            : nullptr,
+            g_global_context.numa_node_count())
         , m_is_gc_worker_context(false)
+        , m_is_assisting_gc(false)
+        , m_gray_block(nullptr)
+        , m_unpublished_allocated_size(0)
     {
         if (g_gc_ctx != nullptr)
             m_gc_marking_context = g_gc_ctx->fetch_thread_worker();
@@ -26,11 +30,65 @@ namespace woomem
     }
     ThreadContext::~ThreadContext()
     {
+        publish_allocated_size();
+
         if (g_global_context.m_globalcontext_alive)
         {
             std::lock_guard g(g_global_context.m_thread_entries_mx);
+
+            // Hand the block over before leaving the entries, so that workers
+            // collecting blocks under the same lock find it in either place.
+            if (m_gray_block != nullptr && m_gc_marking_context != nullptr)
+            {
+                m_gc_marking_context->hand_over_gray_block(m_gray_block);
+                m_gray_block = nullptr;
+            }
             (void)g_global_context.m_thread_entries.erase(this);
         }
+
+        delete m_gray_block;
     }
+    void ThreadContext::publish_allocated_size()
+    {
+        if (m_unpublished_allocated_size == 0)
+            return;
+
+        if (g_gc_ctx != nullptr)
+        {
+            const size_t trigger_size =
+                g_gc_ctx->m_gc_trigger_alloc_size.load(std::memory_order_relaxed);
+            const size_t prev_allocated_size =
+                g_gc_ctx->m_new_allocated_size_since_last_gc.fetch_add(
+                    m_unpublished_allocated_size, std::memory_order_relaxed);
+
+            // Only the thread crossing the trigger wakes the GC up.
+            if (prev_allocated_size < trigger_size
+                && prev_allocated_size + m_unpublished_allocated_size >= trigger_size)
+                g_gc_ctx->notify_allocation_trigger();
+
+            const size_t allocated_size = m_unpublished_allocated_size;
+            const bool need_assist = g_gc_ctx->m_gc_mutator_assist
+                && !m_is_gc_worker_context
+                && !m_is_assisting_gc
+                && m_gc_marking_context != nullptr
+                && prev_allocated_size + m_unpublished_allocated_size
+                > g_gc_ctx->m_gc_assist_alloc_size.load(std::memory_order_relaxed);
+
+            m_unpublished_allocated_size = 0;
+
+            // Pay for running over the cycle's allowance right away. Callbacks
+            // called while assisting may allocate, they do not assist again.
+            if (need_assist)
+            {
+                m_is_assisting_gc = true;
+                g_gc_ctx->assist_allocation(m_gc_marking_context, allocated_size);
+                m_is_assisting_gc = false;
+            }
+            return;
+        }
+
+        m_unpublished_allocated_size = 0;
+    }
+
     thread_local ThreadContext t_thread_context;
 }
@@ -1,10 +1,16 @@
 #pragma once
 
 #include "woomem_thread_page_collection.hpp"
+#include "woomem_lock.hpp"
+
+#include <cstddef>
+#include <vector>
 
 namespace woomem
 {
     class GCWorker;
+    struct UnitHead;
+    struct GrayBlock;
     class ThreadContext
     {
     public:
@@ -12,6 +18,23 @@ namespace woomem
         /* OPTIONAL */ GCWorker* m_gc_marking_context;
 
         bool m_is_gc_worker_context;
+        // Inside GC::assist_allocation. Units shaded by this thread while
+        // assisting the marking are kept in `m_assist_gray_units`, so that it
+        // can go on tracing them instead of handing them to the workers.
+        bool m_is_assisting_gc;
+        std::vector<UnitHead*> m_assist_gray_units;
+
+        // Units shaded by this thread for its worker, see
+        // `GCWorker::mark_unit_to_gray`. Handed over once full, or taken by
+        // an idle worker before marking ends. Null while empty.
+        Spinlock m_gray_block_spin;
+        GrayBlock* m_gray_block;
+
+        // Allocated size not yet added to GC::m_new_allocated_size_since_last_gc,
+        // published in batches to keep the shared counter off the fast path.
+        size_t m_unpublished_allocated_size;
+
+        static constexpr size_t ALLOCATED_SIZE_PUBLISH_THRESHOLD = 64 * 1024;
 
         ThreadContext();
         ~ThreadContext();
@@ -20,6 +43,14 @@ namespace woomem
         ThreadContext& operator=(const ThreadContext&) = delete;
         ThreadContext(ThreadContext&&) = delete;
         ThreadContext& operator=(ThreadContext&&) = delete;
+
+        void record_allocated_size(size_t size)
+        {
+            m_unpublished_allocated_size += size;
+            if (m_unpublished_allocated_size >= ALLOCATED_SIZE_PUBLISH_THRESHOLD)
+                publish_allocated_size();
+        }
+        void publish_allocated_size();
     };
 
     extern thread_local ThreadContext t_thread_context;
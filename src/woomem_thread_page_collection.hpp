@@ -3,6 +3,7 @@
 #include <atomic>
 #include <cassert>
 
+#include "woomem.h"
 #include "woomem_chunk.hpp"
 #include "woomem_page.hpp"
 #include "woomem_page_unit_alloc.hpp"
@@ -12,16 +13,36 @@ namespace woomem
 {
     class ThreadPageCollection
     {
-        GlobalPageCollection* m_global_page_collection;
-        PageHead* m_cached_pages[UnitAllocGroup::MAX_GROUP];
+    public:
+        // Pages cached per group. The last one is being allocated from, the rest
+        // are spare pages taken from the global collection in the same refill.
+        static constexpr size_t PAGE_MAGAZINE_SIZE = 4;
+
+    private:
+        struct PageMagazine
+        {
+            PageHead*   m_pages[PAGE_MAGAZINE_SIZE];
+            size_t      m_count;
+            // The collection of the node the pages were taken from.
+            GlobalPageCollection* m_source;
+        };
+
+        // One collection per NUMA node, refills take from the node the thread
+        // is running on.
+        GlobalPageCollection* const* m_global_page_collections;
+        size_t m_numa_node_count;
+        PageMagazine m_page_magazines[MAX_GROUP];
 
     public:
-        ThreadPageCollection(/* OPTIONAL */ GlobalPageCollection* global_page_collection)
-            : m_global_page_collection(global_page_collection)
-            , m_cached_pages{}
+        ThreadPageCollection(
+            /* OPTIONAL */ GlobalPageCollection* const* global_page_collections,
+            size_t numa_node_count)
+            : m_global_page_collections(global_page_collections)
+            , m_numa_node_count(numa_node_count)
+            , m_page_magazines{}
         {
             /*
-            NOTE: global_page_collection might be nullptr if woomem is not inited yet.
+            NOTE: global_page_collections might be nullptr if woomem is not inited yet.
             */
         }
         ~ThreadPageCollection()
@@ -34,46 +55,112 @@ namespace woomem
         ThreadPageCollection(ThreadPageCollection&&) = delete;
         ThreadPageCollection& operator=(ThreadPageCollection&&) = delete;
 
-        void init_manually(GlobalPageCollection* global_page_collection)
+        void init_manually(
+            GlobalPageCollection* const* global_page_collections, size_t numa_node_count)
         {
-            assert(m_global_page_collection == nullptr);
-            m_global_page_collection = global_page_collection;
+            assert(m_global_page_collections == nullptr);
+            m_global_page_collections = global_page_collections;
+            m_numa_node_count = numa_node_count;
         }
         void shutdown_manually()
         {
-            if (m_global_page_collection != nullptr)
+            if (m_global_page_collections != nullptr)
             {
-                for (int i = 0; i < UnitAllocGroup::MAX_GROUP; ++i)
+                for (size_t i = 0; i < MAX_GROUP; ++i)
                 {
-                    PageHead* page = m_cached_pages[i];
-                    if (page != nullptr)
-                        m_global_page_collection->return_page(page, static_cast<UnitAllocGroup>(i));
+                    PageMagazine& magazine = m_page_magazines[i];
+                    for (size_t j = 0; j < magazine.m_count; ++j)
+                        magazine.m_source->return_page(
+                            magazine.m_pages[j], static_cast<UnitAllocGroup>(i));
+
+                    magazine.m_count = 0;
                 }
-                m_global_page_collection = nullptr;
+                m_global_page_collections = nullptr;
             }
         }
 
     public:
         void* pick_unit_in_page(size_t unit_size)
         {
-            assert(m_global_page_collection != nullptr && unit_size <= MAX_IN_PAGE_UNIT_SIZE);
+            assert(m_global_page_collections != nullptr && unit_size <= MAX_IN_PAGE_UNIT_SIZE);
 
             const UnitAllocGroup belong_group = eval_group_by_small_unit_size(unit_size);
 
-            PageHead*& cached_page = m_cached_pages[belong_group];
-            if (cached_page != nullptr)
+            PageMagazine& magazine = m_page_magazines[belong_group];
+            do
             {
-            _label_retry_allocate_with_new_page:
-                UnitHead* const unit = pick_unit_from_page_without_init(cached_page);
-                if (unit != nullptr)
-                    return unit + 1;
-            }
+                while (magazine.m_count != 0)
+                {
+                    PageHead* const page = magazine.m_pages[magazine.m_count - 1];
+
+                    UnitHead* const unit = pick_unit_from_page_without_init(page);
+                    if (unit != nullptr)
+                    {
+                        // The page holds a young unit now, see `m_young_unit_round`.
+                        page->m_young_unit_round.store(
+                            woomem_gc_marking_round_counter,
+                            std::memory_order::memory_order_relaxed);
+
+                        return unit + 1;
+                    }
+
+                    // The page is run out now, sweep will give it back to the
+                    // global collection once some of its units are freed.
+                    magazine.m_source->count_span_run_out(belong_group);
+                    --magazine.m_count;
+                }
+
+                magazine.m_source = m_global_page_collections[
+                    GlobalPageCollection::current_numa_node(m_numa_node_count)];
+                magazine.m_count = magazine.m_source->require_normal_pages(
+                    belong_group, magazine.m_pages, PAGE_MAGAZINE_SIZE);
+
+            } while (magazine.m_count != 0);
+
+            return nullptr;
+        }
+        // Picks up to `count` units of the same size, taking as many as possible
+        // from each cached page in one pass. Returns less than `count` only if
+        // out of memory.
+        size_t pick_units_in_page(size_t unit_size, void** out_units, size_t count)
+        {
+            assert(m_global_page_collections != nullptr && unit_size <= MAX_IN_PAGE_UNIT_SIZE);
+
+            const UnitAllocGroup belong_group = eval_group_by_small_unit_size(unit_size);
+
+            PageMagazine& magazine = m_page_magazines[belong_group];
+            size_t picked_count = 0;
+            do
+            {
+                while (magazine.m_count != 0)
+                {
+                    PageHead* const page = magazine.m_pages[magazine.m_count - 1];
+
+                    const size_t page_picked_count = pick_units_from_page_without_init(
+                        page, out_units + picked_count, count - picked_count);
+                    if (page_picked_count != 0)
+                    {
+                        page->m_young_unit_round.store(
+                            woomem_gc_marking_round_counter,
+                            std::memory_order::memory_order_relaxed);
+
+                        picked_count += page_picked_count;
+                        if (picked_count == count)
+                            return count;
+                    }
+
+                    magazine.m_source->count_span_run_out(belong_group);
+                    --magazine.m_count;
+                }
+
+                magazine.m_source = m_global_page_collections[
+                    GlobalPageCollection::current_numa_node(m_numa_node_count)];
+                magazine.m_count = magazine.m_source->require_normal_pages(
+                    belong_group, magazine.m_pages, PAGE_MAGAZINE_SIZE);
 
-            cached_page = m_global_page_collection->require_normal_page(belong_group);
-            if (cached_page == nullptr)
-                return nullptr;
+            } while (magazine.m_count != 0);
 
-            goto _label_retry_allocate_with_new_page;
+            return picked_count;
         }
     };
-}
\ No newline at end of file
+}
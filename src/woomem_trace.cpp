@@ -0,0 +1,278 @@
+#include "woomem_trace.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace woomem
+{
+    Tracer g_tracer;
+
+    static std::atomic_uint32_t g_next_trace_thread_id{ 1 };
+
+    static uint32_t current_trace_thread_id()
+    {
+        static thread_local uint32_t t_trace_thread_id = 0;
+
+        if (t_trace_thread_id == 0)
+            t_trace_thread_id = g_next_trace_thread_id.fetch_add(1, std::memory_order_relaxed);
+
+        return t_trace_thread_id;
+    }
+
+    TraceRing::TraceRing(size_t capacity)
+        : m_mask(capacity - 1)
+        , m_slots(new Slot[capacity])
+        , m_next_index{ 0 }
+    {
+        for (size_t i = 0; i < capacity; ++i)
+            m_slots[i].m_seq.store(0, std::memory_order_relaxed);
+    }
+    TraceRing::~TraceRing()
+    {
+        delete[] m_slots;
+    }
+
+    void TraceRing::push(const woomem_TraceEvent& event)
+    {
+        const uint64_t index = m_next_index.fetch_add(1, std::memory_order_relaxed);
+        Slot& slot = m_slots[index & m_mask];
+
+        slot.m_seq.store(2 * index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        slot.m_timestamp_ns.store(event.timestamp_ns, std::memory_order_relaxed);
+        slot.m_value.store(event.value, std::memory_order_relaxed);
+        slot.m_info.store(
+            static_cast<uint64_t>(event.thread_id)
+            | static_cast<uint64_t>(event.kind) << 32
+            | static_cast<uint64_t>(event.phase) << 48,
+            std::memory_order_relaxed);
+
+        slot.m_seq.store(2 * index + 2, std::memory_order_release);
+    }
+
+    size_t TraceRing::read(woomem_TraceEvent* out_events, size_t max_count) const
+    {
+        const uint64_t end_index = m_next_index.load(std::memory_order_acquire);
+        uint64_t begin_index = end_index > capacity() ? end_index - capacity() : 0;
+        if (end_index - begin_index > max_count)
+            begin_index = end_index - max_count;
+
+        size_t count = 0;
+        for (uint64_t index = begin_index; index < end_index; ++index)
+        {
+            const Slot& slot = m_slots[index & m_mask];
+
+            const uint64_t seq = slot.m_seq.load(std::memory_order_acquire);
+            if (seq != 2 * index + 2)
+                continue;
+
+            woomem_TraceEvent& event = out_events[count];
+            event.timestamp_ns = slot.m_timestamp_ns.load(std::memory_order_relaxed);
+            event.value = slot.m_value.load(std::memory_order_relaxed);
+
+            const uint64_t info = slot.m_info.load(std::memory_order_relaxed);
+            event.thread_id = static_cast<uint32_t>(info);
+            event.kind = static_cast<uint16_t>(info >> 32);
+            event.phase = static_cast<uint16_t>(info >> 48);
+
+            // Overwritten by a later event meanwhile.
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.m_seq.load(std::memory_order_relaxed) != seq)
+                continue;
+
+            ++count;
+        }
+        return count;
+    }
+
+    Tracer::Tracer()
+        : m_enabled{ false }
+        , m_ring(nullptr)
+        , m_callback(nullptr)
+    {
+    }
+    Tracer::~Tracer()
+    {
+        delete m_ring;
+    }
+
+    bool Tracer::set(size_t event_capacity, woomem_TraceCallback callback)
+    {
+        TraceRing* ring = nullptr;
+        if (event_capacity != 0)
+        {
+            size_t capacity = 1;
+            while (capacity < event_capacity)
+            {
+                if (capacity > SIZE_MAX / 2 / sizeof(woomem_TraceEvent))
+                    return false;
+                capacity *= 2;
+            }
+            ring = new TraceRing(capacity);
+        }
+
+        TraceRing* old_ring;
+        do
+        {
+            ReadWriteSpinlock::WriteGuard g(m_ring_rwlock);
+
+            old_ring = m_ring;
+            m_ring = ring;
+            m_callback = callback;
+            m_enabled.store(ring != nullptr || callback != nullptr, std::memory_order_relaxed);
+        } while (0);
+
+        delete old_ring;
+        return true;
+    }
+
+    void Tracer::emit(woomem_TraceEventKind kind, size_t phase, uint64_t value)
+    {
+        woomem_TraceEvent event;
+        event.timestamp_ns = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+        event.value = value;
+        event.thread_id = current_trace_thread_id();
+        event.kind = static_cast<uint16_t>(kind);
+        event.phase = static_cast<uint16_t>(phase);
+
+        ReadWriteSpinlock::ReadGuard g(m_ring_rwlock);
+
+        if (m_ring != nullptr)
+            m_ring->push(event);
+        if (m_callback != nullptr)
+            m_callback(&event);
+    }
+
+    size_t Tracer::read(woomem_TraceEvent* out_events, size_t max_count)
+    {
+        ReadWriteSpinlock::ReadGuard g(m_ring_rwlock);
+
+        if (m_ring == nullptr)
+            return 0;
+
+        return m_ring->read(out_events, max_count);
+    }
+
+    bool Tracer::write_json(const char* path)
+    {
+        std::vector<woomem_TraceEvent> events;
+        do
+        {
+            ReadWriteSpinlock::ReadGuard g(m_ring_rwlock);
+
+            if (m_ring == nullptr)
+                break;
+
+            events.resize(m_ring->capacity());
+            events.resize(m_ring->read(events.data(), events.size()));
+        } while (0);
+
+        FILE* const file = fopen(path, "w");
+        if (file == nullptr)
+            return false;
+
+        static const char* const PHASE_NAMES[WOOMEM_GC_PHASE_COUNT] = {
+            "root mark",
+            "parallel mark",
+            "final mark",
+            "sweep",
+        };
+        auto phase_name = [](uint16_t phase)
+            {
+                return phase < WOOMEM_GC_PHASE_COUNT ? PHASE_NAMES[phase] : "gc";
+            };
+
+        // Threads are named by the events they emitted.
+        std::map<uint32_t, std::string> thread_names;
+        for (const woomem_TraceEvent& event : events)
+        {
+            switch (event.kind)
+            {
+            case WOOMEM_TRACE_CYCLE_BEGIN:
+            case WOOMEM_TRACE_PHASE_BEGIN:
+                thread_names[event.thread_id] = "woomem gc main";
+                break;
+            case WOOMEM_TRACE_WORKER_BEGIN:
+                thread_names[event.thread_id] =
+                    "woomem gc worker " + std::to_string(event.value);
+                break;
+            default:
+                break;
+            }
+        }
+
+        fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+        bool first = true;
+        for (const auto& [thread_id, name] : thread_names)
+        {
+            fprintf(file,
+                "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                "\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",\n", thread_id, name.c_str());
+            first = false;
+        }
+
+        const uint64_t base_ns = events.empty() ? 0 : events.front().timestamp_ns;
+        for (const woomem_TraceEvent& event : events)
+        {
+            const char* name;
+            const char* ph;
+            const char* arg_name = nullptr;
+            switch (event.kind)
+            {
+            case WOOMEM_TRACE_CYCLE_BEGIN:
+                name = "gc cycle"; ph = "B"; arg_name = "minor";
+                break;
+            case WOOMEM_TRACE_CYCLE_END:
+                name = "gc cycle"; ph = "E"; arg_name = "alive_size";
+                break;
+            case WOOMEM_TRACE_PHASE_BEGIN:
+            case WOOMEM_TRACE_WORKER_BEGIN:
+                name = phase_name(event.phase); ph = "B";
+                break;
+            case WOOMEM_TRACE_PHASE_END:
+            case WOOMEM_TRACE_WORKER_END:
+                name = phase_name(event.phase); ph = "E";
+                break;
+            case WOOMEM_TRACE_GRAY_QUEUE_OVERFLOW:
+                name = "gray queue grow"; ph = "i"; arg_name = "blocks";
+                break;
+            case WOOMEM_TRACE_CHUNK_RESERVE_FAILED:
+                name = "chunk reserve failed"; ph = "i"; arg_name = "size";
+                break;
+            default:
+                continue;
+            }
+
+            // Events may be written out of order by racing threads.
+            const uint64_t ns = event.timestamp_ns > base_ns ? event.timestamp_ns - base_ns : 0;
+            fprintf(file,
+                "%s{\"name\":\"%s\",\"cat\":\"woomem\",\"ph\":\"%s\",\"ts\":%llu.%03llu,"
+                "\"pid\":1,\"tid\":%u",
+                first ? "" : ",\n",
+                name,
+                ph,
+                static_cast<unsigned long long>(ns / 1000),
+                static_cast<unsigned long long>(ns % 1000),
+                event.thread_id);
+            first = false;
+
+            if (ph[0] == 'i')
+                fprintf(file, ",\"s\":\"t\"");
+            if (arg_name != nullptr)
+                fprintf(file, ",\"args\":{\"%s\":%llu}",
+                    arg_name, static_cast<unsigned long long>(event.value));
+            fprintf(file, "}");
+        }
+
+        fprintf(file, "\n]}\n");
+        return fclose(file) == 0;
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "woomem.h"
+#include "woomem_rwlock.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+namespace woomem
+{
+    /*
+    Lock-free ring of the latest trace events. Writers claim slots with one
+    fetch_add and overwrite the oldest events; every slot is guarded by a
+    sequence number, so readers skip slots overwritten while being copied.
+    */
+    class TraceRing
+    {
+    public:
+        // `capacity` must be a power of 2.
+        explicit TraceRing(size_t capacity);
+        ~TraceRing();
+
+        TraceRing(const TraceRing&) = delete;
+        TraceRing(TraceRing&&) = delete;
+        TraceRing& operator=(const TraceRing&) = delete;
+        TraceRing& operator=(TraceRing&&) = delete;
+
+        size_t capacity() const
+        {
+            return m_mask + 1;
+        }
+
+        void push(const woomem_TraceEvent& event);
+        size_t read(woomem_TraceEvent* out_events, size_t max_count) const;
+
+    private:
+        struct Slot
+        {
+            // 2 * index + 1 while the event `index` is written, 2 * index + 2 after.
+            std::atomic_uint64_t m_seq;
+            std::atomic_uint64_t m_timestamp_ns;
+            std::atomic_uint64_t m_value;
+            // thread_id | kind << 32 | phase << 48
+            std::atomic_uint64_t m_info;
+        };
+
+        const size_t        m_mask;
+        Slot* const         m_slots;
+        std::atomic_uint64_t m_next_index;
+    };
+
+    class Tracer
+    {
+    public:
+        Tracer();
+        ~Tracer();
+
+        Tracer(const Tracer&) = delete;
+        Tracer(Tracer&&) = delete;
+        Tracer& operator=(const Tracer&) = delete;
+        Tracer& operator=(Tracer&&) = delete;
+
+        bool set(size_t event_capacity, woomem_TraceCallback callback);
+
+        bool is_enabled() const
+        {
+            return m_enabled.load(std::memory_order_relaxed);
+        }
+        void emit(woomem_TraceEventKind kind, size_t phase, uint64_t value);
+
+        size_t read(woomem_TraceEvent* out_events, size_t max_count);
+        bool write_json(const char* path);
+
+    private:
+        std::atomic_bool        m_enabled;
+
+        // Emitting threads hold it for reading, `set` replaces the ring under
+        // the write lock.
+        ReadWriteSpinlock       m_ring_rwlock;
+        TraceRing*              m_ring;
+        woomem_TraceCallback    m_callback;
+    };
+
+    extern Tracer g_tracer;
+
+    inline void trace_event(
+        woomem_TraceEventKind kind,
+        size_t phase = WOOMEM_GC_PHASE_COUNT,
+        uint64_t value = 0)
+    {
+        if (g_tracer.is_enabled())
+            g_tracer.emit(kind, phase, value);
+    }
+}
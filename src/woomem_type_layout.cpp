@@ -0,0 +1,86 @@
+#include "woomem_type_layout.hpp"
+
+#include <cstdlib>
+#include <algorithm>
+
+namespace woomem
+{
+    TypeLayoutRegistry::TypeLayoutRegistry()
+        : m_next_type_id(1)
+        , m_blocks{}
+    {
+    }
+    TypeLayoutRegistry::~TypeLayoutRegistry()
+    {
+        for (auto& block_ptr : m_blocks)
+        {
+            std::atomic<const TypeLayout*>* const block =
+                block_ptr.load(std::memory_order_relaxed);
+
+            if (block == nullptr)
+                continue;
+
+            for (size_t i = 0; i < TYPE_LAYOUT_BLOCK_SIZE; ++i)
+                free(const_cast<TypeLayout*>(block[i].load(std::memory_order_relaxed)));
+
+            delete[] block;
+        }
+    }
+
+    woomem_TypeId TypeLayoutRegistry::register_type(
+        size_t size, const size_t* pointer_offsets, size_t pointer_count)
+    {
+        for (size_t i = 0; i < pointer_count; ++i)
+        {
+            if (pointer_offsets[i] % sizeof(void*) != 0
+                || pointer_offsets[i] + sizeof(void*) > size
+                || pointer_offsets[i] / sizeof(void*) > UINT32_MAX)
+                return WOOMEM_UNTYPED;
+        }
+
+        TypeLayout* const layout = reinterpret_cast<TypeLayout*>(malloc(
+            sizeof(TypeLayout) + sizeof(uint32_t) * (pointer_count == 0 ? 0 : pointer_count - 1)));
+        if (layout == nullptr)
+            return WOOMEM_UNTYPED;
+
+        layout->m_size = size;
+        for (size_t i = 0; i < pointer_count; ++i)
+            layout->m_pointer_slots[i] =
+                static_cast<uint32_t>(pointer_offsets[i] / sizeof(void*));
+
+        // Ascending and without duplicates, targets are visited in address order.
+        std::sort(layout->m_pointer_slots, layout->m_pointer_slots + pointer_count);
+        layout->m_pointer_slot_count = static_cast<size_t>(
+            std::unique(layout->m_pointer_slots, layout->m_pointer_slots + pointer_count)
+            - layout->m_pointer_slots);
+
+        std::lock_guard g(m_register_mx);
+
+        if (m_next_type_id > MAX_TYPE_ID)
+        {
+            free(layout);
+            return WOOMEM_UNTYPED;
+        }
+
+        const size_t type_id = m_next_type_id;
+
+        std::atomic<std::atomic<const TypeLayout*>*>& block_ptr =
+            m_blocks[type_id / TYPE_LAYOUT_BLOCK_SIZE];
+
+        std::atomic<const TypeLayout*>* block = block_ptr.load(std::memory_order_relaxed);
+        if (block == nullptr)
+        {
+            block = new std::atomic<const TypeLayout*>[TYPE_LAYOUT_BLOCK_SIZE];
+            for (size_t i = 0; i < TYPE_LAYOUT_BLOCK_SIZE; ++i)
+                block[i].store(nullptr, std::memory_order_relaxed);
+
+            block_ptr.store(block, std::memory_order_release);
+        }
+        block[type_id % TYPE_LAYOUT_BLOCK_SIZE].store(layout, std::memory_order_release);
+
+        ++m_next_type_id;
+        return static_cast<woomem_TypeId>(type_id);
+    }
+
+    TypeLayoutRegistry g_type_layouts;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "woomem.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <mutex>
+
+namespace woomem
+{
+    /*
+    Pointer layout of a registered type. Units allocated with a type id are
+    scanned precisely: only the listed slots are visited, and each of them must
+    hold NULL or a unit returned by woomem_allocate_begin(_typed).
+    */
+    struct TypeLayout
+    {
+        size_t      m_size;
+        size_t      m_pointer_slot_count;
+        // Index of pointer sized slots from the beginning of the unit, ascending.
+        uint32_t    m_pointer_slots[1];
+    };
+
+    /*
+    Type ids are handed out in order and never reused. Layouts are kept in
+    blocks of TYPE_LAYOUT_BLOCK_SIZE published through atomic pointers, so
+    GC workers look them up without any lock while new types are registered.
+    */
+    class TypeLayoutRegistry
+    {
+    public:
+        static constexpr size_t TYPE_LAYOUT_BLOCK_SIZE = 256;
+        static constexpr size_t MAX_TYPE_ID = UINT16_MAX;
+
+        TypeLayoutRegistry();
+        ~TypeLayoutRegistry();
+
+        TypeLayoutRegistry(const TypeLayoutRegistry&) = delete;
+        TypeLayoutRegistry(TypeLayoutRegistry&&) = delete;
+        TypeLayoutRegistry& operator=(const TypeLayoutRegistry&) = delete;
+        TypeLayoutRegistry& operator=(TypeLayoutRegistry&&) = delete;
+
+        // Returns WOOMEM_UNTYPED if the layout is invalid or all ids are used.
+        woomem_TypeId register_type(
+            size_t size, const size_t* pointer_offsets, size_t pointer_count);
+
+        // nullptr if `type_id` is not registered.
+        const TypeLayout* get_layout(woomem_TypeId type_id) const
+        {
+            using LayoutBlock = std::atomic<const TypeLayout*>;
+
+            const LayoutBlock* const block =
+                m_blocks[type_id / TYPE_LAYOUT_BLOCK_SIZE].load(std::memory_order_acquire);
+
+            if (block == nullptr)
+                return nullptr;
+
+            return block[type_id % TYPE_LAYOUT_BLOCK_SIZE].load(std::memory_order_acquire);
+        }
+
+    private:
+        static constexpr size_t TYPE_LAYOUT_BLOCK_COUNT =
+            (MAX_TYPE_ID + TYPE_LAYOUT_BLOCK_SIZE) / TYPE_LAYOUT_BLOCK_SIZE;
+
+        std::mutex  m_register_mx;
+        size_t      m_next_type_id;
+
+        std::atomic<std::atomic<const TypeLayout*>*> m_blocks[TYPE_LAYOUT_BLOCK_COUNT];
+    };
+
+    extern TypeLayoutRegistry g_type_layouts;
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace woomem
+{
+    struct UnitHead;
+
+    /*
+    Chase-Lev work stealing deque (Le, Pop, Cohen, Nardelli: "Correct and
+    Efficient Work-Stealing for Weak Memory Models", 2013).
+
+    Only the owner thread may `push` and `pop`, at the bottom end. Any thread
+    may `steal` from the top end. The ring buffer grows on demand; replaced
+    buffers might still be read by a concurrent thief, so they are kept until
+    `reclaim_retired_buffers` is called while no thief is running.
+    */
+    class WorkStealingDeque
+    {
+        struct RingBuffer
+        {
+            const int64_t                   m_mask;
+            std::atomic<UnitHead*>* const   m_slots;
+
+            explicit RingBuffer(int64_t capacity)
+                : m_mask(capacity - 1)
+                , m_slots(new std::atomic<UnitHead*>[static_cast<size_t>(capacity)])
+            {
+                assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+            }
+            ~RingBuffer()
+            {
+                delete[] m_slots;
+            }
+
+            RingBuffer(const RingBuffer&) = delete;
+            RingBuffer& operator=(const RingBuffer&) = delete;
+
+            int64_t capacity() const
+            {
+                return m_mask + 1;
+            }
+            UnitHead* get(int64_t idx) const
+            {
+                return m_slots[idx & m_mask].load(std::memory_order_relaxed);
+            }
+            void put(int64_t idx, UnitHead* item)
+            {
+                m_slots[idx & m_mask].store(item, std::memory_order_relaxed);
+            }
+        };
+
+        alignas(64) std::atomic<int64_t>        m_top;
+        alignas(64) std::atomic<int64_t>        m_bottom;
+        std::atomic<RingBuffer*>                m_buffer;
+        std::vector<RingBuffer*>                m_retired_buffers;
+
+    public:
+        static constexpr int64_t INITIAL_CAPACITY = 1024;
+
+        WorkStealingDeque()
+            : m_top{ 0 }
+            , m_bottom{ 0 }
+            , m_buffer{ new RingBuffer(INITIAL_CAPACITY) }
+        {}
+        ~WorkStealingDeque()
+        {
+            reclaim_retired_buffers();
+            delete m_buffer.load(std::memory_order_relaxed);
+        }
+
+        WorkStealingDeque(const WorkStealingDeque&) = delete;
+        WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+        WorkStealingDeque(WorkStealingDeque&&) = delete;
+        WorkStealingDeque& operator=(WorkStealingDeque&&) = delete;
+
+        // Owner only.
+        void push(UnitHead* item)
+        {
+            const int64_t b = m_bottom.load(std::memory_order_relaxed);
+            const int64_t t = m_top.load(std::memory_order_acquire);
+            RingBuffer* buffer = m_buffer.load(std::memory_order_relaxed);
+
+            if (b - t > buffer->capacity() - 1)
+                buffer = grow(buffer, b, t);
+
+            buffer->put(b, item);
+            std::atomic_thread_fence(std::memory_order_release);
+            m_bottom.store(b + 1, std::memory_order_relaxed);
+        }
+
+        // Owner only.
+        UnitHead* pop()
+        {
+            const int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+            RingBuffer* const buffer = m_buffer.load(std::memory_order_relaxed);
+
+            m_bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            int64_t t = m_top.load(std::memory_order_relaxed);
+            if (t > b)
+            {
+                // Empty.
+                m_bottom.store(b + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+
+            UnitHead* item = buffer->get(b);
+            if (t == b)
+            {
+                // Last item, race with thieves.
+                if (!m_top.compare_exchange_strong(
+                    t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                    item = nullptr;
+
+                m_bottom.store(b + 1, std::memory_order_relaxed);
+            }
+            return item;
+        }
+
+        // Any thread. Returns nullptr if the deque looked empty or another
+        // thread won the race for the top item.
+        UnitHead* steal()
+        {
+            int64_t t = m_top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            const int64_t b = m_bottom.load(std::memory_order_acquire);
+
+            if (t >= b)
+                return nullptr;
+
+            RingBuffer* const buffer = m_buffer.load(std::memory_order_acquire);
+            UnitHead* const item = buffer->get(t);
+
+            if (!m_top.compare_exchange_strong(
+                t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                return nullptr;
+
+            return item;
+        }
+
+        // Any thread, a hint only.
+        bool empty() const
+        {
+            const int64_t t = m_top.load(std::memory_order_relaxed);
+            const int64_t b = m_bottom.load(std::memory_order_relaxed);
+            return b <= t;
+        }
+
+        // Owner only, and no thread may be stealing from this deque.
+        void reclaim_retired_buffers()
+        {
+            for (RingBuffer* buffer : m_retired_buffers)
+                delete buffer;
+            m_retired_buffers.clear();
+        }
+
+    private:
+        RingBuffer* grow(RingBuffer* buffer, int64_t b, int64_t t)
+        {
+            RingBuffer* const new_buffer = new RingBuffer(buffer->capacity() * 2);
+            for (int64_t i = t; i < b; ++i)
+                new_buffer->put(i, buffer->get(i));
+
+            m_retired_buffers.push_back(buffer);
+            m_buffer.store(new_buffer, std::memory_order_release);
+            return new_buffer;
+        }
+    };
+}
@@ -1,9 +1,12 @@
 #include "woomem.h"
 #include "woomem_chunk.hpp"
+#include "woomem_chunk_registry.hpp"
 
+#include <algorithm>
 #include <atomic>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <thread>
 #include <vector>
 
@@ -151,6 +154,40 @@ TEST(huge_page_exceeds_available)
     CHECK(chunk.allocate_huge_page(128 * 1024) == nullptr);
 }
 
+TEST(span_of_several_pages)
+{
+    Chunk chunk(1024 * 1024);
+    PageHead* span = chunk.allocate_page(4);
+    CHECK(span != nullptr);
+    CHECK_EQ(span->m_page_count_if_huge, static_cast<size_t>(0));
+    CHECK_EQ(static_cast<size_t>(span->m_span_page_count), static_cast<size_t>(4));
+
+    char* interior = reinterpret_cast<char*>(span) + 3 * PageHead::NORMAL_PAGE_SIZE + 10;
+    CHECK(chunk.validate(interior) == span);
+
+    // The span uses the bitmaps of all of its pages.
+    CHECK_EQ(mark_bitmap_word_count(span), 4 * MARK_BITMAP_WORDS_PER_PAGE);
+    CHECK(chunk.add_root(span, 3 * 4096 + 5));
+
+    std::vector<size_t> granules;
+    mark_bitmap_for_each_set(
+        chunk.get_root_bitmap(span),
+        mark_bitmap_word_count(span),
+        [&](size_t granule) { granules.push_back(granule); });
+    CHECK_EQ(granules.size(), static_cast<size_t>(1));
+    CHECK_EQ(granules[0], static_cast<size_t>(3 * 4096 + 5));
+    CHECK(chunk.remove_root(span, 3 * 4096 + 5));
+
+    PageHead* next = chunk.allocate_page();
+    CHECK(next != nullptr);
+    CHECK_EQ(static_cast<size_t>(next->m_span_page_count), static_cast<size_t>(1));
+    CHECK(reinterpret_cast<char*>(next) >= reinterpret_cast<char*>(span) + 4 * PageHead::NORMAL_PAGE_SIZE
+        || reinterpret_cast<char*>(next) < reinterpret_cast<char*>(span));
+
+    chunk.free_page(span);
+    chunk.free_page(next);
+}
+
 TEST(validate_nullptr_returns_null)
 {
     Chunk chunk(1024 * 1024);
@@ -202,6 +239,64 @@ TEST(validate_huge_page_interior)
     chunk.free_page(p);
 }
 
+TEST(validate_huge_page_every_page_then_reuse)
+{
+    Chunk chunk(1024 * 1024);
+    PageHead* p = chunk.allocate_huge_page(8 * PageHead::NORMAL_PAGE_SIZE);
+    CHECK(p != nullptr);
+    for (size_t i = 0; i < 8; i++)
+    {
+        char* in_page = reinterpret_cast<char*>(p) + i * PageHead::NORMAL_PAGE_SIZE + 8;
+        CHECK_EQ(chunk.validate(in_page), p);
+    }
+    chunk.free_page(p);
+
+    PageHead* a = chunk.allocate_page();
+    PageHead* b = chunk.allocate_page();
+    CHECK_EQ(a, p);
+    CHECK(b != nullptr);
+    CHECK_EQ(chunk.validate(reinterpret_cast<char*>(b) + 16), b);
+    CHECK(chunk.validate(reinterpret_cast<char*>(p) + 2 * PageHead::NORMAL_PAGE_SIZE) == nullptr);
+    chunk.free_page(a);
+    chunk.free_page(b);
+}
+
+TEST(huge_page_resize_in_place)
+{
+    Chunk chunk(1024 * 1024);
+    PageHead* p = chunk.allocate_huge_page(2 * PageHead::NORMAL_PAGE_SIZE);
+    CHECK(p != nullptr);
+    PageHead* next = chunk.allocate_page();
+    CHECK_EQ(reinterpret_cast<char*>(next), reinterpret_cast<char*>(p) + 2 * PageHead::NORMAL_PAGE_SIZE);
+
+    char* payload = reinterpret_cast<char*>(p + 1);
+    memset(payload, 0x5A, PageHead::NORMAL_PAGE_SIZE);
+
+    // Blocked by the allocated neighbor, the run is left as is.
+    CHECK(!chunk.resize_huge_page(p, 3 * PageHead::NORMAL_PAGE_SIZE));
+    CHECK_EQ(p->m_page_count_if_huge, static_cast<size_t>(2));
+
+    chunk.free_page(next);
+    CHECK(chunk.resize_huge_page(p, 5 * PageHead::NORMAL_PAGE_SIZE));
+    CHECK_EQ(p->m_page_count_if_huge, static_cast<size_t>(5));
+    CHECK_EQ(chunk.validate(reinterpret_cast<char*>(p) + 4 * PageHead::NORMAL_PAGE_SIZE + 8), p);
+    CHECK_EQ(payload[PageHead::NORMAL_PAGE_SIZE - 1], 0x5A);
+    memset(reinterpret_cast<char*>(p) + 4 * PageHead::NORMAL_PAGE_SIZE, 0, PageHead::NORMAL_PAGE_SIZE);
+
+    // Shrinking gives the trailing pages back.
+    CHECK(chunk.resize_huge_page(p, 100));
+    CHECK_EQ(p->m_page_count_if_huge, static_cast<size_t>(1));
+    CHECK(chunk.validate(reinterpret_cast<char*>(p) + PageHead::NORMAL_PAGE_SIZE) == nullptr);
+    CHECK_EQ(chunk.get_dirty_free_size(), static_cast<size_t>(4 * PageHead::NORMAL_PAGE_SIZE));
+
+    PageHead* rest = chunk.allocate_huge_page(31 * PageHead::NORMAL_PAGE_SIZE);
+    CHECK_EQ(reinterpret_cast<char*>(rest), reinterpret_cast<char*>(p) + PageHead::NORMAL_PAGE_SIZE);
+    CHECK(!chunk.resize_huge_page(p, 2 * PageHead::NORMAL_PAGE_SIZE));
+
+    chunk.free_page(rest);
+    chunk.free_page(p);
+}
+
 TEST(buddy_coalesce_all_to_max_order)
 {
     Chunk chunk(1024 * 1024);
@@ -248,6 +343,163 @@ TEST(buddy_no_coalesce_when_still_allocated)
     chunk.free_page(p2);
 }
 
+TEST(fragmented_runs_coalesce_through_both_neighbors)
+{
+    Chunk chunk(2 * 1024 * 1024);
+    constexpr int kPages = 64;
+    PageHead* pages[kPages];
+    for (int i = 0; i < kPages; i++)
+    {
+        pages[i] = chunk.allocate_page();
+        CHECK(pages[i] != nullptr);
+    }
+
+    // Leave single free pages between allocated ones.
+    for (int i = 0; i < kPages; i += 2)
+        chunk.free_page(pages[i]);
+    CHECK(chunk.allocate_huge_page(2 * PageHead::NORMAL_PAGE_SIZE) == nullptr);
+
+    // Freeing the odd pages merges the left and right neighbors every time.
+    for (int i = 1; i < kPages; i += 2)
+        chunk.free_page(pages[i]);
+
+    PageHead* huge = chunk.allocate_huge_page(kPages * PageHead::NORMAL_PAGE_SIZE);
+    CHECK_EQ(huge, pages[0]);
+    chunk.free_page(huge);
+}
+
+TEST(free_runs_prefer_fitting_bin)
+{
+    Chunk chunk(4 * 1024 * 1024);
+    PageHead* big = chunk.allocate_huge_page(40 * PageHead::NORMAL_PAGE_SIZE);
+    PageHead* sep0 = chunk.allocate_page();
+    PageHead* small = chunk.allocate_huge_page(3 * PageHead::NORMAL_PAGE_SIZE);
+    PageHead* sep1 = chunk.allocate_page();
+    CHECK(big != nullptr && sep0 != nullptr && small != nullptr && sep1 != nullptr);
+
+    chunk.free_page(big);
+    chunk.free_page(small);
+
+    // An exact-size request takes the 3-page run instead of splitting the big one.
+    PageHead* again = chunk.allocate_huge_page(3 * PageHead::NORMAL_PAGE_SIZE);
+    CHECK_EQ(again, small);
+
+    // A 33-page request must still find the 40-page run.
+    PageHead* mid = chunk.allocate_huge_page(33 * PageHead::NORMAL_PAGE_SIZE);
+    CHECK_EQ(mid, big);
+
+    chunk.free_page(mid);
+    chunk.free_page(again);
+    chunk.free_page(sep0);
+    chunk.free_page(sep1);
+
+    PageHead* all = chunk.allocate_huge_page(chunk.get_total_size());
+    CHECK(all != nullptr);
+    chunk.free_page(all);
+}
+
+TEST(purge_idle_free_pages_and_reuse)
+{
+    Chunk chunk(1024 * 1024);
+    PageHead* pages[8];
+    for (int i = 0; i < 8; i++)
+    {
+        pages[i] = chunk.allocate_page();
+        CHECK(pages[i] != nullptr);
+        pages[i]->m_page_count_if_huge = 0x5A5A;
+    }
+    for (int i = 0; i < 8; i++)
+        chunk.free_page(pages[i]);
+
+    // Not idle long enough yet.
+    CHECK_EQ(chunk.purge(0, 2), static_cast<size_t>(0));
+    CHECK_EQ(chunk.purge(0, 2), 8 * PageHead::NORMAL_PAGE_SIZE);
+    CHECK_EQ(chunk.purge(0, 0), static_cast<size_t>(0));
+
+    // Decommitted pages are committed again when allocated.
+    PageHead* huge = chunk.allocate_huge_page(8 * PageHead::NORMAL_PAGE_SIZE);
+    CHECK_EQ(huge, pages[0]);
+    memset(reinterpret_cast<char*>(huge) + sizeof(PageHead), 0xCD,
+        8 * PageHead::NORMAL_PAGE_SIZE - sizeof(PageHead));
+    chunk.free_page(huge);
+}
+
+TEST(purge_keeps_retained_budget)
+{
+    Chunk chunk(1024 * 1024);
+    PageHead* a = chunk.allocate_huge_page(4 * PageHead::NORMAL_PAGE_SIZE);
+    PageHead* sep = chunk.allocate_page();
+    PageHead* b = chunk.allocate_huge_page(2 * PageHead::NORMAL_PAGE_SIZE);
+    PageHead* sep2 = chunk.allocate_page();
+    CHECK(a != nullptr && sep != nullptr && b != nullptr && sep2 != nullptr);
+    chunk.free_page(a);
+    chunk.free_page(b);
+
+    // 6 dirty pages, keep 2: only the larger run has to go.
+    CHECK_EQ(chunk.purge(2 * PageHead::NORMAL_PAGE_SIZE, 0), 4 * PageHead::NORMAL_PAGE_SIZE);
+    CHECK_EQ(chunk.purge(2 * PageHead::NORMAL_PAGE_SIZE, 0), static_cast<size_t>(0));
+    CHECK_EQ(chunk.purge(0, 0), 2 * PageHead::NORMAL_PAGE_SIZE);
+
+    chunk.free_page(sep);
+    chunk.free_page(sep2);
+    CHECK_EQ(chunk.purge(0, 0), 2 * PageHead::NORMAL_PAGE_SIZE);
+}
+
+TEST(stats_free_runs_and_committed_size)
+{
+    Chunk chunk(64 * PageHead::NORMAL_PAGE_SIZE);
+    const size_t page_size = PageHead::NORMAL_PAGE_SIZE;
+
+    Chunk::Stats stats = chunk.get_stats();
+    CHECK_EQ(stats.m_committed_size, static_cast<size_t>(0));
+    CHECK_EQ(stats.m_free_run_count, static_cast<size_t>(1));
+    CHECK_EQ(stats.m_largest_free_run_size, 64 * page_size);
+
+    PageHead* a = chunk.allocate_huge_page(4 * page_size);
+    PageHead* sep = chunk.allocate_page();
+    PageHead* b = chunk.allocate_huge_page(2 * page_size);
+    CHECK(a != nullptr && sep != nullptr && b != nullptr);
+
+    stats = chunk.get_stats();
+    CHECK_EQ(stats.m_committed_size, 7 * page_size);
+    CHECK_EQ(stats.m_free_run_count, static_cast<size_t>(1));
+    CHECK_EQ(stats.m_largest_free_run_size, 57 * page_size);
+
+    // Freed pages stay committed until purged, `b` merges into the tail.
+    chunk.free_page(a);
+    chunk.free_page(b);
+
+    stats = chunk.get_stats();
+    CHECK_EQ(stats.m_committed_size, 7 * page_size);
+    CHECK_EQ(stats.m_free_run_count, static_cast<size_t>(2));
+    CHECK_EQ(stats.m_largest_free_run_size, 59 * page_size);
+
+    CHECK_EQ(chunk.purge(0, 0), 6 * page_size);
+    stats = chunk.get_stats();
+    CHECK_EQ(stats.m_committed_size, page_size);
+    CHECK_EQ(stats.m_free_run_count, static_cast<size_t>(2));
+
+    chunk.free_page(sep);
+    stats = chunk.get_stats();
+    CHECK_EQ(stats.m_committed_size, page_size);
+    CHECK_EQ(stats.m_free_run_count, static_cast<size_t>(1));
+    CHECK_EQ(stats.m_largest_free_run_size, 64 * page_size);
+}
+
+TEST(huge_page_backing_alignment)
+{
+    Chunk chunk(3 * 1024 * 1024, true);
+    CHECK(!chunk.is_init_failed());
+    CHECK_EQ(chunk.get_total_size(), 2 * Chunk::HUGE_PAGE_SIZE);
+
+    PageHead* p = chunk.allocate_huge_page(Chunk::HUGE_PAGE_SIZE);
+    CHECK(p != nullptr);
+    CHECK_EQ(reinterpret_cast<uintptr_t>(p) % Chunk::HUGE_PAGE_SIZE, static_cast<uintptr_t>(0));
+    memset(reinterpret_cast<char*>(p) + sizeof(PageHead), 0xAB,
+        Chunk::HUGE_PAGE_SIZE - sizeof(PageHead));
+    chunk.free_page(p);
+}
+
 TEST(multi_chunk_isolation)
 {
     Chunk chunk1(1024 * 1024);
@@ -292,6 +544,300 @@ TEST(huge_page_boundary_case)
     chunk.free_page(p);
 }
 
+TEST(registry_grows_when_chunk_exhausted)
+{
+    ChunkRegistry chunks(4 * PageHead::NORMAL_PAGE_SIZE, false);
+    CHECK(!chunks.is_init_failed());
+    CHECK_EQ(chunks.get_chunk_count(), static_cast<size_t>(1));
+
+    std::vector<PageHead*> pages;
+    for (int i = 0; i < 32; i++)
+    {
+        PageHead* p = chunks.allocate_page();
+        CHECK(p != nullptr);
+        pages.push_back(p);
+    }
+    CHECK(chunks.get_chunk_count() > 1);
+    CHECK(chunks.get_total_size() >= 32 * PageHead::NORMAL_PAGE_SIZE);
+
+    for (PageHead* p : pages)
+    {
+        CHECK_EQ(chunks.validate(p), p);
+        CHECK_EQ(chunks.validate(reinterpret_cast<char*>(p) + 100), p);
+        CHECK(chunks.find_chunk(p) != nullptr);
+    }
+    for (PageHead* p : pages)
+        chunks.free_page(p);
+    for (PageHead* p : pages)
+        CHECK(chunks.validate(p) == nullptr);
+}
+
+TEST(registry_huge_page_larger_than_chunk)
+{
+    ChunkRegistry chunks(4 * PageHead::NORMAL_PAGE_SIZE, false);
+    CHECK(!chunks.is_init_failed());
+
+    const size_t sz = 100 * PageHead::NORMAL_PAGE_SIZE;
+    PageHead* p = chunks.allocate_huge_page(sz);
+    CHECK(p != nullptr);
+    CHECK_EQ(chunks.get_chunk_count(), static_cast<size_t>(2));
+    CHECK_EQ(chunks.validate(reinterpret_cast<char*>(p) + sz - 1), p);
+
+    chunks.free_page(p);
+    CHECK(chunks.validate(p) == nullptr);
+
+    // The freed run is reused instead of reserving yet another chunk.
+    PageHead* q = chunks.allocate_huge_page(sz);
+    CHECK_EQ(q, p);
+    CHECK_EQ(chunks.get_chunk_count(), static_cast<size_t>(2));
+    chunks.free_page(q);
+}
+
+TEST(registry_purge_shares_budget)
+{
+    ChunkRegistry chunks(4 * PageHead::NORMAL_PAGE_SIZE, false);
+    CHECK(!chunks.is_init_failed());
+
+    std::vector<PageHead*> pages;
+    for (int i = 0; i < 12; i++)
+    {
+        PageHead* p = chunks.allocate_page();
+        CHECK(p != nullptr);
+        memset(reinterpret_cast<char*>(p) + sizeof(PageHead), 0xCD,
+            PageHead::NORMAL_PAGE_SIZE - sizeof(PageHead));
+        pages.push_back(p);
+    }
+    for (PageHead* p : pages)
+        chunks.free_page(p);
+
+    // Whole runs are purged, so a little more than asked may be released.
+    const size_t purged = chunks.purge(2 * PageHead::NORMAL_PAGE_SIZE, 0);
+    CHECK(purged >= 10 * PageHead::NORMAL_PAGE_SIZE);
+    CHECK_EQ(purged + chunks.purge(0, 0), 12 * PageHead::NORMAL_PAGE_SIZE);
+    CHECK_EQ(chunks.purge(0, 0), static_cast<size_t>(0));
+}
+
+TEST(registry_collect_dirty_cards)
+{
+    ChunkRegistry chunks(4 * PageHead::NORMAL_PAGE_SIZE, false);
+    CHECK(!chunks.is_init_failed());
+
+    std::vector<PageHead*> pages;
+    for (int i = 0; i < 8; i++)
+    {
+        PageHead* p = chunks.allocate_page();
+        CHECK(p != nullptr);
+        pages.push_back(p);
+    }
+    PageHead* huge = chunks.allocate_huge_page(3 * PageHead::NORMAL_PAGE_SIZE);
+    CHECK(huge != nullptr);
+
+    chunks.dirty_card(pages[1]);
+    chunks.dirty_card(pages[6]);
+    chunks.dirty_card(pages[6]);
+    chunks.dirty_card(huge);
+
+    // Cards of freed runs are dropped.
+    chunks.dirty_card(pages[3]);
+    chunks.free_page(pages[3]);
+
+    std::vector<PageHead*> dirty;
+    chunks.collect_dirty_cards(dirty);
+    CHECK_EQ(dirty.size(), static_cast<size_t>(3));
+    CHECK(std::find(dirty.begin(), dirty.end(), pages[1]) != dirty.end());
+    CHECK(std::find(dirty.begin(), dirty.end(), pages[6]) != dirty.end());
+    CHECK(std::find(dirty.begin(), dirty.end(), huge) != dirty.end());
+
+    // Collecting cleans the cards.
+    dirty.clear();
+    chunks.collect_dirty_cards(dirty);
+    CHECK(dirty.empty());
+
+    for (size_t i = 0; i < pages.size(); i++)
+        if (i != 3)
+            chunks.free_page(pages[i]);
+    chunks.free_page(huge);
+}
+
+TEST(registry_root_bitmap)
+{
+    ChunkRegistry chunks(4 * PageHead::NORMAL_PAGE_SIZE, false);
+    CHECK(!chunks.is_init_failed());
+
+    std::vector<PageHead*> pages;
+    for (int i = 0; i < 8; i++)
+    {
+        PageHead* p = chunks.allocate_page();
+        CHECK(p != nullptr);
+        pages.push_back(p);
+    }
+    PageHead* huge = chunks.allocate_huge_page(3 * PageHead::NORMAL_PAGE_SIZE);
+    CHECK(huge != nullptr);
+
+    CHECK(chunks.add_root(pages[2], 0));
+    CHECK(chunks.add_root(pages[2], 65));
+    CHECK(chunks.add_root(pages[2], 4000));
+    CHECK(!chunks.add_root(pages[2], 65));
+    CHECK(chunks.add_root(pages[7], 1));
+    CHECK(chunks.add_root(huge, 0));
+
+    std::vector<PageHead*> root_pages;
+    chunks.collect_root_pages(root_pages);
+    CHECK_EQ(root_pages.size(), static_cast<size_t>(3));
+    CHECK(std::find(root_pages.begin(), root_pages.end(), pages[2]) != root_pages.end());
+    CHECK(std::find(root_pages.begin(), root_pages.end(), pages[7]) != root_pages.end());
+    CHECK(std::find(root_pages.begin(), root_pages.end(), huge) != root_pages.end());
+
+    std::vector<size_t> granules;
+    mark_bitmap_for_each_set(
+        chunks.get_root_bitmap(pages[2]),
+        mark_bitmap_word_count(pages[2]),
+        [&](size_t granule) { granules.push_back(granule); });
+    CHECK_EQ(granules.size(), static_cast<size_t>(3));
+    CHECK_EQ(granules[0], static_cast<size_t>(0));
+    CHECK_EQ(granules[1], static_cast<size_t>(65));
+    CHECK_EQ(granules[2], static_cast<size_t>(4000));
+
+    // Removing the last root of a page drops it from the collected pages.
+    CHECK(chunks.remove_root(pages[7], 1));
+    CHECK(!chunks.remove_root(pages[7], 1));
+    CHECK(chunks.remove_root(huge, 0));
+    CHECK(chunks.remove_root(pages[2], 65));
+
+    root_pages.clear();
+    chunks.collect_root_pages(root_pages);
+    CHECK_EQ(root_pages.size(), static_cast<size_t>(1));
+    CHECK(root_pages[0] == pages[2]);
+
+    CHECK(chunks.remove_root(pages[2], 0));
+    CHECK(chunks.remove_root(pages[2], 4000));
+
+    root_pages.clear();
+    chunks.collect_root_pages(root_pages);
+    CHECK(root_pages.empty());
+
+    for (PageHead* p : pages)
+        chunks.free_page(p);
+    chunks.free_page(huge);
+}
+
+TEST(registry_published_pages)
+{
+    ChunkRegistry chunks(4 * PageHead::NORMAL_PAGE_SIZE, false);
+    CHECK(!chunks.is_init_failed());
+
+    std::vector<PageHead*> pages;
+    for (int i = 0; i < 10; i++)
+    {
+        PageHead* p = chunks.allocate_page();
+        CHECK(p != nullptr);
+        pages.push_back(p);
+    }
+    PageHead* huge = chunks.allocate_huge_page(3 * PageHead::NORMAL_PAGE_SIZE);
+    CHECK(huge != nullptr);
+
+    // Only published runs are collected, in address order.
+    for (size_t i = 0; i < pages.size(); i += 2)
+        chunks.publish_page(pages[i]);
+    chunks.publish_page(huge);
+
+    std::vector<PageHead*> published;
+    chunks.collect_published_pages(published);
+    CHECK_EQ(published.size(), static_cast<size_t>(6));
+    CHECK(std::is_sorted(published.begin(), published.end()));
+    CHECK(std::find(published.begin(), published.end(), huge) != published.end());
+    CHECK(std::find(published.begin(), published.end(), pages[1]) == published.end());
+
+    // Freeing unpublishes the run.
+    chunks.free_page(pages[4]);
+    chunks.free_page(huge);
+
+    published.clear();
+    chunks.collect_published_pages(published);
+    CHECK_EQ(published.size(), static_cast<size_t>(4));
+    CHECK(std::find(published.begin(), published.end(), pages[4]) == published.end());
+
+    for (size_t i = 0; i < pages.size(); i++)
+    {
+        if (i != 4)
+            chunks.free_page(pages[i]);
+    }
+
+    published.clear();
+    chunks.collect_published_pages(published);
+    CHECK(published.empty());
+}
+
+TEST(registry_numa_nodes)
+{
+    // Chunks are reserved without a node where the OS cannot bind them, the
+    // registry keeps them apart all the same.
+    ChunkRegistry chunks(4 * PageHead::NORMAL_PAGE_SIZE, false, 2);
+    CHECK(!chunks.is_init_failed());
+    CHECK_EQ(chunks.get_numa_node_count(), static_cast<size_t>(2));
+    CHECK_EQ(chunks.get_chunk_count(), static_cast<size_t>(2));
+
+    // Outgrows the initial chunk of node 1 only.
+    std::vector<PageHead*> pages;
+    for (int i = 0; i < 10; i++)
+    {
+        PageHead* p = chunks.allocate_page(1, 1);
+        CHECK(p != nullptr);
+        CHECK_EQ(chunks.get_numa_node(p), static_cast<size_t>(1));
+        chunks.publish_page(p);
+        pages.push_back(p);
+    }
+    PageHead* huge = chunks.allocate_huge_page(3 * PageHead::NORMAL_PAGE_SIZE, 0);
+    CHECK(huge != nullptr);
+    CHECK_EQ(chunks.get_numa_node(huge), static_cast<size_t>(0));
+    chunks.publish_page(huge);
+
+    std::vector<PageHead*> published;
+    chunks.collect_published_pages(published, 0);
+    CHECK_EQ(published.size(), static_cast<size_t>(1));
+    CHECK(published[0] == huge);
+
+    published.clear();
+    chunks.collect_published_pages(published, 1);
+    CHECK_EQ(published.size(), pages.size());
+
+    for (PageHead* p : pages)
+        chunks.free_page(p);
+    chunks.free_page(huge);
+}
+
+TEST(concurrent_registry_growth)
+{
+    ChunkRegistry chunks(PageHead::NORMAL_PAGE_SIZE, false);
+    CHECK(!chunks.is_init_failed());
+
+    constexpr int THREADS = 8;
+    constexpr int PAGES_PER_THREAD = 64;
+    std::atomic<int> errors{ 0 };
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; t++)
+    {
+        threads.emplace_back([&]()
+            {
+                std::vector<PageHead*> pages;
+                for (int i = 0; i < PAGES_PER_THREAD; i++)
+                {
+                    PageHead* p = chunks.allocate_page();
+                    if (p == nullptr || chunks.validate(p) != p)
+                        errors++;
+                    else
+                        pages.push_back(p);
+                }
+                for (PageHead* p : pages)
+                    chunks.free_page(p);
+            });
+    }
+    for (auto& th : threads)
+        th.join();
+
+    CHECK_EQ(errors.load(), 0);
+}
+
 TEST(concurrent_alloc_free_128_pages)
 {
     Chunk chunk(4 * 1024 * 1024);
@@ -474,18 +1020,35 @@ int test_chunk_main(void)
     RUN_TEST(huge_page_two_pages);
     RUN_TEST(huge_page_large_allocation);
     RUN_TEST(huge_page_exceeds_available);
+    RUN_TEST(span_of_several_pages);
     RUN_TEST(validate_nullptr_returns_null);
     RUN_TEST(validate_outside_range_returns_null);
     RUN_TEST(validate_exact_page_start);
     RUN_TEST(validate_interior_of_page);
     RUN_TEST(validate_freed_returns_null);
     RUN_TEST(validate_huge_page_interior);
+    RUN_TEST(validate_huge_page_every_page_then_reuse);
+    RUN_TEST(huge_page_resize_in_place);
     RUN_TEST(buddy_coalesce_all_to_max_order);
     RUN_TEST(buddy_coalesce_to_order_1);
     RUN_TEST(buddy_no_coalesce_when_still_allocated);
+    RUN_TEST(fragmented_runs_coalesce_through_both_neighbors);
+    RUN_TEST(free_runs_prefer_fitting_bin);
+    RUN_TEST(purge_idle_free_pages_and_reuse);
+    RUN_TEST(purge_keeps_retained_budget);
+    RUN_TEST(stats_free_runs_and_committed_size);
+    RUN_TEST(huge_page_backing_alignment);
     RUN_TEST(multi_chunk_isolation);
     RUN_TEST(alloc_free_alloc_cycle);
     RUN_TEST(huge_page_boundary_case);
+    RUN_TEST(registry_grows_when_chunk_exhausted);
+    RUN_TEST(registry_huge_page_larger_than_chunk);
+    RUN_TEST(registry_purge_shares_budget);
+    RUN_TEST(registry_collect_dirty_cards);
+    RUN_TEST(registry_root_bitmap);
+    RUN_TEST(registry_published_pages);
+    RUN_TEST(registry_numa_nodes);
+    RUN_TEST(concurrent_registry_growth);
     RUN_TEST(concurrent_alloc_free_128_pages);
     RUN_TEST(concurrent_mixed_alloc_free);
     RUN_TEST(concurrent_huge_page_and_validate);
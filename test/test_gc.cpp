@@ -0,0 +1,730 @@
+#include "woomem.h"
+#include "woomem_page_unit_alloc.hpp"
+#include "woomem_thread_context.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace woomem;
+
+static int g_failures = 0;
+
+#define TEST(name) static void test_##name()
+#define RUN_TEST(name) do { \
+    std::printf("  RUN  %s\n", #name); \
+    test_##name(); \
+    std::printf("  OK   %s\n", #name); \
+} while(0)
+#define CHECK(expr) do { \
+    if (!(expr)) { \
+        std::fprintf(stderr, "  FAIL %s:%d: %s\n", __FILE__, __LINE__, #expr); \
+        g_failures++; \
+        return; \
+    } \
+} while(0)
+#define CHECK_EQ(a, b) CHECK((a) == (b))
+
+static void on_gc() {}
+static void on_mark(void*) {}
+static void on_free(void*) {}
+static void on_entry() {}
+
+// Automatic cycles are pushed far away, tests trigger the cycles they need.
+static woomem_InitConfig test_config()
+{
+    woomem_InitConfig config = {};
+    config.reserved_chunk_size = 64 * 1024 * 1024;
+    config.gc_worker_count = 2;
+    config.gc_heap_growth_percent = 100000;
+    config.gc_callback_at_begin = on_gc;
+    config.gc_callback_at_stop_marking = on_gc;
+    config.mark_callback = on_mark;
+    config.free_callback = on_free;
+    config.main_entry_callback = on_entry;
+    config.worker_entry_callback = on_entry;
+    return config;
+}
+
+static size_t allocated_size_since_last_gc()
+{
+    woomem_Stats stats = {};
+    woomem_get_stats(&stats);
+    return stats.allocated_size_since_last_gc;
+}
+
+static void allocate_garbage(size_t size, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        woomem_allocate_end(woomem_allocate_begin(size), WOOMEM_ATTRIB_NEED_SWEEP);
+}
+
+TEST(allocated_size_published_at_threshold_and_thread_exit)
+{
+    constexpr size_t UNIT_SIZE = 1024;
+    constexpr size_t THRESHOLD_UNIT_COUNT =
+        ThreadContext::ALLOCATED_SIZE_PUBLISH_THRESHOLD / UNIT_SIZE;
+
+    const woomem_InitConfig config = test_config();
+    CHECK(woomem_init_with_config(&config));
+
+    size_t before = 0, below_threshold = 0, at_threshold = 0;
+    std::thread thread([&]()
+        {
+            before = allocated_size_since_last_gc();
+
+            allocate_garbage(UNIT_SIZE, THRESHOLD_UNIT_COUNT - 1);
+            below_threshold = allocated_size_since_last_gc();
+
+            allocate_garbage(UNIT_SIZE, 1);
+            at_threshold = allocated_size_since_last_gc();
+
+            // Left unpublished until the thread exits.
+            allocate_garbage(UNIT_SIZE, 1);
+        });
+    thread.join();
+    const size_t after_exit = allocated_size_since_last_gc();
+
+    woomem_shutdown();
+
+    CHECK_EQ(below_threshold, before);
+    CHECK_EQ(at_threshold, before + THRESHOLD_UNIT_COUNT * UNIT_SIZE);
+    CHECK_EQ(after_exit, at_threshold + UNIT_SIZE);
+}
+
+static std::atomic<void*> g_watched_units[2];
+static std::atomic<bool> g_watched_units_freed[2];
+static std::atomic<int> g_minor_cycle_count;
+
+static void on_free_watched(void* unit)
+{
+    for (size_t i = 0; i < 2; ++i)
+        if (g_watched_units[i].load() == unit)
+            g_watched_units_freed[i].store(true);
+}
+
+static void on_trace_count_minor(const woomem_TraceEvent* event)
+{
+    if (event->kind == WOOMEM_TRACE_CYCLE_BEGIN && event->value == 1)
+        ++g_minor_cycle_count;
+}
+
+static void run_full_cycle(bool minor)
+{
+    if (minor)
+        woomem_trigger_minor_gc(false);
+    else
+        woomem_trigger_gc(false);
+    woomem_wait_for_sweep();
+}
+
+TEST(minor_cycle_keeps_young_unit_of_dirty_old_unit)
+{
+    woomem_InitConfig config = test_config();
+    config.gc_generational = true;
+    config.free_callback = on_free_watched;
+    for (size_t i = 0; i < 2; ++i)
+    {
+        g_watched_units[i].store(nullptr);
+        g_watched_units_freed[i].store(false);
+    }
+    g_minor_cycle_count.store(0);
+    CHECK(woomem_set_trace(0, on_trace_count_minor));
+    CHECK(woomem_init_with_config(&config));
+
+    void** root = static_cast<void**>(woomem_allocate_begin(sizeof(void*)));
+    void** holder = static_cast<void**>(woomem_allocate_begin(sizeof(void*)));
+    *holder = nullptr;
+    *root = holder;
+    woomem_allocate_end(holder, WOOMEM_ATTRIB_NEED_SWEEP | WOOMEM_ATTRIB_AUTO_MARK);
+    woomem_allocate_end_as_root(root, WOOMEM_ATTRIB_AUTO_MARK);
+
+    // Survive major cycles until the holder is promoted.
+    for (int i = 0; i < 4; ++i)
+        run_full_cycle(false);
+    const bool holder_is_old = is_old_unit(reinterpret_cast<UnitHead*>(holder) - 1);
+    // Cleans the card dirtied by the promotion, the holder has no young child.
+    run_full_cycle(true);
+
+    // Only reachable through the old holder, whose card the barrier dirties.
+    int* young = static_cast<int*>(woomem_allocate_begin(sizeof(int)));
+    *young = 0x5a5a;
+    g_watched_units[0].store(young);
+    woomem_allocate_end(young, WOOMEM_ATTRIB_NEED_SWEEP | WOOMEM_ATTRIB_FREE_CALLBACK);
+    *holder = young;
+    woomem_write_barrier(holder, young);
+
+    void* garbage = woomem_allocate_begin(sizeof(int));
+    g_watched_units[1].store(garbage);
+    woomem_allocate_end(garbage, WOOMEM_ATTRIB_NEED_SWEEP | WOOMEM_ATTRIB_FREE_CALLBACK);
+
+    // Units allocated in the round being marked are kept, sweep them in the next one.
+    run_full_cycle(true);
+    run_full_cycle(true);
+
+    const int minor_cycle_count = g_minor_cycle_count.load();
+    const bool young_freed = g_watched_units_freed[0].load();
+    const bool garbage_freed = g_watched_units_freed[1].load();
+    const bool young_valid = woomem_validate_addr(young) != nullptr && *young == 0x5a5a;
+
+    woomem_shutdown();
+    (void)woomem_set_trace(0, nullptr);
+
+    CHECK(holder_is_old);
+    CHECK_EQ(minor_cycle_count, 3);
+    CHECK(!young_freed);
+    CHECK(young_valid);
+    CHECK(garbage_freed);
+}
+
+static std::atomic<void*> g_blocking_unit;
+static std::atomic<bool> g_blocking_unit_reached;
+static std::atomic<bool> g_blocking_unit_released;
+
+// Holds marking in the mark callback of `g_blocking_unit`, at most 10 seconds.
+static void on_mark_block(void* unit)
+{
+    if (unit != g_blocking_unit.load())
+        return;
+
+    g_blocking_unit_reached.store(true);
+    for (int i = 0; i < 10000 && !g_blocking_unit_released.load(); ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+TEST(write_barrier_shades_unit_stored_into_scanned_holder)
+{
+    woomem_InitConfig config = test_config();
+    // A single worker scans the holder completely before the blocking unit.
+    config.gc_worker_count = 1;
+    config.mark_callback = on_mark_block;
+    config.free_callback = on_free_watched;
+    g_watched_units[0].store(nullptr);
+    g_watched_units_freed[0].store(false);
+    g_blocking_unit_reached.store(false);
+    g_blocking_unit_released.store(false);
+    CHECK(woomem_init_with_config(&config));
+
+    // root -> holder -> [blocking, young], the young unit is stored into the
+    // holder only after the holder was scanned.
+    void** root = static_cast<void**>(woomem_allocate_begin(sizeof(void*)));
+    void** holder = static_cast<void**>(woomem_allocate_begin(2 * sizeof(void*)));
+    void* blocking = woomem_allocate_begin(sizeof(void*));
+    int* young = static_cast<int*>(woomem_allocate_begin(sizeof(int)));
+    *young = 0x5a5a;
+    holder[0] = blocking;
+    holder[1] = nullptr;
+    *root = holder;
+    g_blocking_unit.store(blocking);
+    g_watched_units[0].store(young);
+    woomem_allocate_end(young, WOOMEM_ATTRIB_NEED_SWEEP | WOOMEM_ATTRIB_FREE_CALLBACK);
+    woomem_allocate_end(blocking, WOOMEM_ATTRIB_NEED_SWEEP | WOOMEM_ATTRIB_MARK_CALLBACK);
+    woomem_allocate_end(holder, WOOMEM_ATTRIB_NEED_SWEEP | WOOMEM_ATTRIB_AUTO_MARK);
+    woomem_allocate_end_as_root(root, WOOMEM_ATTRIB_AUTO_MARK);
+
+    std::thread mutator([&]()
+        {
+            while (!g_blocking_unit_reached.load())
+                std::this_thread::yield();
+
+            // The stop marking callback re-marks nothing, only the barrier
+            // keeps the young unit alive.
+            holder[1] = young;
+            woomem_write_barrier(holder, young);
+            g_blocking_unit_released.store(true);
+        });
+
+    woomem_trigger_gc(false);
+    woomem_wait_for_sweep();
+    mutator.join();
+
+    const bool young_freed = g_watched_units_freed[0].load();
+    const bool young_valid = woomem_validate_addr(young) != nullptr && *young == 0x5a5a;
+
+    woomem_shutdown();
+
+    CHECK(!young_freed);
+    CHECK(young_valid);
+}
+
+TEST(wait_for_sweep_returns_after_the_sweep)
+{
+    const woomem_InitConfig config = test_config();
+    CHECK(woomem_init_with_config(&config));
+
+    woomem_Stats before = {};
+    woomem_get_stats(&before);
+
+    woomem_trigger_gc(false);
+    woomem_wait_for_sweep();
+
+    woomem_Stats after = {};
+    woomem_get_stats(&after);
+
+    woomem_shutdown();
+
+    CHECK(after.gc_cycle_count > before.gc_cycle_count);
+    CHECK(after.gc_swept_cycle_count >= after.gc_cycle_count);
+    CHECK(after.gc_phase_total_ns[WOOMEM_GC_PHASE_SWEEP]
+        > before.gc_phase_total_ns[WOOMEM_GC_PHASE_SWEEP]);
+}
+
+static std::atomic<size_t> g_freed_unit_count;
+
+static void on_free_count(void*)
+{
+    ++g_freed_unit_count;
+}
+
+static size_t assisted_unit_count()
+{
+    woomem_GCWorkerStats workers[8] = {};
+    woomem_Stats stats = {};
+    stats.gc_workers = workers;
+    stats.gc_worker_capacity = 8;
+    woomem_get_stats(&stats);
+
+    size_t count = 0;
+    for (size_t i = 0; i < stats.gc_worker_count && i < 8; ++i)
+        count += workers[i].assisted_unit_count;
+    return count;
+}
+
+TEST(mutator_assists_marking_beyond_allowance)
+{
+    constexpr size_t CHILD_COUNT = 128 * 1024;
+
+    woomem_InitConfig config = test_config();
+    config.gc_mutator_assist = true;
+    config.free_callback = on_free_count;
+    g_freed_unit_count.store(0);
+    CHECK(woomem_init_with_config(&config));
+
+    // A wide graph, the children of the root wait in the deques of the
+    // workers long enough to be stolen.
+    size_t** root = static_cast<size_t**>(woomem_allocate_begin(CHILD_COUNT * sizeof(size_t*)));
+    for (size_t i = 0; i < CHILD_COUNT; ++i)
+    {
+        root[i] = static_cast<size_t*>(woomem_allocate_begin(sizeof(size_t)));
+        *root[i] = i;
+        woomem_allocate_end(root[i], WOOMEM_ATTRIB_NEED_SWEEP | WOOMEM_ATTRIB_FREE_CALLBACK);
+    }
+    woomem_allocate_end_as_root(root, WOOMEM_ATTRIB_AUTO_MARK);
+
+    // The allowance of a cycle is at least 256 KiB, the allocating thread goes
+    // over it while marking is running.
+    std::atomic<bool> stop{ false };
+    std::thread mutator([&]()
+        {
+            while (!stop.load())
+                allocate_garbage(1024, 64);
+        });
+
+    size_t assisted = 0;
+    for (int i = 0; i < 20 && assisted == 0; ++i)
+    {
+        woomem_trigger_gc(false);
+        woomem_wait_for_sweep();
+        assisted = assisted_unit_count();
+    }
+    stop.store(true);
+    mutator.join();
+
+    woomem_trigger_gc(false);
+    woomem_wait_for_sweep();
+
+    size_t intact_count = 0;
+    for (size_t i = 0; i < CHILD_COUNT; ++i)
+        if (woomem_validate_addr(root[i]) != nullptr && *root[i] == i)
+            ++intact_count;
+    const size_t freed_count = g_freed_unit_count.load();
+
+    woomem_shutdown();
+
+    CHECK(assisted > 0);
+    CHECK_EQ(intact_count, CHILD_COUNT);
+    CHECK_EQ(freed_count, static_cast<size_t>(0));
+}
+
+TEST(bulk_allocated_units_freed_once_unreachable)
+{
+    constexpr size_t ROOTED_COUNT = 1000;
+    constexpr size_t GARBAGE_COUNT = 500;
+    constexpr int ATTRIB = WOOMEM_ATTRIB_NEED_SWEEP | WOOMEM_ATTRIB_FREE_CALLBACK;
+
+    woomem_InitConfig config = test_config();
+    config.free_callback = on_free_count;
+    g_freed_unit_count.store(0);
+    CHECK(woomem_init_with_config(&config));
+
+    size_t** root = static_cast<size_t**>(woomem_allocate_begin(ROOTED_COUNT * sizeof(size_t*)));
+    const size_t rooted_count = woomem_allocate_bulk(
+        sizeof(size_t), ROOTED_COUNT, reinterpret_cast<void**>(root));
+    for (size_t i = 0; i < rooted_count; ++i)
+        *root[i] = i;
+    woomem_allocate_end_bulk(reinterpret_cast<void* const*>(root), rooted_count, ATTRIB);
+    woomem_allocate_end_as_root(root, WOOMEM_ATTRIB_AUTO_MARK);
+
+    void* garbage[GARBAGE_COUNT];
+    const size_t garbage_count = woomem_allocate_bulk(sizeof(size_t), GARBAGE_COUNT, garbage);
+    woomem_allocate_end_bulk(garbage, garbage_count, ATTRIB);
+
+    woomem_trigger_gc(false);
+    woomem_wait_for_sweep();
+
+    const size_t freed_while_rooted = g_freed_unit_count.load();
+    size_t intact_count = 0;
+    for (size_t i = 0; i < rooted_count; ++i)
+        if (woomem_validate_addr(root[i]) != nullptr && *root[i] == i)
+            ++intact_count;
+
+    woomem_remove_from_root_set(root);
+    woomem_trigger_gc(false);
+    woomem_wait_for_sweep();
+
+    const size_t freed_after_unrooted = g_freed_unit_count.load();
+
+    woomem_shutdown();
+
+    CHECK_EQ(rooted_count, ROOTED_COUNT);
+    CHECK_EQ(garbage_count, GARBAGE_COUNT);
+    CHECK_EQ(freed_while_rooted, GARBAGE_COUNT);
+    CHECK_EQ(intact_count, ROOTED_COUNT);
+    CHECK_EQ(freed_after_unrooted, GARBAGE_COUNT + ROOTED_COUNT);
+}
+
+static std::mutex g_freed_units_mx;
+static std::vector<void*> g_freed_units;
+
+static void on_free_record(void* unit)
+{
+    std::lock_guard g(g_freed_units_mx);
+    g_freed_units.push_back(unit);
+}
+
+TEST(span_units_swept_by_mark_bitmap)
+{
+    // A single page span and a multi-page one, several units in each span.
+    constexpr size_t UNIT_SIZES[] = { 48, 6000 };
+    constexpr size_t SPANS_PER_SIZE = 3;
+    constexpr int ATTRIB = WOOMEM_ATTRIB_NEED_SWEEP | WOOMEM_ATTRIB_FREE_CALLBACK;
+
+    woomem_InitConfig config = test_config();
+    config.free_callback = on_free_record;
+    g_freed_units.clear();
+    CHECK(woomem_init_with_config(&config));
+
+    std::vector<void*> rooted, unrooted;
+    size_t unrooted_counts[2] = {};
+    bool has_multi_page_span = false;
+    for (size_t size_idx = 0; size_idx < 2; ++size_idx)
+    {
+        const size_t unit_size = UNIT_SIZES[size_idx];
+        std::vector<PageHead*> pages;
+        for (size_t i = 0; pages.size() <= SPANS_PER_SIZE; ++i)
+        {
+            void* const unit = woomem_allocate_begin(unit_size);
+            PageHead* const page = get_page_of_unit(reinterpret_cast<UnitHead*>(unit) - 1);
+            if (std::find(pages.begin(), pages.end(), page) == pages.end())
+                pages.push_back(page);
+            has_multi_page_span |= page->m_span_page_count > 1;
+
+            // Every third unit is rooted, the others are garbage.
+            if (i % 3 == 0)
+            {
+                woomem_allocate_end_as_root(unit, ATTRIB);
+                rooted.push_back(unit);
+            }
+            else
+            {
+                woomem_allocate_end(unit, ATTRIB);
+                unrooted.push_back(unit);
+                ++unrooted_counts[size_idx];
+            }
+        }
+    }
+
+    woomem_trigger_gc(false);
+    woomem_wait_for_sweep();
+
+    std::vector<void*> freed;
+    do
+    {
+        std::lock_guard g(g_freed_units_mx);
+        freed.swap(g_freed_units);
+    } while (0);
+    std::sort(freed.begin(), freed.end());
+    std::sort(unrooted.begin(), unrooted.end());
+
+    size_t intact_rooted_count = 0;
+    for (void* const unit : rooted)
+        if (woomem_validate_addr(unit) == unit)
+            ++intact_rooted_count;
+
+    // The freed units are handed out again, after the rest of the page the
+    // thread is allocating from.
+    size_t reused_count = 0;
+    for (size_t size_idx = 0; size_idx < 2; ++size_idx)
+    {
+        for (size_t i = 0; i < 2 * unrooted_counts[size_idx]; ++i)
+        {
+            void* const unit = woomem_allocate_begin(UNIT_SIZES[size_idx]);
+            woomem_allocate_end(unit, WOOMEM_ATTRIB_NEED_SWEEP);
+            if (std::binary_search(freed.begin(), freed.end(), unit))
+                ++reused_count;
+        }
+    }
+
+    woomem_shutdown();
+
+    CHECK(has_multi_page_span);
+    CHECK(freed == unrooted);
+    CHECK_EQ(intact_rooted_count, rooted.size());
+    CHECK_EQ(reused_count, unrooted.size());
+}
+
+static void fill_pattern(void* unit, size_t size)
+{
+    unsigned char* const bytes = static_cast<unsigned char*>(unit);
+    for (size_t i = 0; i < size; ++i)
+        bytes[i] = static_cast<unsigned char>(i * 131 + 7);
+}
+
+static bool has_pattern(const void* unit, size_t size)
+{
+    const unsigned char* const bytes = static_cast<const unsigned char*>(unit);
+    for (size_t i = 0; i < size; ++i)
+        if (bytes[i] != static_cast<unsigned char>(i * 131 + 7))
+            return false;
+    return true;
+}
+
+// Above MAX_IN_PAGE_UNIT_SIZE, below the size moved by remapping.
+static constexpr size_t SMALL_HUGE_SIZE = 300 * 1024;
+// Moved by remapping all but its first page.
+static constexpr size_t LARGE_HUGE_SIZE = 2 * 1024 * 1024;
+
+TEST(reallocate_resizes_huge_unit_in_place)
+{
+    const woomem_InitConfig config = test_config();
+    CHECK(woomem_init_with_config(&config));
+
+    void* unit = woomem_allocate_begin(SMALL_HUGE_SIZE);
+    fill_pattern(unit, SMALL_HUGE_SIZE);
+    woomem_allocate_end(unit, WOOMEM_ATTRIB_NEED_SWEEP);
+
+    void* const grown = woomem_reallocate(unit, 2 * SMALL_HUGE_SIZE);
+    const bool grown_intact = has_pattern(grown, SMALL_HUGE_SIZE);
+    fill_pattern(grown, 2 * SMALL_HUGE_SIZE);
+
+    void* const shrunk = woomem_reallocate(grown, SMALL_HUGE_SIZE / 2);
+    const bool shrunk_intact = has_pattern(shrunk, SMALL_HUGE_SIZE / 2);
+    // The tail pages went back to the chunk.
+    void* const tail = static_cast<char*>(shrunk) + SMALL_HUGE_SIZE;
+    const bool tail_released = woomem_validate_addr(tail) == nullptr;
+
+    woomem_shutdown();
+
+    CHECK(grown == unit);
+    CHECK(grown_intact);
+    CHECK(shrunk == unit);
+    CHECK(shrunk_intact);
+    CHECK(tail_released);
+}
+
+TEST(reallocate_remaps_large_huge_unit)
+{
+    woomem_InitConfig config = test_config();
+    config.free_callback = on_free_record;
+    g_freed_units.clear();
+    CHECK(woomem_init_with_config(&config));
+
+    void* unit = woomem_allocate_begin(LARGE_HUGE_SIZE);
+    fill_pattern(unit, LARGE_HUGE_SIZE);
+    woomem_allocate_end(unit, WOOMEM_ATTRIB_NEED_SWEEP | WOOMEM_ATTRIB_FREE_CALLBACK);
+    // Right after the unit, it cannot grow in place.
+    void* const blocker = woomem_allocate_begin(SMALL_HUGE_SIZE);
+    woomem_allocate_end_as_root(blocker, WOOMEM_ATTRIB_NEED_SWEEP);
+
+    void* const moved = woomem_reallocate(unit, 2 * LARGE_HUGE_SIZE);
+    const bool moved_intact = has_pattern(moved, LARGE_HUGE_SIZE);
+    const bool old_released = woomem_validate_addr(unit) == nullptr;
+
+    const bool freed_without_callback = g_freed_units.empty();
+
+    woomem_shutdown();
+
+    CHECK(moved != unit);
+    CHECK(moved_intact);
+    CHECK(old_released);
+    CHECK(freed_without_callback);
+}
+
+TEST(reallocate_keeps_root_huge_unit)
+{
+    const woomem_InitConfig config = test_config();
+    CHECK(woomem_init_with_config(&config));
+
+    void* root = woomem_allocate_begin(LARGE_HUGE_SIZE);
+    fill_pattern(root, LARGE_HUGE_SIZE);
+    woomem_allocate_end_as_root(root, WOOMEM_ATTRIB_NEED_SWEEP);
+    void* const blocker = woomem_allocate_begin(SMALL_HUGE_SIZE);
+    woomem_allocate_end_as_root(blocker, WOOMEM_ATTRIB_NEED_SWEEP);
+
+    // The root is not released, its pages must not be moved away either.
+    void* const moved = woomem_reallocate(root, 2 * LARGE_HUGE_SIZE);
+    const bool moved_intact = has_pattern(moved, LARGE_HUGE_SIZE);
+    const bool root_valid = woomem_validate_addr(root) == root;
+    const bool root_intact = has_pattern(root, LARGE_HUGE_SIZE);
+
+    woomem_shutdown();
+
+    CHECK(moved != root);
+    CHECK(moved_intact);
+    CHECK(root_valid);
+    CHECK(root_intact);
+}
+
+TEST(reallocate_moves_units_while_marking)
+{
+    woomem_InitConfig config = test_config();
+    config.gc_worker_count = 1;
+    config.mark_callback = on_mark_block;
+    config.free_callback = on_free_record;
+    g_freed_units.clear();
+    g_blocking_unit_reached.store(false);
+    g_blocking_unit_released.store(false);
+    CHECK(woomem_init_with_config(&config));
+
+    constexpr int ATTRIB = WOOMEM_ATTRIB_NEED_SWEEP | WOOMEM_ATTRIB_FREE_CALLBACK;
+    void* const small = woomem_allocate_begin(64);
+    void* const to_shrink = woomem_allocate_begin(SMALL_HUGE_SIZE);
+    void* const to_grow = woomem_allocate_begin(LARGE_HUGE_SIZE);
+    fill_pattern(small, 64);
+    fill_pattern(to_shrink, SMALL_HUGE_SIZE);
+    fill_pattern(to_grow, LARGE_HUGE_SIZE);
+    woomem_allocate_end(small, ATTRIB);
+    woomem_allocate_end(to_shrink, ATTRIB);
+    woomem_allocate_end(to_grow, ATTRIB);
+
+    void** root = static_cast<void**>(woomem_allocate_begin(sizeof(void*)));
+    void* blocking = woomem_allocate_begin(sizeof(void*));
+    *root = blocking;
+    g_blocking_unit.store(blocking);
+    woomem_allocate_end(blocking, WOOMEM_ATTRIB_NEED_SWEEP | WOOMEM_ATTRIB_MARK_CALLBACK);
+    woomem_allocate_end_as_root(root, WOOMEM_ATTRIB_AUTO_MARK);
+
+    void* small_moved = nullptr;
+    void* shrunk = nullptr;
+    void* grown = nullptr;
+    bool old_units_valid = false;
+    std::thread mutator([&]()
+        {
+            while (!g_blocking_unit_reached.load())
+                std::this_thread::yield();
+
+            small_moved = woomem_reallocate(small, 128);
+            shrunk = woomem_reallocate(to_shrink, SMALL_HUGE_SIZE / 2);
+            grown = woomem_reallocate(to_grow, 2 * LARGE_HUGE_SIZE);
+
+            // Left to the sweep of this cycle.
+            old_units_valid = woomem_validate_addr(small) == small
+                && woomem_validate_addr(to_shrink) == to_shrink
+                && woomem_validate_addr(to_grow) == to_grow;
+            g_blocking_unit_released.store(true);
+        });
+
+    woomem_trigger_gc(false);
+    woomem_wait_for_sweep();
+    mutator.join();
+
+    std::vector<void*> freed;
+    do
+    {
+        std::lock_guard g(g_freed_units_mx);
+        freed.swap(g_freed_units);
+    } while (0);
+    std::sort(freed.begin(), freed.end());
+    std::vector<void*> old_units = { small, to_shrink, to_grow };
+    std::sort(old_units.begin(), old_units.end());
+
+    const bool moved_intact = has_pattern(small_moved, 64)
+        && has_pattern(shrunk, SMALL_HUGE_SIZE / 2)
+        && has_pattern(grown, LARGE_HUGE_SIZE);
+
+    woomem_shutdown();
+
+    CHECK(small_moved != small);
+    CHECK(shrunk != to_shrink);
+    CHECK(grown != to_grow);
+    CHECK(old_units_valid);
+    CHECK(moved_intact);
+    CHECK(freed == old_units);
+}
+
+static size_t committed_size()
+{
+    woomem_Stats stats = {};
+    woomem_get_stats(&stats);
+    return stats.committed_size;
+}
+
+TEST(idle_free_pages_purged_without_cycles)
+{
+    constexpr size_t GARBAGE_SIZE = 4 * 1024 * 1024;
+
+    const woomem_InitConfig config = test_config();
+    CHECK(woomem_init_with_config(&config));
+    woomem_set_purge_policy(0, 2);
+
+    allocate_garbage(GARBAGE_SIZE, 1);
+
+    // Freed by the sweep, too recently for the purge after it.
+    woomem_trigger_gc(false);
+    woomem_wait_for_sweep();
+
+    woomem_Stats stats = {};
+    woomem_get_stats(&stats);
+    const size_t swept_cycle_count = stats.gc_swept_cycle_count;
+    const size_t committed_after_sweep = stats.committed_size;
+
+    size_t committed_when_idle = committed_after_sweep;
+    for (int i = 0; i < 100 && committed_after_sweep - committed_when_idle < GARBAGE_SIZE; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        committed_when_idle = committed_size();
+    }
+    woomem_get_stats(&stats);
+
+    woomem_shutdown();
+
+    CHECK(committed_after_sweep >= GARBAGE_SIZE);
+    CHECK(committed_after_sweep - committed_when_idle >= GARBAGE_SIZE);
+    CHECK_EQ(stats.gc_swept_cycle_count, swept_cycle_count);
+}
+
+int test_gc_main(void)
+{
+    std::printf("=== GC Tests ===\n\n");
+
+    RUN_TEST(allocated_size_published_at_threshold_and_thread_exit);
+    RUN_TEST(minor_cycle_keeps_young_unit_of_dirty_old_unit);
+    RUN_TEST(write_barrier_shades_unit_stored_into_scanned_holder);
+    RUN_TEST(wait_for_sweep_returns_after_the_sweep);
+    RUN_TEST(mutator_assists_marking_beyond_allowance);
+    RUN_TEST(bulk_allocated_units_freed_once_unreachable);
+    RUN_TEST(span_units_swept_by_mark_bitmap);
+    RUN_TEST(reallocate_resizes_huge_unit_in_place);
+    RUN_TEST(reallocate_remaps_large_huge_unit);
+    RUN_TEST(reallocate_keeps_root_huge_unit);
+    RUN_TEST(reallocate_moves_units_while_marking);
+    RUN_TEST(idle_free_pages_purged_without_cycles);
+
+    std::printf("\n=== %d failures ===\n", g_failures);
+    return g_failures > 0 ? 1 : 0;
+}
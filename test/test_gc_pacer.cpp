@@ -0,0 +1,124 @@
+#include "woomem.h"
+#include "woomem_gc_pacer.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+
+using namespace woomem;
+
+static int g_failures = 0;
+
+#define TEST(name) static void test_##name()
+#define RUN_TEST(name) do { \
+    std::printf("  RUN  %s\n", #name); \
+    test_##name(); \
+    std::printf("  OK   %s\n", #name); \
+} while(0)
+#define CHECK(expr) do { \
+    if (!(expr)) { \
+        std::fprintf(stderr, "  FAIL %s:%d: %s\n", __FILE__, __LINE__, #expr); \
+        g_failures++; \
+        return; \
+    } \
+} while(0)
+#define CHECK_EQ(a, b) CHECK((a) == (b))
+
+static constexpr size_t MB = 1024 * 1024;
+
+TEST(default_growth_of_alive_size)
+{
+    std::unique_ptr<GCPacer> pacer(new GCPacer());
+
+    // Small heaps are paced as if MIN_ALIVE_EDGE were alive.
+    CHECK_EQ(pacer->get_budget_size(),
+        GCPacer::MIN_ALIVE_EDGE * GCPacer::DEFAULT_HEAP_GROWTH_PERCENT / 100);
+    CHECK_EQ(pacer->get_trigger_size(), pacer->get_budget_size());
+
+    pacer->end_cycle(100 * MB, 0, 0, 1, 0, 1);
+    CHECK_EQ(pacer->get_budget_size(), 33 * MB);
+    CHECK_EQ(pacer->get_trigger_size(), 33 * MB);
+
+    pacer->set_policy(100, 0, 0);
+    CHECK_EQ(pacer->get_budget_size(), 100 * MB);
+    // Without a runway, mutators still get MIN_BUDGET before assisting.
+    CHECK_EQ(pacer->get_cycle_allowance_size(), GCPacer::MIN_BUDGET);
+
+    // 0 restores the default.
+    pacer->set_policy(0, 0, 0);
+    CHECK_EQ(pacer->get_budget_size(), 33 * MB);
+}
+
+TEST(trigger_leaves_runway_for_marking)
+{
+    std::unique_ptr<GCPacer> pacer(new GCPacer());
+    pacer->set_policy(50, 0, 0);
+
+    pacer->end_cycle(100 * MB, 8 * MB, 0, 1, 0, 1);
+    CHECK_EQ(pacer->get_budget_size(), 50 * MB);
+    CHECK_EQ(pacer->get_trigger_size(), 46 * MB);
+
+    pacer->end_cycle(100 * MB, 8 * MB, 0, 1, 0, 1);
+    CHECK_EQ(pacer->get_trigger_size(), 44 * MB);
+    CHECK_EQ(pacer->get_cycle_allowance_size(), 6 * MB);
+    CHECK_EQ(pacer->get_assist_scan_ratio(), static_cast<size_t>(17));
+
+    // Never closer to the last cycle than a quarter of the budget.
+    pacer->end_cycle(100 * MB, 200 * MB, 0, 1, 0, 1);
+    CHECK_EQ(pacer->get_trigger_size(), pacer->get_budget_size() / 4);
+}
+
+TEST(soft_memory_limit_caps_budget)
+{
+    std::unique_ptr<GCPacer> pacer(new GCPacer());
+    pacer->set_policy(100, 120 * MB, 0);
+
+    pacer->end_cycle(100 * MB, 0, 0, 1, 0, 1);
+    CHECK_EQ(pacer->get_budget_size(), 20 * MB);
+
+    pacer->end_cycle(130 * MB, 0, 0, 1, 0, 1);
+    CHECK_EQ(pacer->get_budget_size(), GCPacer::MIN_BUDGET);
+
+    // Below the limit, growth is the only bound.
+    pacer->set_policy(10, 120 * MB, 0);
+    pacer->end_cycle(100 * MB, 0, 0, 1, 0, 1);
+    CHECK_EQ(pacer->get_budget_size(), 10 * MB);
+}
+
+TEST(cpu_target_stretches_budget)
+{
+    std::unique_ptr<GCPacer> pacer(new GCPacer());
+    pacer->set_policy(10, 0, 10);
+
+    // Busy for 40% of a single CPU, averaged to 20%: twice the target.
+    pacer->end_cycle(100 * MB, 0, 40, 1, 100, 1);
+    CHECK(pacer->get_budget_size() >= 20 * MB - 1
+        && pacer->get_budget_size() <= 20 * MB + 1);
+
+    // Below the target nothing changes.
+    std::unique_ptr<GCPacer> idle(new GCPacer());
+    idle->set_policy(10, 0, 10);
+    idle->end_cycle(100 * MB, 0, 1, 4, 100, 8);
+    CHECK_EQ(idle->get_budget_size(), 10 * MB);
+
+    // Stretched at most MAX_CPU_STRETCH times, and still under the limit.
+    for (int i = 0; i < 8; ++i)
+        pacer->end_cycle(100 * MB, 0, 100, 1, 100, 1);
+    CHECK_EQ(pacer->get_budget_size(), 10 * MB * GCPacer::MAX_CPU_STRETCH);
+
+    pacer->set_policy(10, 115 * MB, 10);
+    CHECK_EQ(pacer->get_budget_size(), 15 * MB);
+}
+
+int test_gc_pacer_main(void)
+{
+    std::printf("=== GC Pacer Tests ===\n\n");
+
+    RUN_TEST(default_growth_of_alive_size);
+    RUN_TEST(trigger_leaves_runway_for_marking);
+    RUN_TEST(soft_memory_limit_caps_budget);
+    RUN_TEST(cpu_target_stretches_budget);
+
+    std::printf("\n=== %d failures ===\n", g_failures);
+    return g_failures > 0 ? 1 : 0;
+}
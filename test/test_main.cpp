@@ -2,10 +2,34 @@
 
 extern int test_chunk_main(void);
 extern int test_chunk_parallel_main(void);
+extern int test_work_stealing_deque_main(void);
+extern int test_type_layout_main(void);
+extern int test_gc_pacer_main(void);
+extern int test_size_class_main(void);
+extern int test_trace_main(void);
+extern int test_gc_main(void);
 
 int main(void){
     int result = test_chunk_main();
     if (result != 0)
         return result;
-    return test_chunk_parallel_main();
+    result = test_chunk_parallel_main();
+    if (result != 0)
+        return result;
+    result = test_work_stealing_deque_main();
+    if (result != 0)
+        return result;
+    result = test_type_layout_main();
+    if (result != 0)
+        return result;
+    result = test_gc_pacer_main();
+    if (result != 0)
+        return result;
+    result = test_size_class_main();
+    if (result != 0)
+        return result;
+    result = test_trace_main();
+    if (result != 0)
+        return result;
+    return test_gc_main();
 }
@@ -0,0 +1,174 @@
+#include "woomem.h"
+#include "woomem_page_unit_alloc.hpp"
+#include "woomem_chunk.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+using namespace woomem;
+
+static int g_failures = 0;
+
+#define TEST(name) static void test_##name()
+#define RUN_TEST(name) do { \
+    std::printf("  RUN  %s\n", #name); \
+    test_##name(); \
+    std::printf("  OK   %s\n", #name); \
+} while(0)
+#define CHECK(expr) do { \
+    if (!(expr)) { \
+        std::fprintf(stderr, "  FAIL %s:%d: %s\n", __FILE__, __LINE__, #expr); \
+        g_failures++; \
+        return; \
+    } \
+} while(0)
+#define CHECK_EQ(a, b) CHECK((a) == (b))
+
+TEST(classes_ascend_and_fit_their_spans)
+{
+    CHECK(MAX_GROUP > 1);
+    CHECK_EQ(GROUP_SIZE_LOOKUP_TABLE[0], SIZE_CLASS_TABLE.MIN_UNIT_SIZE);
+    CHECK_EQ(GROUP_SIZE_LOOKUP_TABLE[MAX_GROUP - 1], MAX_IN_PAGE_UNIT_SIZE);
+
+    for (size_t group = 0; group < MAX_GROUP; ++group)
+    {
+        const size_t unit_size = GROUP_SIZE_LOOKUP_TABLE[group];
+        const size_t span_page_count = GROUP_SPAN_PAGE_COUNT_LOOKUP_TABLE[group];
+
+        CHECK_EQ(unit_size % UNIT_GRANULE_SIZE, static_cast<size_t>(0));
+        CHECK(group == 0 || unit_size > GROUP_SIZE_LOOKUP_TABLE[group - 1]);
+        CHECK(span_page_count >= 1 && span_page_count <= MAX_SPAN_PAGE_COUNT);
+
+        // The tail of the span is moved into the units.
+        const size_t available = get_span_available_size(span_page_count);
+        const size_t unit_count = available / (unit_size + sizeof(UnitHead));
+        CHECK(unit_count >= 1);
+        CHECK(available - unit_count * (unit_size + sizeof(UnitHead))
+            < unit_count * UNIT_GRANULE_SIZE + UNIT_GRANULE_SIZE);
+    }
+}
+
+TEST(classes_are_spaced_by_steps)
+{
+    for (size_t group = 1; group < MAX_GROUP; ++group)
+    {
+        const size_t prev_size = GROUP_SIZE_LOOKUP_TABLE[group - 1];
+        const size_t unit_size = GROUP_SIZE_LOOKUP_TABLE[group];
+
+        // Below this, classes are a granule apart.
+        if (prev_size < UNIT_GRANULE_SIZE * 2 * WOOMEM_SIZE_CLASS_STEPS)
+        {
+            CHECK_EQ(unit_size - prev_size, UNIT_GRANULE_SIZE);
+            continue;
+        }
+
+        // Spans of classes this large hold too few units to follow the steps.
+        if (get_span_available_size(MAX_SPAN_PAGE_COUNT) / (unit_size + sizeof(UnitHead))
+            < WOOMEM_SIZE_CLASS_STEPS)
+            break;
+
+        // Fitting a class to its span raises it by at most about one step.
+        CHECK((unit_size - prev_size) * WOOMEM_SIZE_CLASS_STEPS <= 2 * prev_size);
+    }
+}
+
+TEST(eval_group_picks_smallest_fitting_class)
+{
+    for (size_t size = 0; size <= MAX_IN_PAGE_UNIT_SIZE; ++size)
+    {
+        const UnitAllocGroup group = eval_group_by_small_unit_size(size);
+
+        CHECK(group < MAX_GROUP);
+        CHECK(GROUP_SIZE_LOOKUP_TABLE[group] >= size);
+        CHECK(group == 0 || GROUP_SIZE_LOOKUP_TABLE[group - 1] < size);
+    }
+}
+
+TEST(span_offsets_fit_in_granules)
+{
+    for (size_t pages = 1; pages <= MAX_SPAN_PAGE_COUNT; ++pages)
+    {
+        CHECK(get_span_end_granule(pages) < UINT16_MAX);
+        CHECK_EQ(get_span_end_granule(pages) * UNIT_GRANULE_SIZE,
+            pages * PageHead::NORMAL_PAGE_SIZE - sizeof(PageHead));
+    }
+    CHECK(MAX_IN_PAGE_UNIT_SIZE / UNIT_GRANULE_SIZE <= UINT16_MAX);
+}
+
+// Sets the span up like `init_page_for_unit_allocating`, without publishing it.
+static void prepare_unit_page(PageHead* page, UnitAllocGroup group)
+{
+    PageUnitAlloc* const page_alloc_head = reinterpret_cast<PageUnitAlloc*>(page + 1);
+
+    page_alloc_head->m_run_out.store(0, std::memory_order_relaxed);
+    page_alloc_head->m_mark_as_run_out_in_global_pool = false;
+    page_alloc_head->m_freed_unit_granule.store(0, std::memory_order_relaxed);
+    page_alloc_head->m_next_allocate_unit_granule = 0;
+    page_alloc_head->m_unit_granules_in_page =
+        static_cast<uint16_t>(GROUP_SIZE_LOOKUP_TABLE[group] / UNIT_GRANULE_SIZE);
+
+    page->m_unit_high_water_granule.store(
+        static_cast<uint16_t>(sizeof(PageUnitAlloc) / UNIT_GRANULE_SIZE), std::memory_order_relaxed);
+}
+
+TEST(bulk_pick_carves_span_and_reuses_freed_units)
+{
+    const UnitAllocGroup group = eval_group_by_small_unit_size(64);
+    const size_t unit_size_with_head = GROUP_SIZE_LOOKUP_TABLE[group] + sizeof(UnitHead);
+    const size_t span_page_count = GROUP_SPAN_PAGE_COUNT_LOOKUP_TABLE[group];
+    const size_t unit_count = get_span_available_size(span_page_count) / unit_size_with_head;
+
+    std::unique_ptr<Chunk> chunk(new Chunk(1024 * 1024));
+    PageHead* const page = chunk->allocate_page(span_page_count);
+    CHECK(page != nullptr);
+    prepare_unit_page(page, group);
+
+    std::vector<void*> units(unit_count + 1);
+    CHECK_EQ(pick_units_from_page_without_init(page, units.data(), 3), static_cast<size_t>(3));
+    CHECK_EQ(pick_units_from_page_without_init(page, units.data() + 3, unit_count - 2),
+        unit_count - 3);
+
+    PageUnitAlloc* const page_alloc_head = reinterpret_cast<PageUnitAlloc*>(page + 1);
+    CHECK_EQ(page_alloc_head->m_run_out.load(std::memory_order_relaxed), 1);
+    CHECK_EQ(static_cast<size_t>(page->m_unit_high_water_granule.load(std::memory_order_relaxed)),
+        (sizeof(PageUnitAlloc) + unit_count * unit_size_with_head) / UNIT_GRANULE_SIZE);
+
+    for (size_t i = 0; i < unit_count; ++i)
+    {
+        UnitHead* const unit = static_cast<UnitHead*>(units[i]) - 1;
+        CHECK(units[i] == static_cast<char*>(units[0]) + i * unit_size_with_head);
+        CHECK_EQ(unit->m_life.load(std::memory_order_relaxed), UnitLife::PENDING);
+        CHECK(get_page_of_unit(unit) == page);
+    }
+
+    // Freed units are picked again, through the same pass.
+    for (const size_t i : { static_cast<size_t>(1), unit_count - 1 })
+    {
+        UnitHead* const unit = static_cast<UnitHead*>(units[i]) - 1;
+        unit->m_life.store(UnitLife::RELEASED, std::memory_order_relaxed);
+        drop_freed_unit_into_page(page, unit);
+    }
+
+    void* picked_again[4];
+    CHECK_EQ(pick_units_from_page_without_init(page, picked_again, 4), static_cast<size_t>(2));
+    CHECK((picked_again[0] == units[1] && picked_again[1] == units[unit_count - 1])
+        || (picked_again[1] == units[1] && picked_again[0] == units[unit_count - 1]));
+
+    chunk->free_page(page);
+}
+
+int test_size_class_main(void)
+{
+    std::printf("=== Size Class Tests ===\n\n");
+
+    RUN_TEST(classes_ascend_and_fit_their_spans);
+    RUN_TEST(classes_are_spaced_by_steps);
+    RUN_TEST(eval_group_picks_smallest_fitting_class);
+    RUN_TEST(span_offsets_fit_in_granules);
+    RUN_TEST(bulk_pick_carves_span_and_reuses_freed_units);
+
+    std::printf("\n=== %d failures ===\n", g_failures);
+    return g_failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,127 @@
+#include "woomem.h"
+#include "woomem_trace.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+
+using namespace woomem;
+
+static int g_failures = 0;
+
+#define TEST(name) static void test_##name()
+#define RUN_TEST(name) do { \
+    std::printf("  RUN  %s\n", #name); \
+    test_##name(); \
+    std::printf("  OK   %s\n", #name); \
+} while(0)
+#define CHECK(expr) do { \
+    if (!(expr)) { \
+        std::fprintf(stderr, "  FAIL %s:%d: %s\n", __FILE__, __LINE__, #expr); \
+        g_failures++; \
+        return; \
+    } \
+} while(0)
+#define CHECK_EQ(a, b) CHECK((a) == (b))
+
+TEST(ring_keeps_latest_events)
+{
+    std::unique_ptr<Tracer> tracer(new Tracer());
+    CHECK(!tracer->is_enabled());
+
+    // Rounded up to 4.
+    CHECK(tracer->set(3, nullptr));
+    CHECK(tracer->is_enabled());
+
+    for (uint64_t i = 0; i < 6; ++i)
+        tracer->emit(WOOMEM_TRACE_WORKER_BEGIN, WOOMEM_GC_PHASE_SWEEP, i);
+
+    woomem_TraceEvent events[8];
+    CHECK_EQ(tracer->read(events, 8), static_cast<size_t>(4));
+    for (size_t i = 0; i < 4; ++i)
+    {
+        CHECK_EQ(events[i].value, static_cast<uint64_t>(i + 2));
+        CHECK_EQ(events[i].kind, static_cast<uint16_t>(WOOMEM_TRACE_WORKER_BEGIN));
+        CHECK_EQ(events[i].phase, static_cast<uint16_t>(WOOMEM_GC_PHASE_SWEEP));
+        CHECK_EQ(events[i].thread_id, events[0].thread_id);
+        if (i != 0)
+            CHECK(events[i].timestamp_ns >= events[i - 1].timestamp_ns);
+    }
+
+    // Only the latest ones if the output is short.
+    CHECK_EQ(tracer->read(events, 2), static_cast<size_t>(2));
+    CHECK_EQ(events[0].value, static_cast<uint64_t>(4));
+    CHECK_EQ(events[1].value, static_cast<uint64_t>(5));
+
+    CHECK(tracer->set(0, nullptr));
+    CHECK(!tracer->is_enabled());
+    CHECK_EQ(tracer->read(events, 8), static_cast<size_t>(0));
+}
+
+static size_t g_callback_event_count = 0;
+static void count_trace_event(const woomem_TraceEvent* event)
+{
+    if (event->kind == WOOMEM_TRACE_CHUNK_RESERVE_FAILED)
+        ++g_callback_event_count;
+}
+
+TEST(callback_without_ring)
+{
+    std::unique_ptr<Tracer> tracer(new Tracer());
+
+    g_callback_event_count = 0;
+    CHECK(tracer->set(0, &count_trace_event));
+    CHECK(tracer->is_enabled());
+
+    tracer->emit(WOOMEM_TRACE_CHUNK_RESERVE_FAILED, WOOMEM_GC_PHASE_COUNT, 4096);
+    tracer->emit(WOOMEM_TRACE_CHUNK_RESERVE_FAILED, WOOMEM_GC_PHASE_COUNT, 4096);
+    CHECK_EQ(g_callback_event_count, static_cast<size_t>(2));
+
+    woomem_TraceEvent event;
+    CHECK_EQ(tracer->read(&event, 1), static_cast<size_t>(0));
+}
+
+TEST(write_chrome_trace_json)
+{
+    std::unique_ptr<Tracer> tracer(new Tracer());
+    CHECK(tracer->set(16, nullptr));
+
+    tracer->emit(WOOMEM_TRACE_CYCLE_BEGIN, WOOMEM_GC_PHASE_COUNT, 0);
+    tracer->emit(WOOMEM_TRACE_PHASE_BEGIN, WOOMEM_GC_PHASE_ROOT_MARK, 0);
+    tracer->emit(WOOMEM_TRACE_PHASE_END, WOOMEM_GC_PHASE_ROOT_MARK, 0);
+    tracer->emit(WOOMEM_TRACE_CYCLE_END, WOOMEM_GC_PHASE_COUNT, 1024);
+
+    const char* const path = "woomem_test_trace.json";
+    CHECK(tracer->write_json(path));
+
+    FILE* const file = std::fopen(path, "r");
+    CHECK(file != nullptr);
+
+    std::string json;
+    char buffer[256];
+    size_t read_size;
+    while ((read_size = std::fread(buffer, 1, sizeof(buffer), file)) != 0)
+        json.append(buffer, read_size);
+    std::fclose(file);
+    std::remove(path);
+
+    CHECK(json.find("\"traceEvents\"") != std::string::npos);
+    CHECK(json.find("\"woomem gc main\"") != std::string::npos);
+    CHECK(json.find("\"name\":\"root mark\",\"cat\":\"woomem\",\"ph\":\"B\"") != std::string::npos);
+    CHECK(json.find("\"args\":{\"alive_size\":1024}") != std::string::npos);
+    CHECK_EQ(json.substr(json.size() - 4), std::string("\n]}\n"));
+}
+
+int test_trace_main(void)
+{
+    std::printf("=== Trace Tests ===\n\n");
+
+    RUN_TEST(ring_keeps_latest_events);
+    RUN_TEST(callback_without_ring);
+    RUN_TEST(write_chrome_trace_json);
+
+    std::printf("\n=== %d failures ===\n", g_failures);
+    return g_failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,93 @@
+#include "woomem.h"
+#include "woomem_type_layout.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+
+using namespace woomem;
+
+static int g_failures = 0;
+
+#define TEST(name) static void test_##name()
+#define RUN_TEST(name) do { \
+    std::printf("  RUN  %s\n", #name); \
+    test_##name(); \
+    std::printf("  OK   %s\n", #name); \
+} while(0)
+#define CHECK(expr) do { \
+    if (!(expr)) { \
+        std::fprintf(stderr, "  FAIL %s:%d: %s\n", __FILE__, __LINE__, #expr); \
+        g_failures++; \
+        return; \
+    } \
+} while(0)
+#define CHECK_EQ(a, b) CHECK((a) == (b))
+
+TEST(register_sorts_and_dedups_slots)
+{
+    std::unique_ptr<TypeLayoutRegistry> types(new TypeLayoutRegistry());
+
+    const size_t offsets[] = { 3 * sizeof(void*), 0, 3 * sizeof(void*), sizeof(void*) };
+    const woomem_TypeId id = types->register_type(4 * sizeof(void*), offsets, 4);
+    CHECK(id != WOOMEM_UNTYPED);
+
+    const TypeLayout* const layout = types->get_layout(id);
+    CHECK(layout != nullptr);
+    CHECK_EQ(layout->m_size, 4 * sizeof(void*));
+    CHECK_EQ(layout->m_pointer_slot_count, static_cast<size_t>(3));
+    CHECK_EQ(layout->m_pointer_slots[0], 0u);
+    CHECK_EQ(layout->m_pointer_slots[1], 1u);
+    CHECK_EQ(layout->m_pointer_slots[2], 3u);
+
+    // Types without pointers are fine too.
+    const woomem_TypeId leaf_id = types->register_type(64, nullptr, 0);
+    CHECK(leaf_id != WOOMEM_UNTYPED && leaf_id != id);
+    CHECK_EQ(types->get_layout(leaf_id)->m_pointer_slot_count, static_cast<size_t>(0));
+}
+
+TEST(register_rejects_invalid_offsets)
+{
+    std::unique_ptr<TypeLayoutRegistry> types(new TypeLayoutRegistry());
+
+    const size_t misaligned[] = { 1 };
+    CHECK_EQ(types->register_type(64, misaligned, 1), WOOMEM_UNTYPED);
+
+    const size_t out_of_range[] = { 64 };
+    CHECK_EQ(types->register_type(64, out_of_range, 1), WOOMEM_UNTYPED);
+
+    CHECK(types->get_layout(1) == nullptr);
+    CHECK(types->get_layout(WOOMEM_UNTYPED) == nullptr);
+}
+
+TEST(ids_span_layout_blocks)
+{
+    std::unique_ptr<TypeLayoutRegistry> types(new TypeLayoutRegistry());
+
+    const size_t count = 3 * TypeLayoutRegistry::TYPE_LAYOUT_BLOCK_SIZE;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const size_t offsets[] = { i * sizeof(void*) };
+        const woomem_TypeId id = types->register_type((i + 1) * sizeof(void*), offsets, 1);
+        CHECK_EQ(id, static_cast<woomem_TypeId>(i + 1));
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        const TypeLayout* const layout = types->get_layout(static_cast<woomem_TypeId>(i + 1));
+        CHECK(layout != nullptr);
+        CHECK_EQ(layout->m_pointer_slots[0], static_cast<uint32_t>(i));
+    }
+    CHECK(types->get_layout(static_cast<woomem_TypeId>(count + 1)) == nullptr);
+}
+
+int test_type_layout_main(void)
+{
+    std::printf("=== Type Layout Tests ===\n\n");
+
+    RUN_TEST(register_sorts_and_dedups_slots);
+    RUN_TEST(register_rejects_invalid_offsets);
+    RUN_TEST(ids_span_layout_blocks);
+
+    std::printf("\n=== %d failures ===\n", g_failures);
+    return g_failures > 0 ? 1 : 0;
+}
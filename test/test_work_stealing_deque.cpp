@@ -0,0 +1,216 @@
+#include "woomem.h"
+#include "woomem_work_stealing_deque.hpp"
+#include "woomem_gray_block.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+using namespace woomem;
+
+static int g_failures = 0;
+
+#define TEST(name) static void test_##name()
+#define RUN_TEST(name) do { \
+    std::printf("  RUN  %s\n", #name); \
+    test_##name(); \
+    std::printf("  OK   %s\n", #name); \
+} while(0)
+#define CHECK(expr) do { \
+    if (!(expr)) { \
+        std::fprintf(stderr, "  FAIL %s:%d: %s\n", __FILE__, __LINE__, #expr); \
+        g_failures++; \
+        return; \
+    } \
+} while(0)
+#define CHECK_EQ(a, b) CHECK((a) == (b))
+
+// Items are never dereferenced, fake non-null pointers are enough.
+static UnitHead* fake_unit(uintptr_t i)
+{
+    return reinterpret_cast<UnitHead*>((i + 1) * 8);
+}
+static uintptr_t fake_unit_index(UnitHead* unit)
+{
+    return reinterpret_cast<uintptr_t>(unit) / 8 - 1;
+}
+
+TEST(pop_is_lifo_steal_is_fifo)
+{
+    WorkStealingDeque deque;
+    CHECK(deque.empty());
+    CHECK(deque.pop() == nullptr);
+    CHECK(deque.steal() == nullptr);
+
+    for (uintptr_t i = 0; i < 4; ++i)
+        deque.push(fake_unit(i));
+
+    CHECK_EQ(deque.pop(), fake_unit(3));
+    CHECK_EQ(deque.steal(), fake_unit(0));
+    CHECK_EQ(deque.pop(), fake_unit(2));
+    CHECK_EQ(deque.steal(), fake_unit(1));
+    CHECK(deque.empty());
+    CHECK(deque.pop() == nullptr);
+}
+
+TEST(grow_keeps_all_items)
+{
+    WorkStealingDeque deque;
+    const uintptr_t count = WorkStealingDeque::INITIAL_CAPACITY * 5;
+
+    // Steal a few first, so the live range wraps around the ring buffer.
+    for (uintptr_t i = 0; i < 10; ++i)
+        deque.push(fake_unit(i));
+    for (uintptr_t i = 0; i < 10; ++i)
+        CHECK_EQ(deque.steal(), fake_unit(i));
+
+    for (uintptr_t i = 0; i < count; ++i)
+        deque.push(fake_unit(i));
+    for (uintptr_t i = count; i-- > 0;)
+        CHECK_EQ(deque.pop(), fake_unit(i));
+
+    CHECK(deque.empty());
+    deque.reclaim_retired_buffers();
+}
+
+TEST(concurrent_steal_takes_each_item_once)
+{
+    constexpr uintptr_t ITEM_COUNT = 200000;
+    constexpr int THIEF_COUNT = 3;
+
+    WorkStealingDeque deque;
+    std::vector<std::atomic<int>> taken(ITEM_COUNT);
+    for (auto& t : taken)
+        t.store(0, std::memory_order_relaxed);
+
+    std::atomic<bool> producing{ true };
+    std::vector<std::thread> thieves;
+    for (int i = 0; i < THIEF_COUNT; ++i)
+    {
+        thieves.emplace_back([&]()
+            {
+                while (producing.load(std::memory_order_acquire) || !deque.empty())
+                {
+                    UnitHead* const unit = deque.steal();
+                    if (unit != nullptr)
+                        taken[fake_unit_index(unit)].fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+    }
+
+    for (uintptr_t i = 0; i < ITEM_COUNT; ++i)
+    {
+        deque.push(fake_unit(i));
+        if (i % 3 == 0)
+        {
+            UnitHead* const unit = deque.pop();
+            if (unit != nullptr)
+                taken[fake_unit_index(unit)].fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    while (UnitHead* const unit = deque.pop())
+        taken[fake_unit_index(unit)].fetch_add(1, std::memory_order_relaxed);
+
+    producing.store(false, std::memory_order_release);
+    for (auto& th : thieves)
+        th.join();
+
+    for (uintptr_t i = 0; i < ITEM_COUNT; ++i)
+        CHECK_EQ(taken[i].load(std::memory_order_relaxed), 1);
+}
+
+TEST(gray_block_stack_take_all_returns_last_pushed_first)
+{
+    GrayBlockStack stack;
+    CHECK(stack.empty());
+    CHECK(stack.take_all() == nullptr);
+
+    GrayBlock blocks[3];
+    for (GrayBlock& block : blocks)
+        stack.push(&block);
+    CHECK(!stack.empty());
+
+    GrayBlock* const taken = stack.take_all();
+    CHECK(stack.empty());
+    CHECK(stack.take_all() == nullptr);
+
+    CHECK_EQ(taken, &blocks[2]);
+    CHECK_EQ(taken->m_next, &blocks[1]);
+    CHECK_EQ(taken->m_next->m_next, &blocks[0]);
+    CHECK(taken->m_next->m_next->m_next == nullptr);
+}
+
+TEST(concurrent_gray_block_push_and_take_passes_each_unit_once)
+{
+    constexpr uintptr_t BLOCKS_PER_PRODUCER = 2000;
+    constexpr int PRODUCER_COUNT = 3;
+    constexpr int TAKER_COUNT = 2;
+    constexpr uintptr_t ITEM_COUNT =
+        BLOCKS_PER_PRODUCER * PRODUCER_COUNT * GrayBlock::CAPACITY;
+
+    GrayBlockStack stack;
+    std::vector<std::atomic<int>> taken(ITEM_COUNT);
+    for (auto& t : taken)
+        t.store(0, std::memory_order_relaxed);
+
+    auto take = [&]()
+        {
+            for (GrayBlock* block = stack.take_all(); block != nullptr;)
+            {
+                GrayBlock* const next = block->m_next;
+                for (size_t i = 0; i < block->m_count; ++i)
+                    taken[fake_unit_index(block->m_units[i])].fetch_add(1, std::memory_order_relaxed);
+                delete block;
+                block = next;
+            }
+        };
+
+    std::atomic<int> producing{ PRODUCER_COUNT };
+    std::vector<std::thread> threads;
+    for (int p = 0; p < PRODUCER_COUNT; ++p)
+    {
+        threads.emplace_back([&, p]()
+            {
+                uintptr_t next_item = p * BLOCKS_PER_PRODUCER * GrayBlock::CAPACITY;
+                for (uintptr_t b = 0; b < BLOCKS_PER_PRODUCER; ++b)
+                {
+                    GrayBlock* const block = new GrayBlock;
+                    block->m_count = GrayBlock::CAPACITY;
+                    for (size_t i = 0; i < GrayBlock::CAPACITY; ++i)
+                        block->m_units[i] = fake_unit(next_item++);
+                    stack.push(block);
+                }
+                producing.fetch_sub(1, std::memory_order_release);
+            });
+    }
+    for (int i = 0; i < TAKER_COUNT; ++i)
+    {
+        threads.emplace_back([&]()
+            {
+                while (producing.load(std::memory_order_acquire) != 0)
+                    take();
+            });
+    }
+    for (auto& th : threads)
+        th.join();
+    take();
+
+    for (uintptr_t i = 0; i < ITEM_COUNT; ++i)
+        CHECK_EQ(taken[i].load(std::memory_order_relaxed), 1);
+}
+
+int test_work_stealing_deque_main(void)
+{
+    std::printf("=== Work Stealing Deque Tests ===\n\n");
+
+    RUN_TEST(pop_is_lifo_steal_is_fifo);
+    RUN_TEST(grow_keeps_all_items);
+    RUN_TEST(concurrent_steal_takes_each_item_once);
+    RUN_TEST(gray_block_stack_take_all_returns_last_pushed_first);
+    RUN_TEST(concurrent_gray_block_push_and_take_passes_each_unit_once);
+
+    std::printf("\n=== %d failures ===\n", g_failures);
+    return g_failures > 0 ? 1 : 0;
+}